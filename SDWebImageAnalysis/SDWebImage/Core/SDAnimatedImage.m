@@ -12,6 +12,7 @@
 #import "SDImageCodersManager.h"
 #import "SDImageFrame.h"
 #import "UIImage+MemoryCacheCost.h"
+#import "UIImage+MemoryCacheCostTracking.h"
 #import "SDImageAssetManager.h"
 #import "objc/runtime.h"
 
@@ -176,6 +177,7 @@ static CGFloat SDImageScaleFromPath(NSString *string) {
         }
         self.loadedAnimatedImageFrames = frames;
         self.allFramesLoaded = YES;
+        [self sd_memoryCostDidChange];
     }
 }
 
@@ -183,6 +185,7 @@ static CGFloat SDImageScaleFromPath(NSString *string) {
     if (self.isAllFramesLoaded) {
         self.loadedAnimatedImageFrames = nil;
         self.allFramesLoaded = NO;
+        [self sd_memoryCostDidChange];
     }
 }
 
@@ -276,13 +279,20 @@ static CGFloat SDImageScaleFromPath(NSString *string) {
     if (!imageRef) {
         return 0;
     }
-    NSUInteger bytesPerFrame = CGImageGetBytesPerRow(imageRef) * CGImageGetHeight(imageRef);
-    NSUInteger frameCount = 1;
-    if (self.isAllFramesLoaded) {
-        frameCount = self.animatedImageFrameCount;
+    // The poster frame
+    NSUInteger cost = CGImageGetBytesPerRow(imageRef) * CGImageGetHeight(imageRef);
+    // The preloaded frames
+    NSArray<SDImageFrame *> *frames = self.loadedAnimatedImageFrames;
+    for (SDImageFrame *frame in frames) {
+        CGImageRef frameImageRef = frame.image.CGImage;
+        if (frameImageRef) {
+            cost += CGImageGetBytesPerRow(frameImageRef) * CGImageGetHeight(frameImageRef);
+        }
     }
-    frameCount = frameCount > 0 ? frameCount : 1;
-    NSUInteger cost = bytesPerFrame * frameCount;
+    // The animated image data held by coder
+    cost += self.animatedImageData.length;
+    // The frames buffered by views
+    cost += self.sd_bufferedMemoryCost;
     return cost;
 }
 
@@ -14,6 +14,9 @@
 #import "NSImage+Compatibility.h"
 #import "SDWeakProxy.h"
 #import "SDInternalMacros.h"
+#import "SDMemoryPressureManager.h"
+#import "UIImage+MemoryCacheCost.h"
+#import "UIImage+MemoryCacheCostTracking.h"
 #import <mach/mach.h>
 #import <objc/runtime.h>
 
@@ -40,9 +43,13 @@ static NSUInteger SDDeviceFreeMemory() {
     return vm_stat.free_count * page_size;
 }
 
-@interface SDAnimatedImageView () <CALayerDelegate> {
+@interface SDAnimatedImageView () <CALayerDelegate, SDMemoryPressureSubscriber> {
     NSRunLoopMode _runLoopMode;
     BOOL _initFinished; // Extra flag to mark the `commonInit` is called
+    NSUInteger _frameBufferCost; // The bytes of buffered frames, updated on each insert and remove
+    NSUInteger _frameBufferReportedCost; // The bytes of buffered frames charged to `_frameBufferCostImage`
+    UIImage *_frameBufferCostImage;
+    BOOL _frameBufferCostReportPending;
 }
 
 @property (nonatomic, strong, readwrite) UIImage *currentFrame;
@@ -137,9 +144,7 @@ static NSUInteger SDDeviceFreeMemory() {
     self.imageScaling = NSImageScaleProportionallyDown;
     self.imageAlignment = NSImageAlignCenter;
 #endif
-#if SD_UIKIT
-    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(didReceiveMemoryWarning:) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
-#endif
+    [[SDMemoryPressureManager sharedManager] addSubscriber:self];
     // Mark commonInit finished
     _initFinished = YES;
 }
@@ -163,6 +168,8 @@ static NSUInteger SDDeviceFreeMemory() {
     SD_LOCK(self.lock);
     [_frameBuffer removeAllObjects];
     _frameBuffer = nil;
+    _frameBufferCost = 0;
+    [self setNeedsReportFrameBufferCost];
     SD_UNLOCK(self.lock);
 }
 
@@ -222,7 +229,7 @@ static NSUInteger SDDeviceFreeMemory() {
         if (!self.isProgressive) {
             self.currentFrame = image;
             SD_LOCK(self.lock);
-            self.frameBuffer[@(self.currentFrameIndex)] = self.currentFrame;
+            [self setBufferedFrame:self.currentFrame atIndex:self.currentFrameIndex];
             SD_UNLOCK(self.lock);
         }
         
@@ -295,6 +302,68 @@ static NSUInteger SDDeviceFreeMemory() {
     return _frameBuffer;
 }
 
+// Make sure to call with lock held. The poster frame is counted by the animated image itself
+- (NSUInteger)bufferedCostOfFrame:(UIImage *)frame
+{
+    if (!frame || frame == self.animatedImage) {
+        return 0;
+    }
+    return frame.sd_memoryCost;
+}
+
+// Make sure to call with lock held. Pass nil frame to remove. Adjust the cost by the replaced and inserted frame only
+- (void)setBufferedFrame:(UIImage *)frame atIndex:(NSUInteger)index
+{
+    NSNumber *key = @(index);
+    UIImage *oldFrame = _frameBuffer[key];
+    if (oldFrame == frame) {
+        return;
+    }
+    NSUInteger oldCost = [self bufferedCostOfFrame:oldFrame];
+    NSUInteger newCost = [self bufferedCostOfFrame:frame];
+    self.frameBuffer[key] = frame;
+    // Clamp, the poster frame may have changed since the old frame was counted
+    _frameBufferCost = (_frameBufferCost > oldCost ? _frameBufferCost - oldCost : 0) + newCost;
+    if (oldCost != newCost) {
+        [self setNeedsReportFrameBufferCost];
+    }
+}
+
+// Make sure to call with lock held. Changes are coalesced, at most one report is pending for each view. Report on main queue, so the view is never released on the decode queue
+- (void)setNeedsReportFrameBufferCost
+{
+    if (_frameBufferCostReportPending) {
+        return;
+    }
+    _frameBufferCostReportPending = YES;
+    __weak typeof(self) wself = self;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        __strong typeof(wself) sself = wself;
+        [sself reportFrameBufferCost];
+    });
+}
+
+// Charge the bytes of buffered frames to the animated image, so the memory cache which holds it can count them
+- (void)reportFrameBufferCost
+{
+    SD_LOCK(self.lock);
+    _frameBufferCostReportPending = NO;
+    UIImage *oldImage = _frameBufferCostImage;
+    NSUInteger oldCost = _frameBufferReportedCost;
+    UIImage *newImage = self.animatedImage;
+    NSUInteger newCost = newImage ? _frameBufferCost : 0;
+    _frameBufferCostImage = newImage;
+    _frameBufferReportedCost = newCost;
+    SD_UNLOCK(self.lock);
+    // Report without lock, the memory cache may trim synchronously
+    if (oldImage != newImage) {
+        [oldImage sd_addBufferedMemoryCost:-(NSInteger)oldCost];
+        [newImage sd_addBufferedMemoryCost:(NSInteger)newCost];
+    } else {
+        [newImage sd_addBufferedMemoryCost:(NSInteger)newCost - (NSInteger)oldCost];
+    }
+}
+
 - (dispatch_semaphore_t)lock {
     if (!_lock) {
         _lock = dispatch_semaphore_create(1);
@@ -343,26 +412,40 @@ static NSUInteger SDDeviceFreeMemory() {
 #else
     [_displayLink invalidate];
     _displayLink = nil;
-    [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
 #endif
+    [_frameBufferCostImage sd_addBufferedMemoryCost:-(NSInteger)_frameBufferReportedCost];
 }
 
-- (void)didReceiveMemoryWarning:(NSNotification *)notification {
+#pragma mark - SDMemoryPressureSubscriber
+
+- (void)trimToFraction:(double)fraction {
     [_fetchQueue cancelAllOperations];
     [_fetchQueue addOperationWithBlock:^{
-        NSNumber *currentFrameIndex = @(self.currentFrameIndex);
+        NSUInteger currentFrameIndex = self.currentFrameIndex;
+        NSUInteger totalFrameCount = MAX(self.totalFrameCount, 1);
         SD_LOCK(self.lock);
-        NSArray *keys = self.frameBuffer.allKeys;
-        // only keep the next frame for later rendering
-        for (NSNumber * key in keys) {
-            if (![key isEqualToNumber:currentFrameIndex]) {
-                [self.frameBuffer removeObjectForKey:key];
-            }
+        // Keep the frames which will be rendered soonest, at least the next frame for later rendering
+        // 保留最快会被渲染的帧，至少保留下一帧用于之后的渲染
+        NSUInteger keepCount = MAX((NSUInteger)(self.frameBuffer.count * fraction), 1);
+        NSArray<NSNumber *> *keys = [self.frameBuffer.allKeys sortedArrayUsingComparator:^NSComparisonResult(NSNumber * _Nonnull key1, NSNumber * _Nonnull key2) {
+            NSUInteger distance1 = (key1.unsignedIntegerValue + totalFrameCount - currentFrameIndex) % totalFrameCount;
+            NSUInteger distance2 = (key2.unsignedIntegerValue + totalFrameCount - currentFrameIndex) % totalFrameCount;
+            return distance1 < distance2 ? NSOrderedAscending : (distance1 > distance2 ? NSOrderedDescending : NSOrderedSame);
+        }];
+        for (NSUInteger i = keepCount; i < keys.count; i++) {
+            [self setBufferedFrame:nil atIndex:keys[i].unsignedIntegerValue];
         }
         SD_UNLOCK(self.lock);
     }];
 }
 
+- (NSUInteger)memoryPressureCost {
+    SD_LOCK(self.lock);
+    NSUInteger cost = _frameBufferCost;
+    SD_UNLOCK(self.lock);
+    return cost;
+}
+
 #pragma mark - UIView Method Overrides
 #pragma mark Observing View-Related Changes
 
@@ -617,7 +700,7 @@ static NSUInteger SDDeviceFreeMemory() {
         SD_LOCK(self.lock);
         // Remove the frame buffer if need
         if (self.frameBuffer.count > self.maxBufferCount) {
-            self.frameBuffer[@(currentFrameIndex)] = nil;
+            [self setBufferedFrame:nil atIndex:currentFrameIndex];
         }
         // Check whether we can stop fetch
         if (self.frameBuffer.count == totalFrameCount) {
@@ -639,7 +722,7 @@ static NSUInteger SDDeviceFreeMemory() {
             // Recovery the current frame index and removed frame buffer (See above)
             self.currentFrameIndex = currentFrameIndex;
             SD_LOCK(self.lock);
-            self.frameBuffer[@(currentFrameIndex)] = self.currentFrame;
+            [self setBufferedFrame:self.currentFrame atIndex:currentFrameIndex];
             SD_UNLOCK(self.lock);
             [self stopAnimating];
             return;
@@ -678,8 +761,9 @@ static NSUInteger SDDeviceFreeMemory() {
 #endif
             if (isAnimating) {
                 SD_LOCK(self.lock);
-                self.frameBuffer[@(fetchFrameIndex)] = frame;
+                [self setBufferedFrame:frame atIndex:fetchFrameIndex];
                 SD_UNLOCK(self.lock);
+                [[SDMemoryPressureManager sharedManager] setNeedsEnforceMemoryBudget];
             }
         }];
         [self.fetchQueue addOperation:operation];
@@ -0,0 +1,84 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "SDWebImageCompat.h"
+
+// The disk usage of a participant, and the data it evicts next.
+// 参与者的磁盘用量，以及它接下来要淘汰的数据。
+@interface SDDiskBudgetSnapshot : NSObject
+
+// The current disk usage in bytes.
+// 当前以字节为单位的磁盘用量。
+@property (nonatomic, assign) NSUInteger usage;
+
+// The sizes and the dates (in seconds since 1970) of the least recent data, the least recent first. Fewer than the limit means there is no more data to evict.
+// 最久未使用的数据的大小和日期（自 1970 年起的秒数），最久未使用的在前。少于限制的数量表示没有更多可以淘汰的数据。
+@property (nonatomic, copy, nonnull) NSArray<NSNumber *> *oldestDataSizes;
+@property (nonatomic, copy, nonnull) NSArray<NSNumber *> *oldestDataTimes;
+
+@end
+
+// The object which stores data on disk under the global disk budget, such as the image cache of each namespace.
+// The methods are called from a background queue of the manager, one at a time. Only add the participant which can evict its data, the data which can not be evicted should not be counted in the budget.
+// 在全局磁盘预算下将数据存储在磁盘上的对象，例如每个命名空间的图像缓存。
+// 这些方法会在管理器的后台队列中调用，每次调用一个。只添加可以淘汰其数据的参与者，无法淘汰的数据不应计入预算。
+@protocol SDDiskBudgetParticipant <NSObject>
+
+// The current disk usage in bytes.
+// 当前以字节为单位的磁盘用量。
+- (NSUInteger)diskBudgetUsage;
+
+// The bytes kept even when the global budget is exceeded. 0 means the participant can be evicted to empty.
+// 即使超出全局预算也会保留的字节数。0 表示该参与者可以被淘汰至空。
+- (NSUInteger)diskBudgetMinimumSize;
+
+// The bytes the participant can not exceed, it's evicted to this size regardless of the global budget. 0 means no limit.
+// 该参与者不能超出的字节数，无论全局预算如何都会被淘汰到此大小。0 表示没有限制。
+- (NSUInteger)diskBudgetMaximumSize;
+
+// Asynchronously remove the `count` least recent data, which are the first ones of the last snapshot, then call completion with the new snapshot of at most `limit` data. `count` is 0 to take the first snapshot. Do both in one task of the disk queue, the completion can be called from any queue.
+// 异步删除 `count` 个最久未使用的数据，即上一个快照中的前几个，然后使用最多 `limit` 个数据的新快照调用 completion。`count` 为 0 时获取第一个快照。在磁盘队列的一个任务中完成这两件事，completion 可以在任意队列中调用。
+- (void)evictOldestDiskDataWithCount:(NSUInteger)count snapshotLimit:(NSUInteger)limit completion:(nonnull void(^)(SDDiskBudgetSnapshot * _Nonnull snapshot))completion;
+
+@end
+
+// The manager to share one disk budget between all the participants, such as the image caches of different namespaces, instead of each one limits its `maxDiskSize` in isolation.
+// When the total usage exceeds the budget, the data of the least value is evicted across all the participants, where the value is lower for the larger and less recent data (the size multiplied by the age). The participant is not evicted below its minimum size, and always evicted to its maximum size.
+// 在所有参与者（例如不同命名空间的图像缓存）之间共享一个磁盘预算的管理器，而不是每个参与者单独限制其 `maxDiskSize`。
+// 当总用量超出预算时，会在所有参与者中淘汰价值最低的数据，越大且越久未使用的数据价值越低（大小乘以时长）。参与者不会被淘汰到其最小大小以下，并且总是会被淘汰到其最大大小。
+@interface SDDiskBudgetManager : NSObject
+
+// Returns the global shared manager instance.
+// 返回全局共享的管理器实例。
+@property (nonatomic, class, readonly, nonnull) SDDiskBudgetManager *sharedManager;
+
+// The device-wide budget in bytes for the total `diskBudgetUsage` of all the participants.
+// Defaults to 0. Which means there is no budget, and each participant limits its own size.
+// 所有参与者的 `diskBudgetUsage` 总和的设备范围预算（以字节为单位）。
+// 默认为 0。这意味着没有预算，每个参与者各自限制自己的大小。
+@property (atomic, assign) NSUInteger diskBudget;
+
+// The total `diskBudgetUsage` of all the participants.
+// 所有参与者的 `diskBudgetUsage` 总和。
+@property (nonatomic, assign, readonly) NSUInteger totalUsage;
+
+// The participants are held weakly, no need to remove them before dealloc.
+// 参与者是弱引用的，dealloc 之前无需移除。
+- (void)addParticipant:(nonnull id<SDDiskBudgetParticipant>)participant;
+- (void)removeParticipant:(nonnull id<SDDiskBudgetParticipant>)participant;
+
+// Evict the participants until the `totalUsage` fits the `diskBudget`. This is synchronous, call it from a background queue.
+// 淘汰参与者的数据，直到 `totalUsage` 符合 `diskBudget`。这是同步的，请在后台队列中调用。
+- (void)enforceDiskBudget;
+
+// Schedule the eviction on a background queue, the calls before it runs are coalesced. The eviction is split into small batches, each batch picks the victims from the snapshots of participants, and asks each participant to evict once, so the disk queues of participants are not held for long. This is called by the participants after they grow, and do nothing when there is no budget.
+// 在后台队列中调度淘汰，在其执行之前的调用会被合并。淘汰会被拆分为小批次，每个批次根据参与者的快照选出要淘汰的数据，并让每个参与者只淘汰一次，因此不会长时间占用参与者的磁盘队列。参与者在增长后调用此方法，没有预算时不做任何事情。
+- (void)setNeedsEnforceDiskBudget;
+
+@end
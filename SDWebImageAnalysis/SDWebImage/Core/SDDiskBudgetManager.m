@@ -0,0 +1,270 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDDiskBudgetManager.h"
+#import "SDInternalMacros.h"
+
+static const NSUInteger kDiskBudgetEvictionBatchCount = 100;
+
+@implementation SDDiskBudgetSnapshot
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _oldestDataSizes = @[];
+        _oldestDataTimes = @[];
+    }
+    return self;
+}
+
+@end
+
+// The state of one participant during eviction, the snapshot is kept between batches and only the evicted participants take a new one
+@interface SDDiskBudgetParticipantState : NSObject
+
+@property (nonatomic, weak, nullable) id<SDDiskBudgetParticipant> participant;
+@property (nonatomic, strong, nullable) SDDiskBudgetSnapshot *snapshot;
+@property (nonatomic, assign) NSUInteger usage; // the usage after the picked data are evicted
+@property (nonatomic, assign) NSUInteger evictCount; // the number of picked data in current batch
+
+@end
+
+@implementation SDDiskBudgetParticipantState
+@end
+
+@interface SDDiskBudgetManager ()
+
+@property (nonatomic, strong, nonnull) dispatch_semaphore_t participantsLock;
+@property (nonatomic, strong, nonnull) NSHashTable<id<SDDiskBudgetParticipant>> *participants;
+@property (nonatomic, strong, nonnull) dispatch_queue_t evictionQueue;
+@property (nonatomic, assign) BOOL budgetCheckScheduled;
+@property (nonatomic, strong, nullable) NSArray<SDDiskBudgetParticipantState *> *evictionStates; // kept between batches, only accessed from eviction queue
+
+@end
+
+@implementation SDDiskBudgetManager
+
++ (SDDiskBudgetManager *)sharedManager {
+    static dispatch_once_t onceToken;
+    static SDDiskBudgetManager *manager;
+    dispatch_once(&onceToken, ^{
+        manager = [[SDDiskBudgetManager alloc] init];
+    });
+    return manager;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _participantsLock = dispatch_semaphore_create(1);
+        _participants = [NSHashTable weakObjectsHashTable];
+        _evictionQueue = dispatch_queue_create("com.hackemist.SDDiskBudgetManager", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+    }
+    return self;
+}
+
+#pragma mark - Participants
+
+- (void)addParticipant:(id<SDDiskBudgetParticipant>)participant {
+    NSParameterAssert(participant);
+    SD_LOCK(self.participantsLock);
+    [self.participants addObject:participant];
+    SD_UNLOCK(self.participantsLock);
+}
+
+- (void)removeParticipant:(id<SDDiskBudgetParticipant>)participant {
+    NSParameterAssert(participant);
+    SD_LOCK(self.participantsLock);
+    [self.participants removeObject:participant];
+    SD_UNLOCK(self.participantsLock);
+}
+
+- (NSArray<id<SDDiskBudgetParticipant>> *)allParticipants {
+    SD_LOCK(self.participantsLock);
+    NSArray<id<SDDiskBudgetParticipant>> *participants = self.participants.allObjects;
+    SD_UNLOCK(self.participantsLock);
+    return participants;
+}
+
+#pragma mark - Budget
+
+- (NSUInteger)totalUsage {
+    NSUInteger totalUsage = 0;
+    for (id<SDDiskBudgetParticipant> participant in [self allParticipants]) {
+        totalUsage += [participant diskBudgetUsage];
+    }
+    return totalUsage;
+}
+
+- (void)enforceDiskBudget {
+    dispatch_sync(self.evictionQueue, ^{
+        while ([self enforceDiskBudgetBatch]) {}
+    });
+}
+
+- (void)setNeedsEnforceDiskBudget {
+    if (self.diskBudget == 0) {
+        return;
+    }
+    SD_LOCK(self.participantsLock);
+    BOOL shouldSchedule = !self.budgetCheckScheduled;
+    self.budgetCheckScheduled = YES;
+    SD_UNLOCK(self.participantsLock);
+    if (!shouldSchedule) {
+        return;
+    }
+    dispatch_async(self.evictionQueue, ^{
+        SD_LOCK(self.participantsLock);
+        self.budgetCheckScheduled = NO;
+        SD_UNLOCK(self.participantsLock);
+        [self enforceDiskBudgetInBatches];
+    });
+}
+
+// Run one batch and re-dispatch the rest, so other work can interleave between batches
+- (void)enforceDiskBudgetInBatches {
+    if (![self enforceDiskBudgetBatch]) {
+        return;
+    }
+    dispatch_async(self.evictionQueue, ^{
+        [self enforceDiskBudgetInBatches];
+    });
+}
+
+// Make sure to call from eviction queue. Ask the participants to evict or take snapshots, each one at most once, and wait for them
+- (void)evictParticipantStates:(NSArray<SDDiskBudgetParticipantState *> *)states {
+    dispatch_group_t group = dispatch_group_create();
+    for (SDDiskBudgetParticipantState *state in states) {
+        id<SDDiskBudgetParticipant> participant = state.participant;
+        if (!participant) {
+            state.snapshot = [SDDiskBudgetSnapshot new];
+            continue;
+        }
+        dispatch_group_enter(group);
+        [participant evictOldestDiskDataWithCount:state.evictCount snapshotLimit:kDiskBudgetEvictionBatchCount completion:^(SDDiskBudgetSnapshot * _Nonnull snapshot) {
+            state.snapshot = snapshot;
+            dispatch_group_leave(group);
+        }];
+    }
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+}
+
+// Make sure to call from eviction queue. Evict at most one batch of data, return YES if there may be more to evict
+- (BOOL)enforceDiskBudgetBatch {
+    NSUInteger budget = self.diskBudget;
+    if (budget == 0) {
+        self.evictionStates = nil;
+        return NO;
+    }
+    // Take the snapshots once for all the batches, unless the participants changed
+    // 所有批次只获取一次快照，除非参与者发生了变化
+    NSArray<id<SDDiskBudgetParticipant>> *participants = [self allParticipants];
+    NSArray<SDDiskBudgetParticipantState *> *states = self.evictionStates;
+    if (states.count != participants.count || ![[NSSet setWithArray:[states valueForKey:@"participant"]] isEqualToSet:[NSSet setWithArray:participants]]) {
+        NSMutableArray<SDDiskBudgetParticipantState *> *newStates = [NSMutableArray arrayWithCapacity:participants.count];
+        for (id<SDDiskBudgetParticipant> participant in participants) {
+            SDDiskBudgetParticipantState *state = [SDDiskBudgetParticipantState new];
+            state.participant = participant;
+            [newStates addObject:state];
+        }
+        states = [newStates copy];
+        [self evictParticipantStates:states];
+    }
+
+    NSUInteger totalUsage = 0;
+    NSMutableArray<NSNumber *> *minimumSizes = [NSMutableArray arrayWithCapacity:states.count];
+    NSMutableArray<NSNumber *> *maximumSizes = [NSMutableArray arrayWithCapacity:states.count];
+    for (SDDiskBudgetParticipantState *state in states) {
+        id<SDDiskBudgetParticipant> participant = state.participant;
+        state.usage = state.snapshot.usage;
+        state.evictCount = 0;
+        totalUsage += state.usage;
+        [minimumSizes addObject:@(participant ? [participant diskBudgetMinimumSize] : 0)];
+        [maximumSizes addObject:@(participant ? [participant diskBudgetMaximumSize] : 0)];
+    }
+
+    // Pick the victims from snapshots without touching the disk, then each participant evicts its victims in one task
+    // 根据快照选出要淘汰的数据而不访问磁盘，然后每个参与者在一个任务中淘汰它的数据
+    NSTimeInterval now = [NSDate date].timeIntervalSince1970;
+    NSUInteger pickedCount = 0;
+    while (YES) {
+        // The participants over their own maximum are evicted first. Then if the total still exceeds the budget, all the participants above their minimum are candidates
+        // 超出自身最大值的参与者优先被淘汰。之后如果总量仍超出预算，所有高于其最小值的参与者都是候选
+        BOOL hasOverMaximum = NO;
+        for (NSUInteger i = 0; i < states.count; i++) {
+            NSUInteger maximumSize = maximumSizes[i].unsignedIntegerValue;
+            if (maximumSize > 0 && states[i].usage > maximumSize) {
+                hasOverMaximum = YES;
+                break;
+            }
+        }
+        if (!hasOverMaximum && totalUsage <= budget) {
+            break;
+        }
+        SDDiskBudgetParticipantState *victim = nil;
+        double victimScore = -1;
+        for (NSUInteger i = 0; i < states.count; i++) {
+            SDDiskBudgetParticipantState *state = states[i];
+            NSUInteger maximumSize = maximumSizes[i].unsignedIntegerValue;
+            if (hasOverMaximum) {
+                if (maximumSize == 0 || state.usage <= maximumSize) {
+                    continue;
+                }
+            } else if (state.usage <= minimumSizes[i].unsignedIntegerValue) {
+                continue;
+            }
+            NSArray<NSNumber *> *sizes = state.snapshot.oldestDataSizes;
+            if (state.evictCount >= sizes.count) {
+                // A full snapshot may have more data after the picked ones, it's taken after this batch
+                // 满的快照在已选出的数据之后可能还有更多数据，会在此批次之后获取
+                continue;
+            }
+            // The larger and less recent data has less value to keep
+            // 越大且越久未使用的数据，保留的价值越低
+            NSUInteger size = sizes[state.evictCount].unsignedIntegerValue;
+            NSTimeInterval time = state.snapshot.oldestDataTimes[state.evictCount].doubleValue;
+            double score = MAX(now - time, 1) * MAX(size, 1);
+            if (score > victimScore) {
+                victimScore = score;
+                victim = state;
+            }
+        }
+        if (!victim) {
+            break;
+        }
+        if (pickedCount >= kDiskBudgetEvictionBatchCount) {
+            break;
+        }
+        NSUInteger size = victim.snapshot.oldestDataSizes[victim.evictCount].unsignedIntegerValue;
+        victim.evictCount++;
+        pickedCount++;
+        // The freed bytes may differ from the data size, such as the deduplicated data. The new snapshot corrects it
+        // 释放的字节数可能与数据大小不同，例如去重的数据。新的快照会修正它
+        NSUInteger freed = MIN(size, victim.usage);
+        victim.usage -= freed;
+        totalUsage -= freed;
+    }
+    if (pickedCount == 0) {
+        self.evictionStates = nil;
+        return NO;
+    }
+
+    NSMutableArray<SDDiskBudgetParticipantState *> *victims = [NSMutableArray array];
+    for (SDDiskBudgetParticipantState *state in states) {
+        if (state.evictCount > 0) {
+            [victims addObject:state];
+        }
+    }
+    [self evictParticipantStates:victims];
+    // Check again with the new snapshots, the freed bytes may be less than expected
+    // 使用新的快照再次检查，释放的字节数可能少于预期
+    self.evictionStates = states;
+    return YES;
+}
+
+@end
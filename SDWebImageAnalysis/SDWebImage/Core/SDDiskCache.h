@@ -14,8 +14,8 @@
 // 允许在 SDImageCache 中使用自定义磁盘缓存的协议。
 @protocol SDDiskCache <NSObject>
 
-// All of these method are called from the same global queue to avoid blocking on main queue and thread-safe problem. But it's also recommend to ensure thread-safe yourself using lock or other ways.
-// 所有这些方法都从同一个全局队列调用，以避免阻塞主队列和线程安全问题。但是也建议使用锁或其他方法来确保自己的线程安全。
+// All of these method are called from the IO queues of `SDImageCache` to avoid blocking on main queue. The methods for the same key are never called at the same time, but the methods for different keys may be called concurrently, see `maxConcurrentDiskOperationCount` in `SDImageCacheConfig`. `removeAllData` is never called at the same time with other methods. `removeExpiredData`, `removeExpiredDataWithLimit:timeLimit:`, `totalCount` and `totalSize` are never called at the same time with each other or with the writes (`setData:forKey:`, `removeDataForKey:`, `addVariantKey:forKey:`), but they may be called at the same time with the reads (`containsDataForKey:`, `dataForKey:`, `variantKeysForKey:`) of any key. So you should ensure thread-safe of the shared state yourself using lock or other ways, including the state shared by these methods and the reads.
+// 所有这些方法都从 `SDImageCache` 的 IO 队列调用，以避免阻塞主队列。同一个 key 的方法不会同时调用，但不同 key 的方法可能会并发调用，参见 `SDImageCacheConfig` 的 `maxConcurrentDiskOperationCount`。`removeAllData` 不会与其他方法同时调用。`removeExpiredData`、`removeExpiredDataWithLimit:timeLimit:`、`totalCount` 和 `totalSize` 不会相互同时调用，也不会与写操作（`setData:forKey:`、`removeDataForKey:`、`addVariantKey:forKey:`）同时调用，但可能与任意 key 的读操作（`containsDataForKey:`、`dataForKey:`、`variantKeysForKey:`）同时调用。因此你应该使用锁或其他方法来确保共享状态的线程安全，包括这些方法与读操作共享的状态。
 @required
 
 // Create a new disk cache based on the specified path. You can check `maxDiskSize` and `maxDiskAge` used for disk cache.
@@ -74,10 +74,30 @@
 // 此方法可能会阻塞调用线程，直到文件读取完成。
 - (NSUInteger)totalSize;
 
+@optional
+
+// Removes the expired data incrementally, which removes at most `limit` files, or until `timeLimit` seconds elapsed, in one call. 0 means no limit. The next call continues from where the last one stopped, even after relaunch. `SDImageCache` calls this in slices instead of `removeExpiredData` if implemented, so the other operations run between slices.
+// Returns YES if there is more data to remove.
+// 增量删除过期数据，每次调用最多删除 `limit` 个文件，或直到经过 `timeLimit` 秒。0 表示没有限制。下一次调用会从上一次停止的地方继续，即使在重新启动后也是如此。如果实现了此方法，`SDImageCache` 会分片调用它而不是 `removeExpiredData`，这样其他操作可以在分片之间执行。
+// 如果还有更多数据需要删除，则返回 YES。
+- (BOOL)removeExpiredDataWithLimit:(NSUInteger)limit timeLimit:(NSTimeInterval)timeLimit;
+
+// Persist that the data of `variantKey` is transformed from the data of `key` (see `SDTransformedKeyForKey`). `removeDataForKey:` and the expiration of `key` should remove the variants as well, they are stale once the data they are transformed from is gone. The data of `key` may be written after this call.
+// This method is called with the methods of `variantKey`, so it may be called concurrently with the methods of `key`.
+// 持久化 `variantKey` 的数据是从 `key` 的数据转换得到的（参见 `SDTransformedKeyForKey`）。`removeDataForKey:` 和 `key` 的过期也应该删除这些变体，一旦它们转换自的数据不存在，它们就过时了。`key` 的数据可能在此调用之后才写入。
+// 此方法与 `variantKey` 的方法一起调用，因此可能与 `key` 的方法并发调用。
+- (void)addVariantKey:(nonnull NSString *)variantKey forKey:(nonnull NSString *)key;
+
+// The variant keys added for `key`, empty if there is none
+// 为 `key` 添加的变体 key，如果没有则为空
+- (nonnull NSArray<NSString *> *)variantKeysForKey:(nonnull NSString *)key;
+
 @end
 
 // The built-in disk cache.
+// It keeps a persistent index of the metadata (size, dates, format, hit count, variant keys) of each file, updated on write and remove, so `totalSize`, `totalCount` and `removeExpiredData` do not need to walk the directory.
 // 内置磁盘缓存
+// 它为每个文件维护一个持久化的元数据索引（大小、日期、格式、命中次数、变体 key），在写入和删除时更新，因此 `totalSize`、`totalCount` 和 `removeExpiredData` 不需要遍历目录。
 @interface SDDiskCache : NSObject <SDDiskCache>
 
 // Cache Config object - storing all kind of settings.
@@ -98,4 +118,18 @@
 // 如果 new location 确实存在，但不是目录，则会将其删除并移动目录。
 - (void)moveCacheDirectoryFromPath:(nonnull NSString *)srcPath toPath:(nonnull NSString *)dstPath;
 
+// Move at most `limit` files which are not in the `diskCacheDirectoryLayout` of config, so the migration can run incrementally. Files are found in both layouts during migration.
+// Returns YES if there are more files to move.
+// 移动最多 `limit` 个不符合配置中 `diskCacheDirectoryLayout` 的文件，以便迁移可以增量进行。迁移过程中两种布局的文件都可以被找到。
+// 如果还有更多文件需要移动，则返回 YES。
+- (BOOL)migrateDirectoryLayoutWithLimit:(NSUInteger)limit;
+
+// Enumerate the size and the date (of `diskCacheExpireType` in config, in seconds since 1970) of at most `limit` oldest files, the oldest first, which is the order removed by size limit. Used by `SDDiskBudgetManager` to compare the files of different caches. The block is called with the index lock held, do not call the other methods in block.
+// 枚举最多 `limit` 个最旧文件的大小和日期（配置中的 `diskCacheExpireType`，自 1970 年起的秒数），最旧的在前，即按大小限制删除的顺序。用于 `SDDiskBudgetManager` 比较不同缓存的文件。block 调用时持有索引锁，不要在 block 中调用其他方法。
+- (void)enumerateOldestDataWithLimit:(NSUInteger)limit usingBlock:(nonnull void(^)(NSUInteger size, NSTimeInterval time))block;
+
+// Remove the oldest file. Returns NO if the cache is empty.
+// 删除最旧的文件。如果缓存为空，返回 NO。
+- (BOOL)removeOldestData;
+
 @end
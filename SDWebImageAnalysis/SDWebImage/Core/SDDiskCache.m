@@ -8,12 +8,26 @@
 
 #import "SDDiskCache.h"
 #import "SDImageCacheConfig.h"
+#import "SDDiskCacheIndex.h"
+#import "SDInternalMacros.h"
+#import "NSData+ImageContentType.h"
 #import <CommonCrypto/CommonDigest.h>
+#import <unistd.h>
+#import <sys/stat.h>
+
+// Hidden directory, so the directory enumeration of disk cache skip it
+static NSString * const kSDDiskCacheBlobDirectoryName = @".sd_blobs";
 
 @interface SDDiskCache ()
 
 @property (nonatomic, copy) NSString *diskCachePath;
 @property (nonatomic, strong, nonnull) NSFileManager *fileManager;
+@property (nonatomic, strong, nonnull) SDDiskCacheIndex *index; // metadata of all files, loaded lazily by `loadedIndex`
+@property (nonatomic, assign) BOOL indexLoaded;
+@property (nonatomic, strong, nonnull) NSCache<NSString *, NSString *> *relativePathCache; // key -> relative path, to avoid hashing the hot keys again
+@property (nonatomic, strong, nullable) NSMutableArray<NSString *> *layoutMigrationPaths; // relative paths not in the current layout, built lazily by `migrateDirectoryLayoutWithLimit:`
+@property (nonatomic, strong, nonnull) dispatch_semaphore_t indexLock; // a lock to keep the access to index thread-safe, files of different keys are read and written concurrently
+@property (nonatomic, strong, nonnull) NSCache<NSString *, NSArray<NSString *> *> *pendingVariantKeys; // relative path -> variant keys added before the file is written, moved into its entry by `setData:forKey:`
 
 @end
 
@@ -40,6 +54,14 @@
     } else {
         self.fileManager = [NSFileManager new];
     }
+    // The index is loaded on first use from io queue, to avoid reading it during initialization
+    // 索引在首次使用时从 io 队列中加载，避免在初始化时读取
+    self.index = [[SDDiskCacheIndex alloc] initWithDirectory:self.diskCachePath orderType:self.config.diskCacheExpireType];
+    self.indexLock = dispatch_semaphore_create(1);
+    self.relativePathCache = [NSCache new];
+    self.relativePathCache.countLimit = 1000;
+    self.pendingVariantKeys = [NSCache new];
+    self.pendingVariantKeys.countLimit = 1000;
 }
 
 - (BOOL)containsDataForKey:(NSString *)key {
@@ -47,12 +69,10 @@
     NSString *filePath = [self cachePathForKey:key];
     BOOL exists = [self.fileManager fileExistsAtPath:filePath];
     
-    // fallback because of https://github.com/rs/SDWebImage/pull/976 that added the extension to the disk file name
-    // checking the key with and without the extension
-    // 由于 https://github.com/rs/SDWebImage/pull/976 添加了磁盘文件名的扩展名而导致回退
-    // 检查 key 是否使用了扩展名
+    // fallback to the legacy file names and the other directory layout
+    // 回退到旧的文件名和另一种目录布局
     if (!exists) {
-        exists = [self.fileManager fileExistsAtPath:filePath.stringByDeletingPathExtension];
+        exists = [self legacyRelativePathForKey:key] != nil;
     }
     
     return exists;
@@ -60,22 +80,123 @@
 
 - (NSData *)dataForKey:(NSString *)key {
     NSParameterAssert(key);
-    NSString *filePath = [self cachePathForKey:key];
-    NSData *data = [NSData dataWithContentsOfFile:filePath options:self.config.diskCacheReadingOptions error:nil];
+    NSString *relativePath = [self relativePathForKey:key];
+    NSData *data = [self dataForRelativePath:relativePath];
     if (data) {
+        SD_LOCK(self.indexLock);
+        [[self loadedIndex] touchEntryForFileName:relativePath];
+        SD_UNLOCK(self.indexLock);
         return data;
     }
     
-    // fallback because of https://github.com/rs/SDWebImage/pull/976 that added the extension to the disk file name
-    // checking the key with and without the extension
-    data = [NSData dataWithContentsOfFile:filePath.stringByDeletingPathExtension options:self.config.diskCacheReadingOptions error:nil];
-    if (data) {
-        return data;
+    // fallback to the legacy file names and the other directory layout, and move it to the current path, so next access does not need fallback
+    // 回退到旧的文件名和另一种目录布局，并移动到当前的路径，这样下次访问不需要回退
+    NSString *legacyRelativePath = [self legacyRelativePathForKey:key];
+    if (legacyRelativePath) {
+        data = [self dataForRelativePath:legacyRelativePath];
+        if (data) {
+            [self moveRelativePath:legacyRelativePath toRelativePath:relativePath];
+            SD_LOCK(self.indexLock);
+            [[self loadedIndex] touchEntryForFileName:relativePath];
+            SD_UNLOCK(self.indexLock);
+            return data;
+        }
     }
     
     return nil;
 }
 
+- (nullable NSData *)dataForRelativePath:(NSString *)relativePath {
+    NSString *filePath = [self.diskCachePath stringByAppendingPathComponent:relativePath];
+    SD_LOCK(self.indexLock);
+    SDDiskCacheIndexEntry *entry = [[self loadedIndex] entryForFileName:relativePath];
+    SD_UNLOCK(self.indexLock);
+    // A file without entry may be written by a previous version, or its index record is lost. Adopt it with the size from stat, see `adoptIndexEntryForRelativePath:`
+    // 没有条目的文件可能由之前的版本写入，或者其索引记录丢失。使用 stat 得到的大小收录它，参见 `adoptIndexEntryForRelativePath:`
+    if (!entry) {
+        entry = [self adoptIndexEntryForRelativePath:relativePath];
+        if (!entry) {
+            return nil;
+        }
+    }
+    SD_LOCK(self.indexLock);
+    NSUInteger size = entry.size;
+    uint64_t checksum = entry.verified ? 0 : entry.checksum;
+    SD_UNLOCK(self.indexLock);
+    
+    NSDataReadingOptions options = self.config.diskCacheReadingOptions;
+    NSUInteger threshold = self.config.diskCacheMappedReadingThreshold;
+    // Our atomic writing replace the file, so a mapped file is never truncated (which cause SIGBUS), and removing a mapped file keeps the mapping valid
+    // 原子写入会替换文件，因此映射中的文件不会被截断（会导致 SIGBUS），删除映射中的文件也不影响映射的有效性
+    // Use the size from index to avoid an extra stat
+    // 使用索引中的大小，避免额外的 stat
+    if (threshold > 0 && (self.config.diskCacheWritingOptions & NSDataWritingAtomic) && size >= threshold) {
+        options |= NSDataReadingMappedAlways;
+    }
+    NSData *data = [NSData dataWithContentsOfFile:filePath options:options error:nil];
+    if (data && ![self isValidData:data size:size checksum:checksum]) {
+        // Remove the bad file, so it's not read and decoded again
+        // 删除损坏的文件，这样它不会被再次读取和解码
+        [self.fileManager removeItemAtPath:filePath error:nil];
+        SD_LOCK(self.indexLock);
+        if ([self.index entryForFileName:relativePath] == entry) {
+            [self removeIndexEntryForFileName:relativePath];
+        }
+        SD_UNLOCK(self.indexLock);
+        return nil;
+    }
+    if (data && checksum != 0) {
+        // Verify each entry once, later reads only check the length
+        // 每个条目只校验一次，之后的读取只检查长度
+        SD_LOCK(self.indexLock);
+        entry.verified = YES;
+        SD_UNLOCK(self.indexLock);
+    }
+    return data;
+}
+
+// Record the file which has no index entry, return nil if the file does not exist. The size from stat can not tell a torn file, so it's only adopted when writing is atomic. Otherwise the entry is journaled before the data is written (see `setData:forKey:`), a file without entry may be torn and is removed
+- (nullable SDDiskCacheIndexEntry *)adoptIndexEntryForRelativePath:(NSString *)relativePath {
+    NSString *filePath = [self.diskCachePath stringByAppendingPathComponent:relativePath];
+    struct stat fileStat;
+    if (stat(filePath.fileSystemRepresentation, &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+        return nil;
+    }
+    if (!(self.config.diskCacheWritingOptions & NSDataWritingAtomic)) {
+        [self.fileManager removeItemAtPath:filePath error:nil];
+        return nil;
+    }
+    SDDiskCacheIndexEntry *entry = [SDDiskCacheIndexEntry new];
+    entry.fileName = relativePath;
+    entry.size = (NSUInteger)fileStat.st_size;
+    entry.modificationTime = fileStat.st_mtimespec.tv_sec + fileStat.st_mtimespec.tv_nsec / 1e9;
+    entry.accessTime = fileStat.st_atimespec.tv_sec + fileStat.st_atimespec.tv_nsec / 1e9;
+    entry.format = SDImageFormatUndefined;
+    SD_LOCK(self.indexLock);
+    SDDiskCacheIndex *index = [self loadedIndex];
+    // The file may be written and recorded meanwhile
+    SDDiskCacheIndexEntry *existingEntry = [index entryForFileName:relativePath];
+    if (existingEntry) {
+        entry = existingEntry;
+    } else {
+        // The file is not written now, insert it by its date
+        [index insertEntry:entry];
+    }
+    SD_UNLOCK(self.indexLock);
+    return entry;
+}
+
+// The length check is free. The checksum is only verified if it's known, and only needed when writing is not atomic, because an atomic write never leaves a torn file
+- (BOOL)isValidData:(nonnull NSData *)data size:(NSUInteger)size checksum:(uint64_t)checksum {
+    if (data.length != size) {
+        return NO;
+    }
+    if (self.config.shouldVerifyDiskCacheData && checksum != 0 && !(self.config.diskCacheWritingOptions & NSDataWritingAtomic) && SDDiskCacheChecksumForData(data) != checksum) {
+        return NO;
+    }
+    return YES;
+}
+
 - (void)setData:(NSData *)data forKey:(NSString *)key {
     NSParameterAssert(data);
     NSParameterAssert(key);
@@ -84,11 +205,62 @@
     }
     
     // get cache Path for image key
-    NSString *cachePathForKey = [self cachePathForKey:key];
+    NSString *relativePath = [self relativePathForKey:key];
+    NSString *cachePathForKey = [self.diskCachePath stringByAppendingPathComponent:relativePath];
     // transform to NSUrl
     NSURL *fileURL = [NSURL fileURLWithPath:cachePathForKey];
     
-    [data writeToURL:fileURL options:self.config.diskCacheWritingOptions error:nil];
+    // Record the metadata, so size, count and expiration do not need to walk the directory
+    // 记录元数据，这样计算 size、count 和过期时不需要遍历目录
+    BOOL isAtomic = self.config.diskCacheWritingOptions & NSDataWritingAtomic;
+    NSTimeInterval now = [NSDate date].timeIntervalSince1970;
+    SDDiskCacheIndexEntry *entry = [SDDiskCacheIndexEntry new];
+    entry.fileName = relativePath;
+    entry.size = data.length;
+    entry.modificationTime = now;
+    entry.accessTime = now;
+    entry.format = [NSData sd_imageFormatForImageData:data];
+    // The checksum is only verified when writing is not atomic, see `isValidData:size:checksum:`
+    // 校验和只在非原子写入时校验，参见 `isValidData:size:checksum:`
+    if (!isAtomic && self.config.shouldVerifyDiskCacheData) {
+        entry.checksum = SDDiskCacheChecksumForData(data);
+    }
+    
+    // Link to the blob of same content, instead of writing another copy
+    // 链接到相同内容的 blob，而不是再写入一份拷贝
+    NSData *digest = nil;
+    if (self.config.shouldDeduplicateDiskCacheData) {
+        digest = [self linkBlobForData:data toRelativePath:relativePath];
+        if (!digest && !isAtomic) {
+            // The file may be a link of blob, do not write through it
+            // 文件可能是 blob 的链接，不要通过它写入
+            [self.fileManager removeItemAtPath:cachePathForKey error:nil];
+        }
+    }
+    if (!digest) {
+        if (!isAtomic) {
+            // Journal the entry before writing, so the file torn by a crash during writing is caught by its size and checksum when read
+            // 在写入前将条目记入日志，这样写入时因崩溃而不完整的文件在读取时会被其大小和校验和发现
+            [self recordIndexEntry:entry];
+        }
+        if (![data writeToURL:fileURL options:self.config.diskCacheWritingOptions error:nil]) {
+            // The shard directory may not exist yet
+            // 分片目录可能还不存在
+            if (![self createParentDirectoryForRelativePath:relativePath] || ![data writeToURL:fileURL options:self.config.diskCacheWritingOptions error:nil]) {
+                if (!isAtomic) {
+                    [self.fileManager removeItemAtPath:cachePathForKey error:nil];
+                    SD_LOCK(self.indexLock);
+                    [self removeIndexEntryForFileName:relativePath];
+                    SD_UNLOCK(self.indexLock);
+                }
+                return;
+            }
+        }
+    }
+    if (digest || isAtomic) {
+        entry.digest = digest;
+        [self recordIndexEntry:entry];
+    }
     
     // disable iCloud backup
     if (self.config.shouldDisableiCloud) {
@@ -99,119 +271,184 @@
     }
 }
 
+// Set the entry of written file, it keeps the variant keys of the replaced entry
+- (void)recordIndexEntry:(nonnull SDDiskCacheIndexEntry *)entry {
+    NSString *relativePath = entry.fileName;
+    SD_LOCK(self.indexLock);
+    SDDiskCacheIndex *index = [self loadedIndex];
+    SDDiskCacheIndexEntry *oldEntry = [index entryForFileName:relativePath];
+    NSData *oldDigest = oldEntry.digest;
+    // Keep the variants linked, the variants stored before this file are pending
+    // 保持变体的关联，在此文件之前存储的变体处于待定状态
+    NSArray<NSString *> *pendingVariantKeys = [self.pendingVariantKeys objectForKey:relativePath];
+    if (pendingVariantKeys) {
+        [self.pendingVariantKeys removeObjectForKey:relativePath];
+        entry.variantKeys = SDDiskCacheMergedVariantKeys(oldEntry.variantKeys, pendingVariantKeys);
+    } else {
+        entry.variantKeys = oldEntry.variantKeys;
+    }
+    [index setEntry:entry];
+    [self releaseBlobForDigest:oldDigest];
+    SD_UNLOCK(self.indexLock);
+}
+
 - (void)removeDataForKey:(NSString *)key {
     NSParameterAssert(key);
-    NSString *filePath = [self cachePathForKey:key];
-    [self.fileManager removeItemAtPath:filePath error:nil];
+    NSString *relativePath = [self relativePathForKey:key];
+    [self.fileManager removeItemAtPath:[self.diskCachePath stringByAppendingPathComponent:relativePath] error:nil];
+    SD_LOCK(self.indexLock);
+    NSArray<NSString *> *variantKeys = [[self loadedIndex] entryForFileName:relativePath].variantKeys;
+    [self removeIndexEntryForFileName:relativePath];
+    [self.pendingVariantKeys removeObjectForKey:relativePath];
+    [self removeFilesForVariantKeys:variantKeys];
+    SD_UNLOCK(self.indexLock);
+    
+    NSString *legacyRelativePath = [self legacyRelativePathForKey:key];
+    if (legacyRelativePath) {
+        [self.fileManager removeItemAtPath:[self.diskCachePath stringByAppendingPathComponent:legacyRelativePath] error:nil];
+        SD_LOCK(self.indexLock);
+        [self removeIndexEntryForFileName:legacyRelativePath];
+        SD_UNLOCK(self.indexLock);
+    }
 }
 
 - (void)removeAllData {
+    SD_LOCK(self.indexLock);
+    [self.index invalidate];
     [self.fileManager removeItemAtPath:self.diskCachePath error:nil];
     [self.fileManager createDirectoryAtPath:self.diskCachePath
             withIntermediateDirectories:YES
                              attributes:nil
                                   error:NULL];
+    [self.index removeAllEntries];
+    [self.pendingVariantKeys removeAllObjects];
+    self.indexLoaded = YES;
+    self.layoutMigrationPaths = nil;
+    SD_UNLOCK(self.indexLock);
 }
 
 - (void)removeExpiredData {
-    NSURL *diskCacheURL = [NSURL fileURLWithPath:self.diskCachePath isDirectory:YES];
-    
-    // Compute content date key to be used for tests
-    // 计算用于测试的内容日期密钥
-    NSURLResourceKey cacheContentDateKey = NSURLContentModificationDateKey;
-    switch (self.config.diskCacheExpireType) {
-        case SDImageCacheConfigExpireTypeAccessDate:
-            cacheContentDateKey = NSURLContentAccessDateKey;
-            break;
-            
-        case SDImageCacheConfigExpireTypeModificationDate:
-            cacheContentDateKey = NSURLContentModificationDateKey;
-            break;
-            
-        default:
-            break;
-    }
-    
-    NSArray<NSString *> *resourceKeys = @[NSURLIsDirectoryKey, cacheContentDateKey, NSURLTotalFileAllocatedSizeKey];
+    // No limit, remove all in one call
+    // 没有限制，一次调用全部删除
+    [self removeExpiredDataWithLimit:0 timeLimit:0];
+}
+
+- (BOOL)removeExpiredDataWithLimit:(NSUInteger)limit timeLimit:(NSTimeInterval)timeLimit {
+    SD_LOCK(self.indexLock);
+    SDDiskCacheIndex *index = [self loadedIndex];
+    BOOL useAccessTime = index.orderType == SDImageCacheConfigExpireTypeAccessDate;
+    CFAbsoluteTime deadline = timeLimit > 0 ? CFAbsoluteTimeGetCurrent() + timeLimit : 0;
+    __block NSUInteger removedCount = 0;
+    __block BOOL hasMore = NO;
+    // The variants are removed after enumeration, removing other entries in block is not safe
+    NSMutableArray<NSString *> *variantKeys = [NSMutableArray array];
+    // At least one file is removed in each call, so the removal always makes progress
+    BOOL(^shouldYield)(void) = ^BOOL{
+        if (removedCount == 0) {
+            return NO;
+        }
+        return (limit > 0 && removedCount >= limit) || (deadline > 0 && CFAbsoluteTimeGetCurrent() >= deadline);
+    };
     
-    // This enumerator prefetches useful properties for our cache files.
-    // 此枚举为我们的缓存文件预先载入有用的属性。
-    NSDirectoryEnumerator *fileEnumerator = [self.fileManager enumeratorAtURL:diskCacheURL
-                                               includingPropertiesForKeys:resourceKeys
-                                                                  options:NSDirectoryEnumerationSkipsHiddenFiles
-                                                             errorHandler:NULL];
+    // The index is ordered by the date of expire type (oldest first), so we only visit the entries to remove, instead of enumerating the directory and sorting all of the files. The oldest entry is also where the next call resumes.
+    // 索引按过期类型的日期排序（最旧的在前），因此我们只访问需要删除的条目，而不需要遍历目录并对所有文件排序。最旧的条目也是下一次调用继续的位置。
     
-    NSDate *expirationDate = (self.config.maxDiskAge < 0) ? nil: [NSDate dateWithTimeIntervalSinceNow:-self.config.maxDiskAge];
-    NSMutableDictionary<NSURL *, NSDictionary<NSString *, id> *> *cacheFiles = [NSMutableDictionary dictionary];
-    NSUInteger currentCacheSize = 0;
+    // 1. Remove files that are older than the expiration date
+    // 1. 删除早于过期日期的文件
+    if (self.config.maxDiskAge >= 0) {
+        NSTimeInterval expirationTime = [NSDate date].timeIntervalSince1970 - self.config.maxDiskAge;
+        [index enumerateEntriesFromOldestUsingBlock:^(SDDiskCacheIndexEntry * _Nonnull entry, BOOL * _Nonnull stop) {
+            NSTimeInterval time = useAccessTime ? entry.accessTime : entry.modificationTime;
+            if (time > expirationTime) {
+                *stop = YES;
+                return;
+            }
+            if (shouldYield()) {
+                hasMore = YES;
+                *stop = YES;
+                return;
+            }
+            if (entry.variantKeys) {
+                [variantKeys addObjectsFromArray:entry.variantKeys];
+            }
+            [self removeFileForIndexEntry:entry];
+            removedCount++;
+        }];
+        [self removeFilesForVariantKeys:variantKeys];
+        [variantKeys removeAllObjects];
+    }
     
-    // Enumerate all of the files in the cache directory. This loop has two purposes:
-    //  1. Removing files that are older than the expiration date.
-    //  2. Storing file attributes for the size-based cleanup pass.
-    // 列举缓存目录中的所有文件。此循环有两个用途：
-    //  1. 正在删除早于过期日期的文件。
-    //  2. 存储基于大小的清理过程的文件属性。
-    NSMutableArray<NSURL *> *urlsToDelete = [[NSMutableArray alloc] init];
-    for (NSURL *fileURL in fileEnumerator) {
-        NSError *error;
-        NSDictionary<NSString *, id> *resourceValues = [fileURL resourceValuesForKeys:resourceKeys error:&error];
-        
-        // Skip directories and errors.
-        // 跳过文件夹和错误。
-        if (error || !resourceValues || [resourceValues[NSURLIsDirectoryKey] boolValue]) {
-            continue;
+    // 2. If our remaining disk cache exceeds a configured maximum size, delete the oldest files until half of the maximum size. The target is persisted, so an interrupted trim goes on to the same target even after relaunch
+    // 2. 如果剩余的磁盘缓存超过配置的最大 size，删除最旧的文件直到最大 size 的一半。目标会被持久化，因此被中断的裁剪即使在重新启动后也会继续到相同的目标
+    NSUInteger maxDiskSize = self.config.maxDiskSize;
+    if (!hasMore) {
+        if (maxDiskSize == 0) {
+            index.trimTargetSize = 0;
+        } else if (index.trimTargetSize == 0 && index.totalSize > maxDiskSize) {
+            index.trimTargetSize = MAX(maxDiskSize / 2, 1);
+            [index synchronize];
         }
-        
-        // Remove files that are older than the expiration date;
-        // 删除超过过期日期的文件
-        NSDate *modifiedDate = resourceValues[cacheContentDateKey];
-        if (expirationDate && [[modifiedDate laterDate:expirationDate] isEqualToDate:expirationDate]) {
-            [urlsToDelete addObject:fileURL];
-            continue;
+        const NSUInteger desiredCacheSize = index.trimTargetSize;
+        if (desiredCacheSize > 0) {
+            [index enumerateEntriesFromOldestUsingBlock:^(SDDiskCacheIndexEntry * _Nonnull entry, BOOL * _Nonnull stop) {
+                if (index.totalSize < desiredCacheSize) {
+                    *stop = YES;
+                    return;
+                }
+                if (shouldYield()) {
+                    hasMore = YES;
+                    *stop = YES;
+                    return;
+                }
+                if (entry.variantKeys) {
+                    [variantKeys addObjectsFromArray:entry.variantKeys];
+                }
+                [self removeFileForIndexEntry:entry];
+                removedCount++;
+            }];
+            [self removeFilesForVariantKeys:variantKeys];
+            if (!hasMore) {
+                index.trimTargetSize = 0;
+            }
         }
-        
-        // Store a reference to this file and account for its total size.
-        // 存储对该文件的引用并计算其总大小。
-        NSNumber *totalAllocatedSize = resourceValues[NSURLTotalFileAllocatedSizeKey];
-        currentCacheSize += totalAllocatedSize.unsignedIntegerValue;
-        cacheFiles[fileURL] = resourceValues;
     }
     
-    for (NSURL *fileURL in urlsToDelete) {
-        [self.fileManager removeItemAtURL:fileURL error:nil];
+    // The removals are journaled, only fold them into snapshot when finished
+    // 删除操作已记录在日志中，只在完成时合并到快照
+    if (!hasMore) {
+        [index synchronize];
     }
-    
-    // If our remaining disk cache exceeds a configured maximum size, perform a second
-    // size-based cleanup pass.  We delete the oldest files first.
-    // 如果剩余的磁盘缓存超过配置的最大 size，请执行第二步
-    // 基于大小的清理过程。我们先删除最旧的文件。
-    NSUInteger maxDiskSize = self.config.maxDiskSize;
-    if (maxDiskSize > 0 && currentCacheSize > maxDiskSize) {
-        // Target half of our maximum cache size for this cleanup pass.
-        // 将清除最大缓存 size 的一半作为目标。
-        const NSUInteger desiredCacheSize = maxDiskSize / 2;
-        
-        // Sort the remaining cache files by their last modification time or last access time (oldest first).
-        // 按剩余的缓存文件的上次修改时间或上次访问时间（最早的）进行排序。
-        NSArray<NSURL *> *sortedFiles = [cacheFiles keysSortedByValueWithOptions:NSSortConcurrent
-                                                                 usingComparator:^NSComparisonResult(id obj1, id obj2) {
-                                                                     return [obj1[cacheContentDateKey] compare:obj2[cacheContentDateKey]];
-                                                                 }];
-        
-        // Delete files until we fall below our desired cache size.
-        // 删除文件，直到我们低于所需的缓存 size。
-        for (NSURL *fileURL in sortedFiles) {
-            if ([self.fileManager removeItemAtURL:fileURL error:nil]) {
-                NSDictionary<NSString *, id> *resourceValues = cacheFiles[fileURL];
-                NSNumber *totalAllocatedSize = resourceValues[NSURLTotalFileAllocatedSizeKey];
-                currentCacheSize -= totalAllocatedSize.unsignedIntegerValue;
-                
-                if (currentCacheSize < desiredCacheSize) {
-                    break;
-                }
-            }
+    SD_UNLOCK(self.indexLock);
+    return hasMore;
+}
+
+- (void)addVariantKey:(NSString *)variantKey forKey:(NSString *)key {
+    NSParameterAssert(variantKey);
+    NSParameterAssert(key);
+    NSString *relativePath = [self relativePathForKey:key];
+    SD_LOCK(self.indexLock);
+    SDDiskCacheIndex *index = [self loadedIndex];
+    SDDiskCacheIndexEntry *entry = [index entryForFileName:relativePath];
+    if (entry) {
+        if (![entry.variantKeys containsObject:variantKey]) {
+            [index updateVariantKeys:SDDiskCacheMergedVariantKeys(entry.variantKeys, @[variantKey]) forFileName:relativePath];
         }
+    } else {
+        // The file of key may be written later, such as the original image stored after its variant
+        // key 的文件可能稍后写入，例如原始图像在其变体之后存储
+        NSArray<NSString *> *pendingVariantKeys = [self.pendingVariantKeys objectForKey:relativePath];
+        [self.pendingVariantKeys setObject:SDDiskCacheMergedVariantKeys(pendingVariantKeys, @[variantKey]) forKey:relativePath];
     }
+    SD_UNLOCK(self.indexLock);
+}
+
+- (NSArray<NSString *> *)variantKeysForKey:(NSString *)key {
+    NSParameterAssert(key);
+    NSString *relativePath = [self relativePathForKey:key];
+    SD_LOCK(self.indexLock);
+    NSArray<NSString *> *variantKeys = [[self loadedIndex] entryForFileName:relativePath].variantKeys ?: [self.pendingVariantKeys objectForKey:relativePath];
+    SD_UNLOCK(self.indexLock);
+    return variantKeys ?: @[];
 }
 
 - (nullable NSString *)cachePathForKey:(NSString *)key {
@@ -220,28 +457,297 @@
 }
 
 - (NSUInteger)totalSize {
-    NSUInteger size = 0;
-    NSDirectoryEnumerator *fileEnumerator = [self.fileManager enumeratorAtPath:self.diskCachePath];
-    for (NSString *fileName in fileEnumerator) {
-        NSString *filePath = [self.diskCachePath stringByAppendingPathComponent:fileName];
-        NSDictionary<NSString *, id> *attrs = [self.fileManager attributesOfItemAtPath:filePath error:nil];
-        size += [attrs fileSize];
-    }
+    SD_LOCK(self.indexLock);
+    NSUInteger size = [self loadedIndex].totalSize;
+    SD_UNLOCK(self.indexLock);
     return size;
 }
 
 - (NSUInteger)totalCount {
-    NSUInteger count = 0;
-    NSDirectoryEnumerator *fileEnumerator = [self.fileManager enumeratorAtPath:self.diskCachePath];
-    count = fileEnumerator.allObjects.count;
+    SD_LOCK(self.indexLock);
+    NSUInteger count = [self loadedIndex].totalCount;
+    SD_UNLOCK(self.indexLock);
     return count;
 }
 
+#pragma mark - Index
+
+// Make sure to call with `indexLock` held
+- (SDDiskCacheIndex *)loadedIndex {
+    if (!self.indexLoaded) {
+        if (![self.index load]) {
+            // No valid index (first launch or upgraded from old version), walk the directory once to rebuild it
+            // 没有有效的索引（首次启动或从旧版本升级），遍历一次目录来重建索引
+            [self.index resetWithEntries:[self indexEntriesByEnumeratingDirectory]];
+            // The digests are unknown after rebuild, the files of keys still hold the content of their blobs
+            // 重建后摘要未知，key 的文件仍然持有其 blob 的内容
+            [self.fileManager removeItemAtPath:[self.diskCachePath stringByAppendingPathComponent:kSDDiskCacheBlobDirectoryName] error:nil];
+        }
+        self.indexLoaded = YES;
+    }
+    return self.index;
+}
+
+- (NSArray<SDDiskCacheIndexEntry *> *)indexEntriesByEnumeratingDirectory {
+    NSURL *diskCacheURL = [NSURL fileURLWithPath:self.diskCachePath isDirectory:YES];
+    NSArray<NSString *> *resourceKeys = @[NSURLIsDirectoryKey, NSURLContentModificationDateKey, NSURLContentAccessDateKey, NSURLFileSizeKey];
+    NSDirectoryEnumerator *fileEnumerator = [self.fileManager enumeratorAtURL:diskCacheURL
+                                                   includingPropertiesForKeys:resourceKeys
+                                                                      options:NSDirectoryEnumerationSkipsHiddenFiles
+                                                                 errorHandler:NULL];
+    NSMutableArray<SDDiskCacheIndexEntry *> *entries = [NSMutableArray array];
+    for (NSURL *fileURL in fileEnumerator) {
+        NSDictionary<NSString *, id> *resourceValues = [fileURL resourceValuesForKeys:resourceKeys error:nil];
+        // Skip directories and errors.
+        if (!resourceValues || [resourceValues[NSURLIsDirectoryKey] boolValue]) {
+            continue;
+        }
+        // The file may be in a shard directory
+        // 文件可能位于分片目录中
+        NSString *fileName = fileURL.lastPathComponent;
+        NSString *shardedPath = SDDiskCacheShardedRelativePath(fileName);
+        BOOL isSharded = shardedPath && [fileURL.path hasSuffix:[@"/" stringByAppendingString:shardedPath]];
+        SDDiskCacheIndexEntry *entry = [SDDiskCacheIndexEntry new];
+        entry.fileName = isSharded ? shardedPath : fileName;
+        entry.size = [resourceValues[NSURLFileSizeKey] unsignedIntegerValue];
+        entry.modificationTime = [resourceValues[NSURLContentModificationDateKey] timeIntervalSince1970];
+        entry.accessTime = [resourceValues[NSURLContentAccessDateKey] timeIntervalSince1970];
+        entry.format = SDImageFormatUndefined;
+        [entries addObject:entry];
+    }
+    BOOL useAccessTime = self.index.orderType == SDImageCacheConfigExpireTypeAccessDate;
+    [entries sortUsingComparator:^NSComparisonResult(SDDiskCacheIndexEntry * _Nonnull entry1, SDDiskCacheIndexEntry * _Nonnull entry2) {
+        NSTimeInterval time1 = useAccessTime ? entry1.accessTime : entry1.modificationTime;
+        NSTimeInterval time2 = useAccessTime ? entry2.accessTime : entry2.modificationTime;
+        return time1 < time2 ? NSOrderedAscending : (time1 > time2 ? NSOrderedDescending : NSOrderedSame);
+    }];
+    return entries;
+}
+
+// Make sure to call with `indexLock` held
+- (nullable SDDiskCacheIndexEntry *)oldestIndexEntry {
+    __block SDDiskCacheIndexEntry *oldestEntry = nil;
+    [[self loadedIndex] enumerateEntriesFromOldestUsingBlock:^(SDDiskCacheIndexEntry * _Nonnull entry, BOOL * _Nonnull stop) {
+        oldestEntry = entry;
+        *stop = YES;
+    }];
+    return oldestEntry;
+}
+
+// Make sure to call with `indexLock` held
+- (void)removeFileForIndexEntry:(SDDiskCacheIndexEntry *)entry {
+    NSString *filePath = [self.diskCachePath stringByAppendingPathComponent:entry.fileName];
+    [self.fileManager removeItemAtPath:filePath error:nil];
+    [self removeIndexEntryForFileName:entry.fileName];
+}
+
+// Make sure to call with `indexLock` held. The variants are transformed from the removed file, so they are stale as well
+- (void)removeFilesForVariantKeys:(nullable NSArray<NSString *> *)variantKeys {
+    for (NSString *variantKey in variantKeys) {
+        NSString *relativePath = [self relativePathForKey:variantKey];
+        if (![self.index entryForFileName:relativePath]) {
+            continue;
+        }
+        [self.fileManager removeItemAtPath:[self.diskCachePath stringByAppendingPathComponent:relativePath] error:nil];
+        [self removeIndexEntryForFileName:relativePath];
+    }
+}
+
+// Make sure to call with `indexLock` held
+- (void)removeIndexEntryForFileName:(NSString *)fileName {
+    SDDiskCacheIndex *index = [self loadedIndex];
+    NSData *digest = [index entryForFileName:fileName].digest;
+    [index removeEntryForFileName:fileName];
+    [self releaseBlobForDigest:digest];
+}
+
+#pragma mark - Deduplication
+
+- (nonnull NSString *)blobPathForDigest:(nonnull NSData *)digest {
+    NSString *fileName = SDDiskCacheFileNameWithDigest(digest.bytes, nil);
+    return [[self.diskCachePath stringByAppendingPathComponent:kSDDiskCacheBlobDirectoryName] stringByAppendingPathComponent:SDDiskCacheShardedRelativePath(fileName)];
+}
+
+// Store the data as the blob named by its digest if not exists, and hard link the file of key to it. Return nil if failed, the data should be written to the file of key as usual
+- (nullable NSData *)linkBlobForData:(nonnull NSData *)data toRelativePath:(nonnull NSString *)relativePath {
+    unsigned char sha[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256(data.bytes, (CC_LONG)data.length, sha);
+    NSData *digest = [NSData dataWithBytes:sha length:SDDiskCacheIndexDigestLength];
+    NSString *blobPath = [self blobPathForDigest:digest];
+    // The blob is never modified after written, because its name is the digest of content
+    // blob 写入后不会被修改，因为它的名字就是内容的摘要
+    if (![self.fileManager fileExistsAtPath:blobPath]) {
+        if (![data writeToFile:blobPath options:NSDataWritingAtomic error:nil]) {
+            if (![self.fileManager createDirectoryAtPath:blobPath.stringByDeletingLastPathComponent withIntermediateDirectories:YES attributes:nil error:NULL] || ![data writeToFile:blobPath options:NSDataWritingAtomic error:nil]) {
+                return nil;
+            }
+        }
+    }
+    // The blob may be removed meanwhile when its last key is removed, then the link fails
+    // 当 blob 的最后一个 key 被删除时，blob 可能同时被删除，此时链接会失败
+    NSString *filePath = [self.diskCachePath stringByAppendingPathComponent:relativePath];
+    [self.fileManager removeItemAtPath:filePath error:nil];
+    if (![self.fileManager linkItemAtPath:blobPath toPath:filePath error:nil]) {
+        if (![self createParentDirectoryForRelativePath:relativePath] || ![self.fileManager linkItemAtPath:blobPath toPath:filePath error:nil]) {
+            return nil;
+        }
+    }
+    return digest;
+}
+
+// Make sure to call with `indexLock` held. Remove the blob if no entry refers to it, the files linked to it are not affected
+- (void)releaseBlobForDigest:(nullable NSData *)digest {
+    if (!digest || [self.index referenceCountForDigest:digest] > 0) {
+        return;
+    }
+    [self.fileManager removeItemAtPath:[self blobPathForDigest:digest] error:nil];
+}
+
+#pragma mark - Directory Layout
+
+- (BOOL)createParentDirectoryForRelativePath:(nonnull NSString *)relativePath {
+    NSString *directory = [self.diskCachePath stringByAppendingPathComponent:relativePath.stringByDeletingLastPathComponent];
+    return [self.fileManager createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:NULL];
+}
+
+- (nonnull NSString *)relativePathForFileName:(nonnull NSString *)fileName layout:(SDImageCacheConfigDirectoryLayout)layout {
+    if (layout == SDImageCacheConfigDirectoryLayoutSharded) {
+        return SDDiskCacheShardedRelativePath(fileName) ?: fileName;
+    }
+    return fileName;
+}
+
+- (BOOL)migrateDirectoryLayoutWithLimit:(NSUInteger)limit {
+    SD_LOCK(self.indexLock);
+    if (!self.layoutMigrationPaths) {
+        // Collect once, the files written later are always in current layout
+        // 只收集一次，之后写入的文件总是使用当前布局
+        NSMutableArray<NSString *> *paths = [NSMutableArray array];
+        SDImageCacheConfigDirectoryLayout layout = self.config.diskCacheDirectoryLayout;
+        [[self loadedIndex] enumerateEntriesFromOldestUsingBlock:^(SDDiskCacheIndexEntry * _Nonnull entry, BOOL * _Nonnull stop) {
+            NSString *relativePath = [self relativePathForFileName:entry.fileName.lastPathComponent layout:layout];
+            if (![relativePath isEqualToString:entry.fileName]) {
+                [paths addObject:entry.fileName];
+            }
+        }];
+        self.layoutMigrationPaths = paths;
+    }
+    NSRange range = NSMakeRange(0, MIN(limit, self.layoutMigrationPaths.count));
+    NSArray<NSString *> *paths = [self.layoutMigrationPaths subarrayWithRange:range];
+    [self.layoutMigrationPaths removeObjectsInRange:range];
+    BOOL finished = self.layoutMigrationPaths.count == 0;
+    SD_UNLOCK(self.indexLock);
+    
+    // Each move is renamed in index without changing its position, see `moveRelativePath:toRelativePath:`
+    // 每次移动都在索引中重命名，不改变其位置，参见 `moveRelativePath:toRelativePath:`
+    for (NSString *path in paths) {
+        NSString *relativePath = [self relativePathForFileName:path.lastPathComponent layout:self.config.diskCacheDirectoryLayout];
+        [self moveRelativePath:path toRelativePath:relativePath];
+    }
+    // The moves are journaled, only fold them into snapshot when finished
+    // 移动操作已记录在日志中，只在完成时合并到快照
+    if (finished && paths.count > 0) {
+        SD_LOCK(self.indexLock);
+        [self.index synchronize];
+        SD_UNLOCK(self.indexLock);
+    }
+    return !finished;
+}
+
+- (void)enumerateOldestDataWithLimit:(NSUInteger)limit usingBlock:(void (^)(NSUInteger, NSTimeInterval))block {
+    NSParameterAssert(block);
+    SD_LOCK(self.indexLock);
+    SDDiskCacheIndex *index = [self loadedIndex];
+    BOOL useAccessTime = index.orderType == SDImageCacheConfigExpireTypeAccessDate;
+    __block NSUInteger count = 0;
+    [index enumerateEntriesFromOldestUsingBlock:^(SDDiskCacheIndexEntry * _Nonnull entry, BOOL * _Nonnull stop) {
+        if (count >= limit) {
+            *stop = YES;
+            return;
+        }
+        block(entry.size, useAccessTime ? entry.accessTime : entry.modificationTime);
+        count++;
+    }];
+    SD_UNLOCK(self.indexLock);
+}
+
+- (BOOL)removeOldestData {
+    SD_LOCK(self.indexLock);
+    SDDiskCacheIndexEntry *entry = [self oldestIndexEntry];
+    if (entry) {
+        NSArray<NSString *> *variantKeys = entry.variantKeys;
+        [self removeFileForIndexEntry:entry];
+        [self removeFilesForVariantKeys:variantKeys];
+    }
+    SD_UNLOCK(self.indexLock);
+    return entry != nil;
+}
+
 #pragma mark - Cache paths
 
 - (nullable NSString *)cachePathForKey:(nullable NSString *)key inPath:(nonnull NSString *)path {
-    NSString *filename = SDDiskCacheFileNameForKey(key);
-    return [path stringByAppendingPathComponent:filename];
+    return [path stringByAppendingPathComponent:[self relativePathForKey:key]];
+}
+
+// The path relative to cache directory, in current directory layout
+- (nonnull NSString *)relativePathForKey:(nullable NSString *)key {
+    if (!key) {
+        key = @"";
+    }
+    NSString *relativePath = [self.relativePathCache objectForKey:key];
+    if (!relativePath) {
+        NSString *fileName;
+        if (self.config.diskCacheFileNameType == SDImageCacheConfigFileNameTypeMD5) {
+            fileName = SDDiskCacheMD5FileNameForKey(key);
+        } else {
+            fileName = SDDiskCacheFastFileNameForKey(key);
+        }
+        relativePath = [self relativePathForFileName:fileName layout:self.config.diskCacheDirectoryLayout];
+        [self.relativePathCache setObject:relativePath forKey:key];
+    }
+    return relativePath;
+}
+
+// Return the legacy relative path of key which exists in disk cache, including the legacy file names and the other directory layout. The index is used instead of file system, so a miss is cheap
+- (nullable NSString *)legacyRelativePathForKey:(nonnull NSString *)key {
+    NSString *relativePath = [self relativePathForKey:key];
+    NSString *md5FileName = SDDiskCacheMD5FileNameForKey(key);
+    // The file named by MD5, and without the extension because of https://github.com/rs/SDWebImage/pull/976 that added the extension to the disk file name
+    // 使用 MD5 命名的文件，以及由于 https://github.com/rs/SDWebImage/pull/976 添加了磁盘文件名的扩展名，没有扩展名的文件
+    NSArray<NSString *> *fileNames = @[relativePath.lastPathComponent, md5FileName, md5FileName.stringByDeletingPathExtension];
+    NSString *legacyRelativePath = nil;
+    SD_LOCK(self.indexLock);
+    SDDiskCacheIndex *index = [self loadedIndex];
+    for (NSString *fileName in fileNames) {
+        for (NSString *candidate in @[[self relativePathForFileName:fileName layout:SDImageCacheConfigDirectoryLayoutFlat], [self relativePathForFileName:fileName layout:SDImageCacheConfigDirectoryLayoutSharded]]) {
+            if (![candidate isEqualToString:relativePath] && [index entryForFileName:candidate]) {
+                legacyRelativePath = candidate;
+                break;
+            }
+        }
+        if (legacyRelativePath) {
+            break;
+        }
+    }
+    SD_UNLOCK(self.indexLock);
+    return legacyRelativePath;
+}
+
+- (void)moveRelativePath:(nonnull NSString *)srcRelativePath toRelativePath:(nonnull NSString *)dstRelativePath {
+    NSString *srcPath = [self.diskCachePath stringByAppendingPathComponent:srcRelativePath];
+    NSString *dstPath = [self.diskCachePath stringByAppendingPathComponent:dstRelativePath];
+    if (![self.fileManager moveItemAtPath:srcPath toPath:dstPath error:nil]) {
+        // The shard directory may not exist yet
+        // 分片目录可能还不存在
+        if (![self createParentDirectoryForRelativePath:dstRelativePath] || ![self.fileManager moveItemAtPath:srcPath toPath:dstPath error:nil]) {
+            return;
+        }
+    }
+    // The file is not written, keep its position in the order of expiration
+    // 文件没有被写入，保持它在过期顺序中的位置
+    SD_LOCK(self.indexLock);
+    [[self loadedIndex] renameEntryForFileName:srcRelativePath toFileName:dstRelativePath];
+    SD_UNLOCK(self.indexLock);
 }
 
 - (void)moveCacheDirectoryFromPath:(nonnull NSString *)srcPath toPath:(nonnull NSString *)dstPath {
@@ -275,18 +781,77 @@
         NSDirectoryEnumerator *dirEnumerator = [self.fileManager enumeratorAtPath:srcPath];
         NSString *file;
         while ((file = [dirEnumerator nextObject])) {
+            // The old index does not describe the merged directory
+            if ([SDDiskCacheIndex isIndexFileName:file]) {
+                continue;
+            }
+            // Merge the shard directory which exists in both, its files are enumerated later
+            // 合并两边都存在的分片目录，其中的文件会在之后被遍历
+            BOOL isDstDirectory;
+            if ([self.fileManager fileExistsAtPath:[dstPath stringByAppendingPathComponent:file] isDirectory:&isDstDirectory] && isDstDirectory) {
+                continue;
+            }
             [self.fileManager moveItemAtPath:[srcPath stringByAppendingPathComponent:file] toPath:[dstPath stringByAppendingPathComponent:file] error:nil];
+            if ([dirEnumerator.fileAttributes[NSFileType] isEqualToString:NSFileTypeDirectory]) {
+                [dirEnumerator skipDescendants];
+            }
         }
         // Remove the old path
         [self.fileManager removeItemAtPath:srcPath error:nil];
     }
+    // The files changed without the index, rebuild it on next use
+    // 文件在索引之外被修改，下次使用时重建索引
+    if ([srcPath isEqualToString:self.diskCachePath] || [dstPath isEqualToString:self.diskCachePath]) {
+        SD_LOCK(self.indexLock);
+        [self.index invalidate];
+        self.indexLoaded = NO;
+        self.layoutMigrationPaths = nil;
+        SD_UNLOCK(self.indexLock);
+    }
+}
+
+#pragma mark - Variants
+
+// Append the keys not in `variantKeys` yet, keep the order
+static NSArray<NSString *> * _Nonnull SDDiskCacheMergedVariantKeys(NSArray<NSString *> * _Nullable variantKeys, NSArray<NSString *> * _Nonnull addedKeys) {
+    NSMutableOrderedSet<NSString *> *keys = [NSMutableOrderedSet orderedSetWithArray:variantKeys ?: @[]];
+    [keys addObjectsFromArray:addedKeys];
+    return keys.array;
 }
 
 #pragma mark - Hash
 
 #define SD_MAX_FILE_EXTENSION_LENGTH (NAME_MAX - CC_MD5_DIGEST_LENGTH * 2 - 1)
 
-static inline NSString * _Nonnull SDDiskCacheFileNameForKey(NSString * _Nullable key) {
+// Encode the 16 bytes digest as lowercase hex, and append the extension
+static inline NSString * _Nonnull SDDiskCacheFileNameWithDigest(const unsigned char * _Nonnull digest, NSString * _Nullable ext) {
+    static const char kHexDigits[] = "0123456789abcdef";
+    char hex[CC_MD5_DIGEST_LENGTH * 2];
+    for (size_t i = 0; i < CC_MD5_DIGEST_LENGTH; i++) {
+        hex[i * 2] = kHexDigits[digest[i] >> 4];
+        hex[i * 2 + 1] = kHexDigits[digest[i] & 0x0F];
+    }
+    // File system has file name length limit, we need to check if ext is too long, we don't add it to the filename
+    // 文件系统有文件名长度限制，如果 ext 太长，不添加到文件名中
+    if (ext.length == 0 || ext.length > SD_MAX_FILE_EXTENSION_LENGTH) {
+        return [[NSString alloc] initWithBytes:hex length:sizeof(hex) encoding:NSASCIIStringEncoding];
+    }
+    NSMutableString *filename = [[NSMutableString alloc] initWithBytes:hex length:sizeof(hex) encoding:NSASCIIStringEncoding];
+    [filename appendString:@"."];
+    [filename appendString:ext];
+    return [filename copy];
+}
+
+// The relative path in sharded layout, the first two bytes of hash as two levels of directories, such as `ab/cd/abcd...`
+static inline NSString * _Nullable SDDiskCacheShardedRelativePath(NSString * _Nonnull fileName) {
+    if (fileName.length < 4) {
+        return nil;
+    }
+    return [NSString stringWithFormat:@"%@/%@/%@", [fileName substringToIndex:2], [fileName substringWithRange:NSMakeRange(2, 2)], fileName];
+}
+
+// The file name used by previous versions
+static inline NSString * _Nonnull SDDiskCacheMD5FileNameForKey(NSString * _Nullable key) {
     const char *str = key.UTF8String;
     if (str == NULL) {
         str = "";
@@ -297,15 +862,126 @@ static inline NSString * _Nonnull SDDiskCacheFileNameForKey(NSString * _Nullable
     CC_MD5(str, (CC_LONG)strlen(str), r);
     NSURL *keyURL = [NSURL URLWithString:key];
     NSString *ext = keyURL ? keyURL.pathExtension : key.pathExtension;
-    // File system has file name length limit, we need to check if ext is too long, we don't add it to the filename
-    // 文件系统有文件名长度限制，如果 ext 太长，不添加到文件名中
-    if (ext.length > SD_MAX_FILE_EXTENSION_LENGTH) {
-        ext = nil;
+    return SDDiskCacheFileNameWithDigest(r, ext);
+}
+
+static inline uint64_t SDRotl64(uint64_t x, int8_t r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t SDFmix64(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+// MurmurHash3 x64 128-bit, see https://github.com/aappleby/smhasher
+static void SDMurmurHash3_x64_128(const uint8_t * _Nonnull data, size_t length, uint32_t seed, unsigned char * _Nonnull digest) {
+    const size_t nblocks = length / 16;
+    const uint64_t c1 = 0x87c37b91114253d5ULL;
+    const uint64_t c2 = 0x4cf5ad432745937fULL;
+    uint64_t h1 = seed;
+    uint64_t h2 = seed;
+    
+    for (size_t i = 0; i < nblocks; i++) {
+        uint64_t k1, k2;
+        memcpy(&k1, data + i * 16, sizeof(k1));
+        memcpy(&k2, data + i * 16 + 8, sizeof(k2));
+        
+        k1 *= c1; k1 = SDRotl64(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = SDRotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+        
+        k2 *= c2; k2 = SDRotl64(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = SDRotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+    }
+    
+    const uint8_t *tail = data + nblocks * 16;
+    const size_t tailLength = length & 15;
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+    for (size_t i = tailLength; i > 8; i--) {
+        k2 ^= ((uint64_t)tail[i - 1]) << ((i - 9) * 8);
+    }
+    if (tailLength > 8) {
+        k2 *= c2; k2 = SDRotl64(k2, 33); k2 *= c1; h2 ^= k2;
     }
-    NSString *filename = [NSString stringWithFormat:@"%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%@",
-                          r[0], r[1], r[2], r[3], r[4], r[5], r[6], r[7], r[8], r[9], r[10],
-                          r[11], r[12], r[13], r[14], r[15], ext.length == 0 ? @"" : [NSString stringWithFormat:@".%@", ext]];
-    return filename;
+    for (size_t i = MIN(tailLength, 8); i > 0; i--) {
+        k1 ^= ((uint64_t)tail[i - 1]) << ((i - 1) * 8);
+    }
+    if (tailLength > 0) {
+        k1 *= c1; k1 = SDRotl64(k1, 31); k1 *= c2; h1 ^= k1;
+    }
+    
+    h1 ^= length;
+    h2 ^= length;
+    h1 += h2;
+    h2 += h1;
+    h1 = SDFmix64(h1);
+    h2 = SDFmix64(h2);
+    h1 += h2;
+    h2 += h1;
+    
+    memcpy(digest, &h1, sizeof(h1));
+    memcpy(digest + 8, &h2, sizeof(h2));
+}
+
+// The fast checksum of file content, 0 is reserved for unknown
+static inline uint64_t SDDiskCacheChecksumForData(NSData * _Nonnull data) {
+    unsigned char digest[CC_MD5_DIGEST_LENGTH];
+    SDMurmurHash3_x64_128(data.bytes, data.length, 0, digest);
+    uint64_t checksum;
+    memcpy(&checksum, digest, sizeof(checksum));
+    return checksum != 0 ? checksum : 1;
+}
+
+// The path extension of key, parsed from the UTF-8 bytes instead of creating NSURL. The query and fragment are ignored, and a URL without path has no extension
+static inline NSString * _Nullable SDDiskCacheFileExtensionForKey(const char * _Nonnull str, size_t length) {
+    size_t end = length;
+    for (size_t i = 0; i < length; i++) {
+        if (str[i] == '?' || str[i] == '#') {
+            end = i;
+            break;
+        }
+    }
+    size_t start = 0;
+    const char *scheme = strstr(str, "://");
+    if (scheme && (size_t)(scheme - str) < end) {
+        // Skip the host
+        const char *path = memchr(scheme + 3, '/', end - (scheme + 3 - str));
+        if (!path) {
+            return nil;
+        }
+        start = path - str;
+    }
+    size_t dot = end;
+    for (size_t i = end; i > start; i--) {
+        char c = str[i - 1];
+        if (c == '/') {
+            break;
+        }
+        if (c == '.') {
+            dot = i - 1;
+            break;
+        }
+    }
+    if (dot + 1 >= end) {
+        return nil;
+    }
+    return [[NSString alloc] initWithBytes:str + dot + 1 length:end - dot - 1 encoding:NSUTF8StringEncoding];
+}
+
+static inline NSString * _Nonnull SDDiskCacheFastFileNameForKey(NSString * _Nullable key) {
+    const char *str = key.UTF8String;
+    if (str == NULL) {
+        str = "";
+    }
+    size_t length = strlen(str);
+    unsigned char r[CC_MD5_DIGEST_LENGTH];
+    SDMurmurHash3_x64_128((const uint8_t *)str, length, 0, r);
+    return SDDiskCacheFileNameWithDigest(r, SDDiskCacheFileExtensionForKey(str, length));
 }
 
 @end
@@ -7,6 +7,7 @@
  */
 
 #import "SDImageAPNGCoder.h"
+#import "SDMemoryPressureManager.h"
 #import <ImageIO/ImageIO.h>
 #import "NSData+ImageContentType.h"
 #import "UIImage+Metadata.h"
@@ -31,6 +32,10 @@ const CFStringRef kCGImagePropertyAPNGUnclampedDelayTime = (__bridge CFStringRef
 @implementation SDAPNGCoderFrame
 @end
 
+@interface SDImageAPNGCoder () <SDMemoryPressureSubscriber>
+
+@end
+
 @implementation SDImageAPNGCoder {
     size_t _width, _height;
     CGImageSourceRef _imageSource;
@@ -48,15 +53,13 @@ const CFStringRef kCGImagePropertyAPNGUnclampedDelayTime = (__bridge CFStringRef
         CFRelease(_imageSource);
         _imageSource = NULL;
     }
-#if SD_UIKIT
-    [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
-#endif
 }
 
-- (void)didReceiveMemoryWarning:(NSNotification *)notification
+- (void)trimToFraction:(double)fraction
 {
     if (_imageSource) {
-        for (size_t i = 0; i < _frameCount; i++) {
+        // Keep the cache of the leading frames
+        for (size_t i = (size_t)(_frameCount * fraction); i < _frameCount; i++) {
             CGImageSourceRemoveCacheAtIndex(_imageSource, i);
         }
     }
@@ -253,9 +256,7 @@ const CFStringRef kCGImagePropertyAPNGUnclampedDelayTime = (__bridge CFStringRef
             scale = MAX([scaleFactor doubleValue], 1);
         }
         _scale = scale;
-#if SD_UIKIT
-        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(didReceiveMemoryWarning:) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
-#endif
+        [[SDMemoryPressureManager sharedManager] addSubscriber:self];
     }
     return self;
 }
@@ -338,9 +339,7 @@ const CFStringRef kCGImagePropertyAPNGUnclampedDelayTime = (__bridge CFStringRef
         _scale = scale;
         _imageSource = imageSource;
         _imageData = data;
-#if SD_UIKIT
-        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(didReceiveMemoryWarning:) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
-#endif
+        [[SDMemoryPressureManager sharedManager] addSubscriber:self];
     }
     return self;
 }
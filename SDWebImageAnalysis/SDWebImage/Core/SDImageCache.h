@@ -49,8 +49,18 @@ typedef NS_OPTIONS(NSUInteger, SDImageCacheOptions) {
     // 使用此选项，可以确保我们始终使用你提供的 class 生成图像。如果失败，将使用代码为 `SDWebImageErrorBadImageData` 的错误。
     // 注意这个选项与 `SDImageCacheDecodeFirstFrameOnly` 不兼容，后者始终生成 UIImage/NSImage。
     SDImageCacheMatchAnimatedImageClass = 1 << 7,
+    // By default, the image decoded from disk cache is stored into memory cache, so the next query hits memory. This flag avoids it, for the image which is only used once, like the original image queried to be transformed. The memory cache is still checked.
+    // 默认情况下，从磁盘缓存解码的图像会存储到内存缓存中，以便下一次查询命中内存。此标识可以避免这样做，适用于只使用一次的图像，例如查询后用于转换的原始图像。内存缓存仍然会被检查。
+    SDImageCacheAvoidMemoryCache = 1 << 8,
 };
 
+// A batch of images found by a batch query, keyed by the query key. `cacheType` is `SDImageCacheTypeMemory` or `SDImageCacheTypeDisk`.
+// 批量查询得到的一批图像，以查询的 key 为键。`cacheType` 为 `SDImageCacheTypeMemory` 或 `SDImageCacheTypeDisk`。
+typedef void(^SDImageCacheBatchQueryProgressBlock)(NSDictionary<NSString *, UIImage *> * _Nonnull images, SDImageCacheType cacheType);
+// All the images found by a batch query, and the keys not found in both memory and disk cache, in the order of query keys.
+// 批量查询得到的所有图像，以及内存和磁盘缓存中都没有找到的 key，按照查询 key 的顺序排列。
+typedef void(^SDImageCacheBatchQueryCompletionBlock)(NSDictionary<NSString *, UIImage *> * _Nonnull images, NSArray<NSString *> * _Nonnull missingKeys);
+
 // SDImageCache maintains a memory cache and a disk cache. Disk cache write operations are performed asynchronous so it doesn’t add unnecessary latency to the UI.
 // SDImageCache 维护一个内存缓存和一个磁盘缓存。磁盘缓存写入操作是异步执行的，因此不会给 UI 增加不必要的延迟。
 @interface SDImageCache : NSObject
@@ -262,6 +272,26 @@ typedef NS_OPTIONS(NSUInteger, SDImageCacheOptions) {
  */
 - (nullable NSOperation *)queryCacheOperationForKey:(nullable NSString *)key options:(SDImageCacheOptions)options context:(nullable SDWebImageContext *)context done:(nullable SDImageCacheQueryCompletionBlock)doneBlock;
 
+/**
+ * Asynchronously queries the cache for many keys at once, such as the visible cells of a collection view.
+ * The memory cache is checked for all the keys in one pass, and the memory hits are delivered by one progress call. The disk misses are read as one batch, and decoded in parallel. The disk hits are coalesced, so each callback delivers all the images decoded since the previous one.
+ * All the callbacks are called on main queue, the memory hits are delivered synchronously when this is called from main queue.
+ * The image data is not queried, so `SDImageCacheQueryMemoryData`, `SDImageCacheQueryMemoryDataSync` and `SDImageCacheQueryDiskDataSync` are ignored.
+ * 一次查询多个 key 的缓存，例如 collection view 中可见的 cell。
+ * 一次遍历检查所有 key 的内存缓存，内存命中通过一次 progress 回调返回。内存未命中的 key 作为一个批次从磁盘读取，并行解码。磁盘命中会被合并，每次回调都会返回上一次回调之后解码的所有图像。
+ * 所有回调都在主队列中调用，从主队列调用此方法时内存命中会同步返回。
+ * 不会查询图像数据，因此会忽略 `SDImageCacheQueryMemoryData`、`SDImageCacheQueryMemoryDataSync` 和 `SDImageCacheQueryDiskDataSync`。
+ *
+ * @param keys            The unique keys used to store the wanted images
+ * @param options         A mask to specify options to use for this cache query
+ * @param context         A context contains different options to perform specify changes or processes, see `SDWebImageContextOption`. This hold the extra objects which `options` enum can not hold.
+ * @param progressBlock   The block called with each batch of found images. Will not get called after the operation is cancelled
+ * @param completionBlock The completion block. Always called once, if the operation is cancelled, the keys not found before are in the missing keys
+ *
+ * @return a NSOperation instance containing the cache op, or nil if all the keys hit the memory cache
+ */
+- (nullable NSOperation *)queryImagesForKeys:(nonnull NSArray<NSString *> *)keys options:(SDImageCacheOptions)options context:(nullable SDWebImageContext *)context progress:(nullable SDImageCacheBatchQueryProgressBlock)progressBlock completion:(nullable SDImageCacheBatchQueryCompletionBlock)completionBlock;
+
 /**
  * Synchronously query the memory cache.
  *
@@ -288,6 +318,11 @@ typedef NS_OPTIONS(NSUInteger, SDImageCacheOptions) {
 
 #pragma mark - Remove Ops
 
+// The removal of an image also removes its variants, which are the images transformed from it by the transformers queried with this cache (see `SDImageTransformer`). The variants are derived from the removed image, so they are stale as well.
+// When a variant is stored to disk, the disk cache persists its link to the original image if supported (see `addVariantKey:forKey:` in `SDDiskCache`), and the removal finds the variants by this link. So the variants are removed even after relaunch, and the built-in disk cache removes them when the original image expires or is trimmed by size. A variant stored only in memory is not linked, it's left to the memory cache eviction.
+// 删除图像时也会删除它的变体，即通过此缓存查询过的转换器从它转换得到的图像（参见 `SDImageTransformer`）。变体派生自被删除的图像，因此它们也已过时。
+// 变体存储到磁盘时，如果磁盘缓存支持，会持久化它与原始图像的关联（参见 `SDDiskCache` 的 `addVariantKey:forKey:`），删除时通过该关联查找变体。因此即使在重新启动后变体也会被删除，并且内置磁盘缓存会在原始图像过期或按大小裁剪时删除它们。仅存储在内存中的变体没有关联，由内存缓存的淘汰处理。
+
 /**
  * Asynchronously remove the image from memory and disk cache
  *
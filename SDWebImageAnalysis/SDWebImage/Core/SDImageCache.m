@@ -14,19 +14,32 @@
 #import "SDAnimatedImage.h"
 #import "UIImage+MemoryCacheCost.h"
 #import "UIImage+Metadata.h"
+#import "SDImageCacheIOScheduler.h"
+#import "SDImageCacheWriteBuffer.h"
+#import "SDImageCacheHotKeys.h"
+#import "SDDiskBudgetManager.h"
+#import "SDInternalMacros.h"
 
-@interface SDImageCache ()
+@interface SDImageCache () <SDDiskBudgetParticipant>
 
 #pragma mark - Properties
 @property (nonatomic, strong, readwrite, nonnull) id<SDMemoryCache> memoryCache;
 @property (nonatomic, strong, readwrite, nonnull) id<SDDiskCache> diskCache;
 @property (nonatomic, copy, readwrite, nonnull) SDImageCacheConfig *config;
 @property (nonatomic, copy, readwrite, nonnull) NSString *diskCachePath;
-@property (nonatomic, strong, nullable) dispatch_queue_t ioQueue;
+@property (nonatomic, strong, nonnull) SDImageCacheIOScheduler *ioScheduler;
+@property (nonatomic, strong, nullable) SDImageCacheWriteBuffer *writeBuffer; // nil if `diskCacheWriteBufferSize` is 0
+@property (nonatomic, strong, nullable) NSCache<NSString *, NSData *> *memoryDataCache; // nil if `maxMemoryDataCost` is 0
+@property (nonatomic, strong, nullable) SDImageCacheHotKeys *hotKeys; // nil if `warmStartKeyCount` is 0
+@property (nonatomic, strong, nonnull) NSCache<NSString *, NSString *> *variantBaseKeys; // variant key -> the key it's transformed from, recorded by query and persisted in disk cache when the variant is stored
 
 @end
 
 
+static const NSUInteger kDiskCacheLayoutMigrationBatchCount = 100;
+static const NSUInteger kDiskCacheExpirationBatchCount = 100;
+static const NSTimeInterval kDiskCacheExpirationSliceDuration = 0.01; // 10ms
+
 @implementation SDImageCache
 
 #pragma mark - Singleton, init, dealloc
@@ -59,19 +72,34 @@
     if ((self = [super init])) {
         NSAssert(ns, @"Cache namespace should not be nil");
         
-        // Create IO serial queue
-        // 创建 IO 串行队列
-        _ioQueue = dispatch_queue_create("com.hackemist.SDImageCache", DISPATCH_QUEUE_SERIAL);
-        
         if (!config) {
             config = SDImageCacheConfig.defaultCacheConfig;
         }
         _config = [config copy];
         
+        // Create IO scheduler, operations of the same key run in order, different keys run concurrently
+        // 创建 IO 调度器，同一个 key 的操作按顺序执行，不同 key 的操作并发执行
+        _ioScheduler = [[SDImageCacheIOScheduler alloc] initWithMaxConcurrentCount:_config.maxConcurrentDiskOperationCount];
+        if (_config.diskCacheWriteBufferSize > 0) {
+            _writeBuffer = [SDImageCacheWriteBuffer new];
+        }
+        
         // Init the memory cache
         // 初始化内存缓存
         NSAssert([config.memoryCacheClass conformsToProtocol:@protocol(SDMemoryCache)], @"Custom memory cache class must conform to `SDMemoryCache` protocol");
         _memoryCache = [[config.memoryCacheClass alloc] initWithConfig:_config];
+        // The encoded data tier, between the memory cache and disk cache
+        // 编码数据层，位于内存缓存和磁盘缓存之间
+        if (_config.maxMemoryDataCost > 0) {
+            _memoryDataCache = [[NSCache alloc] init];
+            _memoryDataCache.name = [NSString stringWithFormat:@"com.hackemist.SDImageCache.data.%@", ns];
+            _memoryDataCache.totalCostLimit = _config.maxMemoryDataCost;
+        }
+        _variantBaseKeys = [NSCache new];
+        _variantBaseKeys.countLimit = 1000;
+        if (_config.warmStartKeyCount > 0) {
+            _hotKeys = [[SDImageCacheHotKeys alloc] initWithCapacity:_config.warmStartKeyCount];
+        }
         
         // Init the disk cache
         // 初始化磁盘缓存
@@ -88,6 +116,18 @@
         // Check and migrate disk cache directory if need
         // 检查并迁移磁盘缓存目录
         [self migrateDiskCacheDirectory];
+        // Move the files to current directory layout in background
+        // 在后台将文件移动到当前的目录布局
+        [self migrateDiskCacheDirectoryLayout];
+        // Decode the hottest images of last launch in background
+        // 在后台解码上次启动时最热的图像
+        [self warmStartIfNeeded];
+        // Share the device-wide disk budget with other namespaces. The custom disk cache can not be evicted by the budget, so it's not counted
+        // 与其他命名空间共享设备范围的磁盘预算。自定义磁盘缓存无法被预算淘汰，因此不计入预算
+        if ([_diskCache isKindOfClass:[SDDiskCache class]]) {
+            [[SDDiskBudgetManager sharedManager] addParticipant:self];
+            [[SDDiskBudgetManager sharedManager] setNeedsEnforceDiskBudget];
+        }
 
 #if SD_UIKIT
         // Subscribe to app events
@@ -140,13 +180,31 @@
             NSString *newDefaultPath = [[[self userCacheDirectory] stringByAppendingPathComponent:@"com.hackemist.SDImageCache"] stringByAppendingPathComponent:@"default"];
             // ~/Library/Caches/default/com.hackemist.SDWebImageCache.default/
             NSString *oldDefaultPath = [[[self userCacheDirectory] stringByAppendingPathComponent:@"default"] stringByAppendingPathComponent:@"com.hackemist.SDWebImageCache.default"];
-            dispatch_async(self.ioQueue, ^{
+            [self.ioScheduler dispatchAsyncWithType:SDImageCacheIOTypeBarrier key:nil block:^{
                 [((SDDiskCache *)self.diskCache) moveCacheDirectoryFromPath:oldDefaultPath toPath:newDefaultPath];
-            });
+            }];
         });
     }
 }
 
+- (void)migrateDiskCacheDirectoryLayout {
+    if (![self.diskCache isKindOfClass:[SDDiskCache class]]) {
+        return;
+    }
+    // Move a few files each time, so the other operations are not blocked for long
+    // 每次只移动少量文件，这样其他操作不会被长时间阻塞
+    __weak typeof(self) wself = self;
+    [self.ioScheduler dispatchAsyncWithType:SDImageCacheIOTypeMaintenance key:nil block:^{
+        __strong typeof(wself) sself = wself;
+        if (!sself) {
+            return;
+        }
+        if ([((SDDiskCache *)sself.diskCache) migrateDirectoryLayoutWithLimit:kDiskCacheLayoutMigrationBatchCount]) {
+            [sself migrateDiskCacheDirectoryLayout];
+        }
+    }];
+}
+
 #pragma mark - Store Ops
 
 - (void)storeImage:(nullable UIImage *)image
@@ -186,22 +244,31 @@
     if (toMemory && self.config.shouldCacheImagesInMemory) {
         NSUInteger cost = image.sd_memoryCost;
         [self.memoryCache setObject:image forKey:key cost:cost];
+        [self.hotKeys recordKey:key];
+    }
+    // Keep the data tier consistent with the disk
+    // 保持数据层与磁盘一致
+    if (toMemory && imageData) {
+        [self storeImageDataToMemory:imageData forKey:key];
+    } else if (toDisk) {
+        [self.memoryDataCache removeObjectForKey:key];
     }
     
-    if (toDisk) {
-        dispatch_async(self.ioQueue, ^{
+    if (toDisk && self.writeBuffer) {
+        // Write behind, the buffered image can be queried until it's written
+        // 延迟写入，缓冲中的图像在写入之前也可以被查询
+        NSUInteger cost = imageData ? imageData.length : image.sd_memoryCost;
+        [self.writeBuffer setEntry:[[SDImageCacheWriteBufferEntry alloc] initWithKey:key image:image data:imageData cost:cost]];
+        [self scheduleWriteBufferFlush];
+        if (completionBlock) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                completionBlock();
+            });
+        }
+    } else if (toDisk) {
+        [self.ioScheduler dispatchAsyncWithType:SDImageCacheIOTypeWrite key:key block:^{
             @autoreleasepool {
-                NSData *data = imageData;
-                if (!data && image) {
-                    // If we do not have any data to detect image format, check whether it contains alpha channel to use PNG or JPEG format
-                    SDImageFormat format;
-                    if ([SDImageCoderHelper CGImageContainsAlpha:image.CGImage]) {
-                        format = SDImageFormatPNG;
-                    } else {
-                        format = SDImageFormatJPEG;
-                    }
-                    data = [[SDImageCodersManager sharedManager] encodedDataWithImage:image format:format options:nil];
-                }
+                NSData *data = imageData ?: [self encodedDataWithImage:image];
                 [self _storeImageDataToDisk:data forKey:key];
             }
             
@@ -210,7 +277,7 @@
                     completionBlock();
                 });
             }
-        });
+        }];
     } else {
         if (completionBlock) {
             completionBlock();
@@ -232,9 +299,31 @@
         return;
     }
     
-    dispatch_sync(self.ioQueue, ^{
+    // The buffered store is superseded
+    [self.writeBuffer removeEntryForKey:key];
+    [self.memoryDataCache removeObjectForKey:key];
+    [self.ioScheduler dispatchSyncWithType:SDImageCacheIOTypeWrite key:key block:^{
         [self _storeImageDataToDisk:imageData forKey:key];
-    });
+    }];
+}
+
+- (void)storeImageDataToMemory:(nullable NSData *)imageData forKey:(nullable NSString *)key {
+    if (!self.memoryDataCache || !imageData || !key) {
+        return;
+    }
+    [self.memoryDataCache setObject:imageData forKey:key cost:imageData.length];
+}
+
+// Whether the data read from the built-in disk cache may be memory mapped, see `diskCacheMappedReadingThreshold`
+- (BOOL)isMappedDiskData:(nonnull NSData *)data {
+    if (![self.diskCache isKindOfClass:[SDDiskCache class]]) {
+        return NO;
+    }
+    if (self.config.diskCacheReadingOptions & (NSDataReadingMappedIfSafe | NSDataReadingMappedAlways)) {
+        return YES;
+    }
+    NSUInteger threshold = self.config.diskCacheMappedReadingThreshold;
+    return threshold > 0 && (self.config.diskCacheWritingOptions & NSDataWritingAtomic) && data.length >= threshold;
 }
 
 // Make sure to call form io queue by caller
@@ -244,19 +333,105 @@
     }
     
     [self.diskCache setData:imageData forKey:key];
+    // Link the variant to the image it's transformed from, so the removal and expiration of that image remove it even after relaunch
+    // 将变体关联到它转换自的图像，这样即使在重新启动后，该图像的删除和过期也会删除它
+    NSString *baseKey = [self.variantBaseKeys objectForKey:key];
+    if (baseKey && [self.diskCache respondsToSelector:@selector(addVariantKey:forKey:)]) {
+        [self.diskCache addVariantKey:key forKey:baseKey];
+    }
+    [[SDDiskBudgetManager sharedManager] setNeedsEnforceDiskBudget];
+}
+
+- (nullable NSData *)encodedDataWithImage:(nullable UIImage *)image {
+    if (!image) {
+        return nil;
+    }
+    // If we do not have any data to detect image format, check whether it contains alpha channel to use PNG or JPEG format
+    SDImageFormat format;
+    if ([SDImageCoderHelper CGImageContainsAlpha:image.CGImage]) {
+        format = SDImageFormatPNG;
+    } else {
+        format = SDImageFormatJPEG;
+    }
+    return [[SDImageCodersManager sharedManager] encodedDataWithImage:image format:format options:nil];
+}
+
+#pragma mark - Write Buffer
+
+- (void)scheduleWriteBufferFlush {
+    if (self.writeBuffer.pendingCost >= self.config.diskCacheWriteBufferSize) {
+        [self flushWriteBuffer];
+    } else if ([self.writeBuffer markFlushScheduled]) {
+        __weak typeof(self) wself = self;
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(self.config.diskCacheWriteBufferInterval * NSEC_PER_SEC)), dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+            [wself flushWriteBuffer];
+        });
+    }
+}
+
+// Write the buffered stores as one batch
+- (void)flushWriteBuffer {
+    NSArray<SDImageCacheWriteBufferEntry *> *entries = [self.writeBuffer entriesToFlush];
+    if (entries.count == 0) {
+        return;
+    }
+    NSMutableDictionary<NSString *, SDImageCacheWriteBufferEntry *> *entryMap = [NSMutableDictionary dictionaryWithCapacity:entries.count];
+    for (SDImageCacheWriteBufferEntry *entry in entries) {
+        entryMap[entry.key] = entry;
+    }
+    [self.ioScheduler dispatchAsyncWithType:SDImageCacheIOTypeWrite keys:entryMap.allKeys block:^(NSArray<NSString *> * _Nonnull laneKeys) {
+        for (NSString *key in laneKeys) {
+            [self _storeWriteBufferEntry:entryMap[key]];
+        }
+    } completion:nil];
+}
+
+- (void)flushWriteBufferSynchronously {
+    NSArray<SDImageCacheWriteBufferEntry *> *entries = [self.writeBuffer entriesToFlush];
+    if (entries.count == 0) {
+        return;
+    }
+    [self.ioScheduler dispatchSyncWithType:SDImageCacheIOTypeBarrier key:nil block:^{
+        for (SDImageCacheWriteBufferEntry *entry in entries) {
+            [self _storeWriteBufferEntry:entry];
+        }
+    }];
+}
+
+// Make sure to call form io queue by caller
+- (void)_storeWriteBufferEntry:(SDImageCacheWriteBufferEntry *)entry {
+    // Drop the store superseded by a later store or remove of the same key
+    // 丢弃被同一个 key 后续的存储或删除替代的存储
+    if (![self.writeBuffer isCurrentEntry:entry]) {
+        return;
+    }
+    @autoreleasepool {
+        NSData *data = [self dataForWriteBufferEntry:entry];
+        [self _storeImageDataToDisk:data forKey:entry.key];
+    }
+    [self.writeBuffer finishFlushingEntry:entry];
+}
+
+- (nullable NSData *)dataForWriteBufferEntry:(SDImageCacheWriteBufferEntry *)entry {
+    NSData *data = entry.data;
+    if (!data) {
+        data = [self encodedDataWithImage:entry.image];
+        entry.data = data;
+    }
+    return data;
 }
 
 #pragma mark - Query and Retrieve Ops
 
 - (void)diskImageExistsWithKey:(nullable NSString *)key completion:(nullable SDImageCacheCheckCompletionBlock)completionBlock {
-    dispatch_async(self.ioQueue, ^{
+    [self.ioScheduler dispatchAsyncWithType:SDImageCacheIOTypeRead key:key block:^{
         BOOL exists = [self _diskImageDataExistsWithKey:key];
         if (completionBlock) {
             dispatch_async(dispatch_get_main_queue(), ^{
                 completionBlock(exists);
             });
         }
-    });
+    }];
 }
 
 - (BOOL)diskImageDataExistsWithKey:(nullable NSString *)key {
@@ -265,9 +440,9 @@
     }
     
     __block BOOL exists = NO;
-    dispatch_sync(self.ioQueue, ^{
+    [self.ioScheduler dispatchSyncWithType:SDImageCacheIOTypeRead key:key block:^{
         exists = [self _diskImageDataExistsWithKey:key];
-    });
+    }];
     
     return exists;
 }
@@ -278,6 +453,9 @@
         return NO;
     }
     
+    if ([self.writeBuffer entryForKey:key]) {
+        return YES;
+    }
     return [self.diskCache containsDataForKey:key];
 }
 
@@ -286,9 +464,9 @@
         return nil;
     }
     __block NSData *imageData = nil;
-    dispatch_sync(self.ioQueue, ^{
+    [self.ioScheduler dispatchSyncWithType:SDImageCacheIOTypeRead key:key block:^{
         imageData = [self diskImageDataBySearchingAllPathsForKey:key];
-    });
+    }];
     
     return imageData;
 }
@@ -324,8 +502,25 @@
         return nil;
     }
     
-    NSData *data = [self.diskCache dataForKey:key];
+    // The encoded data tier, no disk read
+    NSData *data = [self.memoryDataCache objectForKey:key];
+    if (data) {
+        return data;
+    }
+    
+    // The buffered store is not written yet
+    SDImageCacheWriteBufferEntry *bufferEntry = [self.writeBuffer entryForKey:key];
+    if (bufferEntry) {
+        return [self dataForWriteBufferEntry:bufferEntry];
+    }
+    
+    data = [self.diskCache dataForKey:key];
     if (data) {
+        // The mapped data is backed by the file, keeping it does not save a disk read, and its length is not resident memory
+        // 映射的数据由文件支持，保留它并不能省去磁盘读取，其长度也不是常驻内存
+        if (![self isMappedDiskData:data]) {
+            [self storeImageDataToMemory:data forKey:key];
+        }
         return data;
     }
     
@@ -379,34 +574,14 @@
         // grab the transformed disk image if transformer provided
         // 如果提供转换器，则获取转换后的磁盘图像
         NSString *transformerKey = [transformer transformerKey];
-        key = SDTransformedKeyForKey(key, transformerKey);
+        NSString *variantKey = SDTransformedKeyForKey(key, transformerKey);
+        [self recordVariantKey:variantKey forKey:key];
+        key = variantKey;
     }
     
     // First check the in-memory cache...
     // 1. 检查内存缓存
-    UIImage *image = [self imageFromMemoryCacheForKey:key];
-    
-    if (image) {
-        if (options & SDImageCacheDecodeFirstFrameOnly) {
-            // Ensure static image
-            // 保证静态图像
-            Class animatedImageClass = image.class;
-            if (image.sd_isAnimated || ([animatedImageClass isSubclassOfClass:[UIImage class]] && [animatedImageClass conformsToProtocol:@protocol(SDAnimatedImage)])) {
-#if SD_MAC
-                image = [[NSImage alloc] initWithCGImage:image.CGImage scale:image.scale orientation:kCGImagePropertyOrientationUp];
-#else
-                image = [[UIImage alloc] initWithCGImage:image.CGImage scale:image.scale orientation:image.imageOrientation];
-#endif
-            }
-        } else if (options & SDImageCacheMatchAnimatedImageClass) {
-            // Check image class matching
-            Class animatedImageClass = image.class;
-            Class desiredImageClass = context[SDWebImageContextAnimatedImageClass];
-            if (desiredImageClass && ![animatedImageClass isSubclassOfClass:desiredImageClass]) {
-                image = nil;
-            }
-        }
-    }
+    UIImage *image = [self imageFromMemoryCacheForKey:key options:options context:context];
 
     BOOL shouldQueryMemoryOnly = (image && !(options & SDImageCacheQueryMemoryData));
     if (shouldQueryMemoryOnly) {
@@ -416,6 +591,22 @@
         return nil;
     }
     
+    // The image data is in the data tier, no need to query disk
+    // 图像数据在数据层中，无需查询磁盘
+    NSData *memoryData = image ? [self.memoryDataCache objectForKey:key] : nil;
+    if (memoryData) {
+        if (doneBlock) {
+            if (options & SDImageCacheQueryMemoryDataSync) {
+                doneBlock(image, memoryData, SDImageCacheTypeMemory);
+            } else {
+                dispatch_async(dispatch_get_main_queue(), ^{
+                    doneBlock(image, memoryData, SDImageCacheTypeMemory);
+                });
+            }
+        }
+        return nil;
+    }
+    
     // Second check the disk cache...
     // 2. 检查磁盘缓存
     NSOperation *operation = [NSOperation new];
@@ -444,10 +635,13 @@
                 cacheType = SDImageCacheTypeDisk;
                 // decode image data only if in-memory cache missed
                 diskImage = [self diskImageForKey:key data:diskData options:options context:context];
-                if (diskImage && self.config.shouldCacheImagesInMemory) {
+                if (diskImage && self.config.shouldCacheImagesInMemory && !(options & SDImageCacheAvoidMemoryCache)) {
                     NSUInteger cost = diskImage.sd_memoryCost;
                     [self.memoryCache setObject:diskImage forKey:key cost:cost];
                 }
+                if (diskImage) {
+                    [self.hotKeys recordKey:key];
+                }
             }
             
             if (doneBlock) {
@@ -462,16 +656,165 @@
         }
     };
     
-    // Query in ioQueue to keep IO-safe
+    // Query in io scheduler to keep IO-safe, queries are scheduled before stores and removals
+    // 在 io 调度器中查询以保证 IO 安全，查询会优先于存储和删除调度
     if (shouldQueryDiskSync) {
-        dispatch_sync(self.ioQueue, queryDiskBlock);
+        [self.ioScheduler dispatchSyncWithType:SDImageCacheIOTypeRead key:key block:queryDiskBlock];
     } else {
-        dispatch_async(self.ioQueue, queryDiskBlock);
+        [self.ioScheduler dispatchAsyncWithType:SDImageCacheIOTypeRead key:key block:queryDiskBlock];
+    }
+    
+    return operation;
+}
+
+- (nullable NSOperation *)queryImagesForKeys:(nonnull NSArray<NSString *> *)keys options:(SDImageCacheOptions)options context:(nullable SDWebImageContext *)context progress:(nullable SDImageCacheBatchQueryProgressBlock)progressBlock completion:(nullable SDImageCacheBatchQueryCompletionBlock)completionBlock {
+    NSParameterAssert(keys);
+    NSMutableDictionary<NSString *, UIImage *> *images = [NSMutableDictionary dictionary];
+    id<SDImageTransformer> transformer = context[SDWebImageContextImageTransformer];
+    NSString *transformerKey = [transformer transformerKey];
+    
+    // First check the in-memory cache for all keys in one pass...
+    // 1. 一次遍历检查所有 key 的内存缓存
+    NSMutableDictionary<NSString *, NSString *> *queryKeys = [NSMutableDictionary dictionary]; // cache key -> query key of the memory misses
+    for (NSString *key in keys) {
+        NSString *cacheKey = transformer ? SDTransformedKeyForKey(key, transformerKey) : key;
+        if (transformer) {
+            [self recordVariantKey:cacheKey forKey:key];
+        }
+        UIImage *image = [self imageFromMemoryCacheForKey:cacheKey options:options context:context];
+        if (image) {
+            images[key] = image;
+        } else {
+            queryKeys[cacheKey] = key;
+        }
+    }
+    // All the callbacks are on main queue, the memory hits are delivered synchronously when called from main queue
+    // 所有回调都在主队列，从主队列调用时内存命中会同步返回
+    NSDictionary<NSString *, UIImage *> *memoryImages = [images copy];
+    if (memoryImages.count > 0 && progressBlock) {
+        dispatch_main_async_safe(^{
+            progressBlock(memoryImages, SDImageCacheTypeMemory);
+        });
+    }
+    if (queryKeys.count == 0) {
+        if (completionBlock) {
+            dispatch_main_async_safe(^{
+                completionBlock(memoryImages, @[]);
+            });
+        }
+        return nil;
     }
     
+    // Second check the disk cache as one batch, the keys are grouped by the lanes of io scheduler
+    // 2. 作为一个批次检查磁盘缓存，key 按 io 调度器的 lane 分组
+    NSArray<NSString *> *cacheKeys = queryKeys.allKeys;
+    
+    NSOperation *operation = [NSOperation new];
+    dispatch_semaphore_t lock = dispatch_semaphore_create(1);
+    NSMutableDictionary<NSString *, UIImage *> *pendingImages = [NSMutableDictionary dictionary];
+    __block BOOL deliverScheduled = NO;
+    // Deliver all the images decoded since last delivery in one main queue callback
+    // 在一次主队列回调中返回上一次回调之后解码的所有图像
+    dispatch_block_t deliverBlock = ^{
+        SD_LOCK(lock);
+        NSDictionary<NSString *, UIImage *> *batchImages = [pendingImages copy];
+        [pendingImages removeAllObjects];
+        deliverScheduled = NO;
+        SD_UNLOCK(lock);
+        if (operation.isCancelled || batchImages.count == 0) {
+            return;
+        }
+        [images addEntriesFromDictionary:batchImages];
+        if (progressBlock) {
+            progressBlock(batchImages, SDImageCacheTypeDisk);
+        }
+    };
+    
+    [self.ioScheduler dispatchAsyncWithType:SDImageCacheIOTypeRead keys:cacheKeys block:^(NSArray<NSString *> * _Nonnull laneKeys) {
+        for (NSString *cacheKey in laneKeys) {
+            if (operation.isCancelled) {
+                return;
+            }
+            @autoreleasepool {
+                NSData *diskData = [self diskImageDataBySearchingAllPathsForKey:cacheKey];
+                if (!diskData) {
+                    continue;
+                }
+                // Decoded in parallel, each lane is decoded by its own worker
+                // 并行解码，每个 lane 由各自的工作线程解码
+                UIImage *diskImage = [self diskImageForKey:cacheKey data:diskData options:options context:context];
+                if (!diskImage) {
+                    continue;
+                }
+                if (self.config.shouldCacheImagesInMemory && !(options & SDImageCacheAvoidMemoryCache)) {
+                    NSUInteger cost = diskImage.sd_memoryCost;
+                    [self.memoryCache setObject:diskImage forKey:cacheKey cost:cost];
+                }
+                [self.hotKeys recordKey:cacheKey];
+                SD_LOCK(lock);
+                pendingImages[queryKeys[cacheKey]] = diskImage;
+                BOOL shouldScheduleDeliver = !deliverScheduled;
+                deliverScheduled = YES;
+                SD_UNLOCK(lock);
+                if (shouldScheduleDeliver) {
+                    dispatch_async(dispatch_get_main_queue(), deliverBlock);
+                }
+            }
+        }
+    } completion:^{
+        // Always complete once, when cancelled the keys not delivered yet are missing, like the single query completes with nil
+        // 总是完成一次，取消时尚未返回的 key 视为缺失，与单个查询以 nil 完成相同
+        dispatch_async(dispatch_get_main_queue(), ^{
+            deliverBlock();
+            NSMutableArray<NSString *> *missingKeys = [NSMutableArray array];
+            NSMutableSet<NSString *> *visitedKeys = [NSMutableSet setWithCapacity:keys.count];
+            for (NSString *key in keys) {
+                if (!images[key] && ![visitedKeys containsObject:key]) {
+                    [missingKeys addObject:key];
+                }
+                [visitedKeys addObject:key];
+            }
+            if (completionBlock) {
+                completionBlock([images copy], [missingKeys copy]);
+            }
+        });
+    }];
+    
     return operation;
 }
 
+// Query the memory cache, and check the image class with options
+- (nullable UIImage *)imageFromMemoryCacheForKey:(nullable NSString *)key options:(SDImageCacheOptions)options context:(nullable SDWebImageContext *)context {
+    UIImage *image = [self imageFromMemoryCacheForKey:key];
+    
+    if (image) {
+        if (options & SDImageCacheDecodeFirstFrameOnly) {
+            // Ensure static image
+            // 保证静态图像
+            Class animatedImageClass = image.class;
+            if (image.sd_isAnimated || ([animatedImageClass isSubclassOfClass:[UIImage class]] && [animatedImageClass conformsToProtocol:@protocol(SDAnimatedImage)])) {
+#if SD_MAC
+                image = [[NSImage alloc] initWithCGImage:image.CGImage scale:image.scale orientation:kCGImagePropertyOrientationUp];
+#else
+                image = [[UIImage alloc] initWithCGImage:image.CGImage scale:image.scale orientation:image.imageOrientation];
+#endif
+            }
+        } else if (options & SDImageCacheMatchAnimatedImageClass) {
+            // Check image class matching
+            Class animatedImageClass = image.class;
+            Class desiredImageClass = context[SDWebImageContextAnimatedImageClass];
+            if (desiredImageClass && ![animatedImageClass isSubclassOfClass:desiredImageClass]) {
+                image = nil;
+            }
+        }
+    }
+    if (image) {
+        [self.hotKeys recordKey:key];
+    }
+    
+    return image;
+}
+
 #pragma mark - Remove Ops
 
 - (void)removeImageForKey:(nullable NSString *)key withCompletion:(nullable SDWebImageNoParamsBlock)completion {
@@ -486,13 +829,31 @@
     if (key == nil) {
         return;
     }
+    // The variants transformed from this image are stale as well, the disk removal removes them together. Otherwise find them by the link persisted in disk cache
+    // 从该图像转换得到的变体也已过时，磁盘删除会一起删除它们。否则通过磁盘缓存中持久化的关联查找它们
+    if (fromMemory && !fromDisk) {
+        [self.ioScheduler dispatchAsyncWithType:SDImageCacheIOTypeRead key:key block:^{
+            [self _removeLinkedVariantsForKey:key fromMemory:YES fromDisk:NO];
+        }];
+    }
+    [self _removeImageForKey:key fromMemory:fromMemory fromDisk:fromDisk withCompletion:completion];
+}
+
+- (void)_removeImageForKey:(nonnull NSString *)key fromMemory:(BOOL)fromMemory fromDisk:(BOOL)fromDisk withCompletion:(nullable SDWebImageNoParamsBlock)completion {
 
     if (fromMemory && self.config.shouldCacheImagesInMemory) {
         [self.memoryCache removeObjectForKey:key];
     }
+    if (fromMemory || fromDisk) {
+        [self.memoryDataCache removeObjectForKey:key];
+    }
 
     if (fromDisk) {
-        dispatch_async(self.ioQueue, ^{
+        // The buffered store is superseded
+        [self.writeBuffer removeEntryForKey:key];
+        [self.hotKeys removeKey:key];
+        [self.ioScheduler dispatchAsyncWithType:SDImageCacheIOTypeWrite key:key block:^{
+            [self _removeLinkedVariantsForKey:key fromMemory:fromMemory fromDisk:YES];
             [self.diskCache removeDataForKey:key];
             
             if (completion) {
@@ -500,7 +861,7 @@
                     completion();
                 });
             }
-        });
+        }];
     } else if (completion) {
         completion();
     }
@@ -512,15 +873,22 @@
     }
     
     [self.memoryCache removeObjectForKey:key];
+    [self.memoryDataCache removeObjectForKey:key];
+    [self.ioScheduler dispatchAsyncWithType:SDImageCacheIOTypeRead key:key block:^{
+        [self _removeLinkedVariantsForKey:key fromMemory:YES fromDisk:NO];
+    }];
 }
 
 - (void)removeImageFromDiskForKey:(NSString *)key {
     if (!key) {
         return;
     }
-    dispatch_sync(self.ioQueue, ^{
+    [self.writeBuffer removeEntryForKey:key];
+    [self.memoryDataCache removeObjectForKey:key];
+    [self.hotKeys removeKey:key];
+    [self.ioScheduler dispatchSyncWithType:SDImageCacheIOTypeWrite key:key block:^{
         [self _removeImageFromDiskForKey:key];
-    });
+    }];
 }
 
 // Make sure to call form io queue by caller
@@ -529,34 +897,168 @@
         return;
     }
     
+    [self _removeLinkedVariantsForKey:key fromMemory:NO fromDisk:YES];
     [self.diskCache removeDataForKey:key];
 }
 
+#pragma mark - Variants
+
+- (void)recordVariantKey:(nullable NSString *)variantKey forKey:(nonnull NSString *)key {
+    if (!variantKey) {
+        return;
+    }
+    [self.variantBaseKeys setObject:key forKey:variantKey];
+}
+
+// Make sure to call from io queue by caller. The variants linked in disk cache, including the ones whose transformer is not queried since launch. The disk removal of key removes their files together
+- (void)_removeLinkedVariantsForKey:(nonnull NSString *)key fromMemory:(BOOL)fromMemory fromDisk:(BOOL)fromDisk {
+    if (![self.diskCache respondsToSelector:@selector(variantKeysForKey:)]) {
+        return;
+    }
+    // Looked up in the entry of key, so the cost is bound to the variants of this image
+    // 在 key 的条目中查找，因此开销只与该图像的变体相关
+    for (NSString *variantKey in [self.diskCache variantKeysForKey:key]) {
+        if (fromMemory && self.config.shouldCacheImagesInMemory) {
+            [self.memoryCache removeObjectForKey:variantKey];
+        }
+        [self.memoryDataCache removeObjectForKey:variantKey];
+        if (fromDisk) {
+            [self.writeBuffer removeEntryForKey:variantKey];
+            [self.hotKeys removeKey:variantKey];
+        }
+    }
+}
+
 #pragma mark - Cache clean Ops
 
 - (void)clearMemory {
     [self.memoryCache removeAllObjects];
+    [self.memoryDataCache removeAllObjects];
 }
 
 - (void)clearDiskOnCompletion:(nullable SDWebImageNoParamsBlock)completion {
-    dispatch_async(self.ioQueue, ^{
+    [self.writeBuffer removeAllEntries];
+    [self.memoryDataCache removeAllObjects];
+    [self.hotKeys removeAllKeys];
+    [self.ioScheduler dispatchAsyncWithType:SDImageCacheIOTypeBarrier key:nil block:^{
         [self.diskCache removeAllData];
+        [[NSFileManager defaultManager] removeItemAtPath:[self warmStartSnapshotPath] error:nil];
         if (completion) {
             dispatch_async(dispatch_get_main_queue(), ^{
                 completion();
             });
         }
-    });
+    }];
 }
 
 - (void)deleteOldFilesWithCompletionBlock:(nullable SDWebImageNoParamsBlock)completionBlock {
-    dispatch_async(self.ioQueue, ^{
+    if ([self.diskCache respondsToSelector:@selector(removeExpiredDataWithLimit:timeLimit:)]) {
+        [self deleteOldFilesInSlicesWithCompletionBlock:completionBlock];
+        return;
+    }
+    [self.ioScheduler dispatchAsyncWithType:SDImageCacheIOTypeMaintenance key:nil block:^{
         [self.diskCache removeExpiredData];
         if (completionBlock) {
             dispatch_async(dispatch_get_main_queue(), ^{
                 completionBlock();
             });
         }
+    }];
+}
+
+// Remove a few files each time. The reads run alongside the maintenance, and the writes dispatched meanwhile run between slices, so stores are not blocked for long
+// 每次只删除少量文件。读操作与维护操作同时执行，期间调度的写操作在分片之间执行，这样存储不会被长时间阻塞
+- (void)deleteOldFilesInSlicesWithCompletionBlock:(nullable SDWebImageNoParamsBlock)completionBlock {
+    [self.ioScheduler dispatchAsyncWithType:SDImageCacheIOTypeMaintenance key:nil block:^{
+        if ([self.diskCache removeExpiredDataWithLimit:kDiskCacheExpirationBatchCount timeLimit:kDiskCacheExpirationSliceDuration]) {
+            [self deleteOldFilesInSlicesWithCompletionBlock:completionBlock];
+            return;
+        }
+        if (completionBlock) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                completionBlock();
+            });
+        }
+    }];
+}
+
+#pragma mark - Warm Start
+
+// Beside the disk cache directory, so it's not treated as a cache file
+- (NSString *)warmStartSnapshotPath {
+    return [self.diskCachePath stringByAppendingPathExtension:@"sd_warmstart"];
+}
+
+- (void)saveWarmStartSnapshot {
+    if (!self.hotKeys) {
+        return;
+    }
+    NSArray<NSString *> *keys = [self.hotKeys hottestKeys];
+    NSData *data = [NSPropertyListSerialization dataWithPropertyList:keys format:NSPropertyListBinaryFormat_v1_0 options:0 error:nil];
+    [data writeToFile:[self warmStartSnapshotPath] options:NSDataWritingAtomic error:nil];
+}
+
+- (void)warmStartIfNeeded {
+    if (!self.hotKeys) {
+        return;
+    }
+    NSString *path = [self warmStartSnapshotPath];
+    NSTimeInterval timeLimit = self.config.warmStartTimeLimit;
+    NSUInteger costLimit = self.config.warmStartCostLimit;
+    __weak typeof(self) wself = self;
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        __strong typeof(wself) sself = wself;
+        if (!sself) {
+            return;
+        }
+        NSData *data = [NSData dataWithContentsOfFile:path];
+        NSArray<NSString *> *keys = data ? [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListImmutable format:nil error:nil] : nil;
+        if (![keys isKindOfClass:[NSArray class]]) {
+            return;
+        }
+        // Keep the snapshot keys, the hottest as the most recent, in case they are not accessed before next snapshot
+        // 保留快照中的键，最热的作为最近访问，以防它们在下次快照前未被访问
+        for (NSString *key in keys.reverseObjectEnumerator) {
+            if ([key isKindOfClass:[NSString class]]) {
+                [sself.hotKeys recordKey:key];
+            }
+        }
+        if (!sself.config.shouldCacheImagesInMemory) {
+            return;
+        }
+        CFAbsoluteTime deadline = CFAbsoluteTimeGetCurrent() + timeLimit;
+        NSUInteger totalCost = 0;
+        for (NSString *key in keys) {
+            if (CFAbsoluteTimeGetCurrent() >= deadline || totalCost >= costLimit) {
+                break;
+            }
+            if (![key isKindOfClass:[NSString class]] || [sself imageFromMemoryCacheForKey:key]) {
+                continue;
+            }
+            @autoreleasepool {
+                // Low priority, so the warm start does not compete with the first queries of app
+                // 低优先级，这样预热不会与 app 的首批查询竞争
+                __block NSData *diskData;
+                [sself.ioScheduler dispatchSyncWithType:SDImageCacheIOTypeLowPriorityRead key:key block:^{
+                    diskData = [sself diskImageDataBySearchingAllPathsForKey:key];
+                }];
+                UIImage *image = [sself diskImageForKey:key data:diskData];
+                // The animated image class depends on the query context, leave it to the query
+                // 动图的类取决于查询的上下文，留给查询处理
+                if (!image || image.sd_isAnimated) {
+                    continue;
+                }
+                NSUInteger cost = image.sd_memoryCost;
+                if (totalCost + cost > costLimit) {
+                    continue;
+                }
+                totalCost += cost;
+                // A query may have stored the image meanwhile
+                if (![sself imageFromMemoryCacheForKey:key]) {
+                    [sself.memoryCache setObject:image forKey:key cost:cost];
+                }
+            }
+        }
     });
 }
 
@@ -564,6 +1066,10 @@
 
 #if SD_UIKIT || SD_MAC
 - (void)applicationWillTerminate:(NSNotification *)notification {
+    // Write the buffered stores before app terminated
+    // 在 app 终止前写入缓冲的存储
+    [self flushWriteBufferSynchronously];
+    [self saveWarmStartSnapshot];
     [self deleteOldFilesWithCompletionBlock:nil];
 }
 #endif
@@ -572,6 +1078,10 @@
 
 #if SD_UIKIT
 - (void)applicationDidEnterBackground:(NSNotification *)notification {
+    // App may be killed in background without terminate notification
+    // app 可能在后台被杀死而收不到终止通知
+    [self flushWriteBuffer];
+    [self saveWarmStartSnapshot];
     if (!self.config.shouldRemoveExpiredDataWhenEnterBackground) {
         return;
     }
@@ -596,26 +1106,63 @@
 }
 #endif
 
+#pragma mark - SDDiskBudgetParticipant
+
+- (NSUInteger)diskBudgetUsage {
+    return [self totalDiskSize];
+}
+
+- (NSUInteger)diskBudgetMinimumSize {
+    return self.config.minDiskSize;
+}
+
+- (NSUInteger)diskBudgetMaximumSize {
+    return self.config.maxDiskSize;
+}
+
+- (void)evictOldestDiskDataWithCount:(NSUInteger)count snapshotLimit:(NSUInteger)limit completion:(void (^)(SDDiskBudgetSnapshot * _Nonnull))completion {
+    // Only added as participant with the built-in disk cache, see `initWithNamespace:diskCacheDirectory:config:`
+    SDDiskCache *diskCache = (SDDiskCache *)self.diskCache;
+    [self.ioScheduler dispatchAsyncWithType:SDImageCacheIOTypeMaintenance key:nil block:^{
+        for (NSUInteger i = 0; i < count; i++) {
+            if (![diskCache removeOldestData]) {
+                break;
+            }
+        }
+        NSMutableArray<NSNumber *> *sizes = [NSMutableArray arrayWithCapacity:limit];
+        NSMutableArray<NSNumber *> *times = [NSMutableArray arrayWithCapacity:limit];
+        [diskCache enumerateOldestDataWithLimit:limit usingBlock:^(NSUInteger size, NSTimeInterval time) {
+            [sizes addObject:@(size)];
+            [times addObject:@(time)];
+        }];
+        SDDiskBudgetSnapshot *snapshot = [SDDiskBudgetSnapshot new];
+        snapshot.usage = [diskCache totalSize];
+        snapshot.oldestDataSizes = sizes;
+        snapshot.oldestDataTimes = times;
+        completion(snapshot);
+    }];
+}
+
 #pragma mark - Cache Info
 
 - (NSUInteger)totalDiskSize {
     __block NSUInteger size = 0;
-    dispatch_sync(self.ioQueue, ^{
+    [self.ioScheduler dispatchSyncWithType:SDImageCacheIOTypeMaintenance key:nil block:^{
         size = [self.diskCache totalSize];
-    });
+    }];
     return size;
 }
 
 - (NSUInteger)totalDiskCount {
     __block NSUInteger count = 0;
-    dispatch_sync(self.ioQueue, ^{
+    [self.ioScheduler dispatchSyncWithType:SDImageCacheIOTypeMaintenance key:nil block:^{
         count = [self.diskCache totalCount];
-    });
+    }];
     return count;
 }
 
 - (void)calculateSizeWithCompletionBlock:(nullable SDImageCacheCalculateSizeBlock)completionBlock {
-    dispatch_async(self.ioQueue, ^{
+    [self.ioScheduler dispatchAsyncWithType:SDImageCacheIOTypeMaintenance key:nil block:^{
         NSUInteger fileCount = [self.diskCache totalCount];
         NSUInteger totalSize = [self.diskCache totalSize];
         if (completionBlock) {
@@ -623,7 +1170,7 @@
                 completionBlock(fileCount, totalSize);
             });
         }
-    });
+    }];
 }
 
 #pragma mark - Helper
@@ -654,6 +1201,7 @@
     if (options & SDWebImageDecodeFirstFrameOnly) cacheOptions |= SDImageCacheDecodeFirstFrameOnly;
     if (options & SDWebImagePreloadAllFrames) cacheOptions |= SDImageCachePreloadAllFrames;
     if (options & SDWebImageMatchAnimatedImageClass) cacheOptions |= SDImageCacheMatchAnimatedImageClass;
+    if ([context[SDWebImageContextQueryAvoidMemoryCache] boolValue]) cacheOptions |= SDImageCacheAvoidMemoryCache;
     
     return [self queryCacheOperationForKey:key options:cacheOptions context:context done:completionBlock];
 }
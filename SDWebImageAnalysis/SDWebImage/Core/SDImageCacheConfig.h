@@ -21,6 +21,30 @@ typedef NS_ENUM(NSUInteger, SDImageCacheConfigExpireType) {
     SDImageCacheConfigExpireTypeModificationDate
 };
 
+/// Image Disk Cache Directory Layout
+/// 图像磁盘缓存目录布局
+typedef NS_ENUM(NSUInteger, SDImageCacheConfigDirectoryLayout) {
+    
+    // All the files are in the cache directory (Default)
+    // 所有文件都位于缓存目录中（默认）
+    SDImageCacheConfigDirectoryLayoutFlat,
+    // The files are in two levels of sub directories named by the first two bytes of file name hash, such as `ab/cd/abcd....png`, to keep each directory small
+    // 文件位于以文件名哈希的前两个字节命名的两级子目录中，例如 `ab/cd/abcd....png`，以保持每个目录较小
+    SDImageCacheConfigDirectoryLayoutSharded
+};
+
+/// Image Cache File Name Type
+/// 图像缓存文件名类型
+typedef NS_ENUM(NSUInteger, SDImageCacheConfigFileNameType) {
+    
+    // The MD5 of the key, which is used by previous versions
+    // key 的 MD5，之前的版本使用的文件名
+    SDImageCacheConfigFileNameTypeMD5,
+    // The 128-bit MurmurHash3 of the key, which is much faster than MD5. The files named by MD5 are still found, and renamed when accessed (Default)
+    // key 的 128 位 MurmurHash3，比 MD5 快得多。使用 MD5 命名的文件仍然可以找到，并在访问时重命名（默认）
+    SDImageCacheConfigFileNameTypeFastHash
+};
+
 // The class contains all the config for image cache
 // @note This class conform to NSCopying, make sure to add the property in `copyWithZone:` as well.
 // 该类包含图像缓存的所有配置
@@ -55,6 +79,16 @@ typedef NS_ENUM(NSUInteger, SDImageCacheConfigExpireType) {
 // 默认为 YES。你可以动态更改此选项。
 @property (assign, nonatomic) BOOL shouldUseWeakMemoryCache;
 
+// Whether or not to use a frequency-based admission filter (TinyLFU) in front of the memory cache. When enable and the cache is full, a new image is only admitted if it's been requested more frequently than the least recently used image it would evict, so a scan of one-time images (like a fast scrolling list) does not flush the hot images. The frequency is estimated by a small count-min sketch which ages periodically.
+// A rejected image is still stored in the weak memory cache if enabled.
+// Defaults to NO. This option is only honored by the built-in `SDLRUMemoryCache`, the `NSCache` based `SDMemoryCache` does not expose the eviction order.
+// @note This value does not support dynamic changes. Which means further modification on this value after cache initlized has no effect.
+// 是否在内存缓存之前使用基于频率的准入过滤器（TinyLFU）。启用后，当缓存已满时，新图像只有在请求频率高于它将淘汰的最近最少使用的图像时才会被接纳，因此一次性图像的扫描（例如快速滚动的列表）不会冲掉热点图像。频率由一个定期衰减的小型 count-min sketch 估算。
+// 如果启用了弱内存缓存，被拒绝的图像仍会存储在弱内存缓存中。
+// 默认为 NO。此选项仅由内置的 `SDLRUMemoryCache` 支持，基于 `NSCache` 的 `SDMemoryCache` 不暴露淘汰顺序。
+// 注意：此值不支持动态更改。这意味着缓存初始化后对该值的进一步修改没有效果。
+@property (assign, nonatomic) BOOL shouldUseMemoryCacheAdmissionFilter;
+
 // Whether or not to remove the expired disk data when application entering the background. (Not works for macOS)
 // Defaults to YES.
 // 应用程序进入后台时是否删除过期的磁盘数据。（不适用于 MacOS）
@@ -67,6 +101,14 @@ typedef NS_ENUM(NSUInteger, SDImageCacheConfigExpireType) {
 // 默认为 0。你可以将其设置为 `NSDataReadingMappedIfSafe` 以提高性能。
 @property (assign, nonatomic) NSDataReadingOptions diskCacheReadingOptions;
 
+// The file size (in bytes) from which the built-in disk cache read the file with memory mapping instead of copying it into heap, the mapped data is passed to the image coders without copy. Below this size a plain read is cheaper than creating a mapping.
+// Mapping is only used when `diskCacheWritingOptions` contains `NSDataWritingAtomic`, which replace the file instead of truncating it, so a mapped file can only be deleted (which is safe) but never truncated while mapped.
+// Defaults to 128KB. Setting this to 0 means always use `diskCacheReadingOptions`.
+// 内置磁盘缓存使用内存映射而不是拷贝到堆中来读取文件的文件大小（以字节为单位），映射的数据会不经拷贝地传递给图像解码器。小于此大小时普通读取比创建映射更快。
+// 只有当 `diskCacheWritingOptions` 包含 `NSDataWritingAtomic` 时才会使用映射，它会替换文件而不是截断文件，因此映射中的文件只会被删除（这是安全的），而不会被截断。
+// 默认为 128KB。设置为 0 表示总是使用 `diskCacheReadingOptions`。
+@property (assign, nonatomic) NSUInteger diskCacheMappedReadingThreshold;
+
 // The writing options while writing cache to disk.
 // Defaults to `NSDataWritingAtomic`. You can set this to `NSDataWritingWithoutOverwriting` to prevent overwriting an existing file.
 // 将缓存写入磁盘时的写入选项。
@@ -89,6 +131,12 @@ typedef NS_ENUM(NSUInteger, SDImageCacheConfigExpireType) {
 // 默认为 0。这意味着没有缓存大小限制。
 @property (assign, nonatomic) NSUInteger maxDiskSize;
 
+// The minimum size of the disk cache, in bytes, which is kept when the `diskBudget` of `SDDiskBudgetManager` is exceeded, so an important namespace is not starved by the others. The `maxDiskSize` is the maximum of the namespace under the budget. Only the built-in `SDDiskCache` takes part in the budget, a custom `diskCacheClass` (such as `SDLogDiskCache`) is neither counted nor evicted by it.
+// Defaults to 0. Which means the disk cache can be evicted to empty.
+// 磁盘缓存的最小 size（以字节为单位），在超出 `SDDiskBudgetManager` 的 `diskBudget` 时仍会保留，因此重要的命名空间不会被其他命名空间挤占。`maxDiskSize` 是该命名空间在预算下的最大值。只有内置的 `SDDiskCache` 参与预算，自定义的 `diskCacheClass`（例如 `SDLogDiskCache`）既不计入预算也不会被其淘汰。
+// 默认为 0。这意味着磁盘缓存可以被淘汰至空。
+@property (assign, nonatomic) NSUInteger minDiskSize;
+
 // The maximum "total cost" of the in-memory image cache. The cost function is the bytes size held in memory.
 // @note The memory cost is bytes size in memory, but not simple pixels count. For common ARGB8888 image, one pixel is 4 bytes (32 bits).
 // Defaults to 0. Which means there is no memory cost limit.
@@ -103,12 +151,82 @@ typedef NS_ENUM(NSUInteger, SDImageCacheConfigExpireType) {
 // 默认为0。这意味着没有内存数量限制。
 @property (assign, nonatomic) NSUInteger maxMemoryCount;
 
+// The maximum bytes of the encoded image data kept in memory, as a tier between the decoded in-memory image cache and the disk cache. The data read from disk or stored along with the image is kept here, a query missing the decoded image is decoded from this data without reading the disk, and the image data of `SDImageCacheQueryMemoryData` is returned without reading the disk as well.
+// The encoded data is usually much smaller than the decoded bitmap (a decoded 1080p image is about 8MB while its JPEG is about 150KB), so many more images can be kept one decode away.
+// The data read from disk with memory mapping (see `diskCacheMappedReadingThreshold`) is not kept, it's backed by the file instead of memory.
+// Defaults to 0. Which means the encoded data is not kept in memory.
+// @note This value does not support dynamic changes. Which means further modification on this value after cache initlized has no effect.
+// 内存中保留的已编码图像数据的最大字节数，作为解码后的内存图像缓存和磁盘缓存之间的一层。从磁盘读取或与图像一起存储的数据会保留在这里，解码图像未命中的查询会从这些数据解码而无需读取磁盘，`SDImageCacheQueryMemoryData` 的图像数据也无需读取磁盘即可返回。
+// 编码数据通常比解码后的位图小得多（解码后的 1080p 图像约 8MB，而其 JPEG 约 150KB），因此可以让更多的图像只需一次解码即可使用。
+// 使用内存映射从磁盘读取的数据（参见 `diskCacheMappedReadingThreshold`）不会被保留，它由文件而不是内存支持。
+// 默认为 0。这意味着不在内存中保留编码数据。
+// 注意：此值不支持动态更改。这意味着缓存初始化后对该值的进一步修改没有效果。
+@property (assign, nonatomic) NSUInteger maxMemoryDataCost;
+
+// The number of the hottest keys (by access count and recency) saved as a warm start snapshot when the app enters background or terminates. On the next launch, the images of these keys are read from disk and decoded into the memory cache asynchronously at low priority, so the first screen does not stall on disk IO and decoding.
+// Defaults to 0. Which means no snapshot is saved and no warm start happens.
+// @note This value does not support dynamic changes. Which means further modification on this value after cache initlized has no effect.
+// 当应用进入后台或终止时，作为预热快照保存的最热键（按访问次数和最近访问时间）的数量。下次启动时，这些键的图像会以低优先级异步地从磁盘读取并解码到内存缓存中，这样首屏不会因磁盘 IO 和解码而卡顿。
+// 默认为 0。这意味着不保存快照，也不进行预热。
+// 注意：此值不支持动态更改。这意味着缓存初始化后对该值的进一步修改没有效果。
+@property (assign, nonatomic) NSUInteger warmStartKeyCount;
+
+// The time limit of the warm start on launch. The keys not warmed within this time are skipped.
+// Defaults to 0.5 second.
+// 启动时预热的时间限制。在此时间内未预热的键会被跳过。
+// 默认为 0.5 秒。
+@property (assign, nonatomic) NSTimeInterval warmStartTimeLimit;
+
+// The maximum total memory cost of the images decoded by the warm start on launch. The cost is the same as the in-memory image cache.
+// Defaults to 20MB.
+// 启动时预热解码的图像的最大总内存成本。成本与内存中的图像缓存相同。
+// 默认为 20MB。
+@property (assign, nonatomic) NSUInteger warmStartCostLimit;
+
 // The attribute which the clear cache will be checked against when clearing the disk cache
 // Default is Modified Date
 // 清除磁盘缓存时将检查清除缓存的属性
 // 默认为修改日期
 @property (assign, nonatomic) SDImageCacheConfigExpireType diskCacheExpireType;
 
+// The hash used by the built-in disk cache to name the file of each key.
+// Defaults to SDImageCacheConfigFileNameTypeFastHash.
+// @note This value does not support dynamic changes. Which means further modification on this value after cache initlized has no effect.
+// 内置磁盘缓存为每个 key 的文件命名所使用的哈希。
+// 默认为 SDImageCacheConfigFileNameTypeFastHash。
+// 注意：此值不支持动态更改。这意味着缓存初始化后对该值的进一步修改没有效果。
+@property (assign, nonatomic) SDImageCacheConfigFileNameType diskCacheFileNameType;
+
+// The directory layout of the built-in disk cache. Use sharded layout when the cache holds a large number of files, because lookup and enumeration in a flat directory with many entries are slow on many file systems.
+// When the layout is changed, the files are found in both layouts, and are moved to the new layout incrementally in background.
+// Defaults to SDImageCacheConfigDirectoryLayoutFlat.
+// @note This value does not support dynamic changes. Which means further modification on this value after cache initlized has no effect.
+// 内置磁盘缓存的目录布局。当缓存包含大量文件时使用分片布局，因为在许多文件系统上，包含大量条目的扁平目录中的查找和遍历很慢。
+// 当布局改变时，两种布局中的文件都可以被找到，并会在后台增量地移动到新的布局。
+// 默认为 SDImageCacheConfigDirectoryLayoutFlat。
+// 注意：此值不支持动态更改。这意味着缓存初始化后对该值的进一步修改没有效果。
+@property (assign, nonatomic) SDImageCacheConfigDirectoryLayout diskCacheDirectoryLayout;
+
+// Whether the built-in disk cache stores the byte-identical data of different keys only once. Different URLs (such as different CDN hosts, signed query strings, or the size parameters ignored by server) often return the same image.
+// When enabled, the data is stored as a blob named by its content digest, and the file of each key is a hard link to the blob, so identical data is written and stored once. The blob is removed when no key refers to it, and `totalSize` counts it once.
+// Defaults to NO.
+// @note This value does not support dynamic changes. Which means further modification on this value after cache initlized has no effect.
+// 内置磁盘缓存是否对不同 key 的相同字节数据只存储一次。不同的 URL（例如不同的 CDN 主机、签名的查询字符串或服务器忽略的尺寸参数）经常返回相同的图像。
+// 启用后，数据会存储为以内容摘要命名的 blob，每个 key 的文件是指向该 blob 的硬链接，因此相同的数据只写入和存储一次。当没有 key 引用该 blob 时它会被删除，并且 `totalSize` 只计算它一次。
+// 默认为 NO。
+// 注意：此值不支持动态更改。这意味着缓存初始化后对该值的进一步修改没有效果。
+@property (assign, nonatomic) BOOL shouldDeduplicateDiskCacheData;
+
+// Whether the built-in disk cache verifies the checksum of the file when reading. The length and a fast checksum of the data are recorded when writing. The length is always checked, which costs nothing. The checksum costs one pass over the data, which is much cheaper than decoding it.
+// A truncated or corrupted file (such as a file torn by a crash during non-atomic writing) is removed when read, instead of being decoded and failing on every query.
+// The checksum is only computed and verified when `diskCacheWritingOptions` is not atomic, and only once for each file after launch. So the default atomic writing keeps writing and mapped reading free of the extra pass. When writing is not atomic, the length and checksum are journaled before the data is written, and a file without them is removed when read, because it may be torn.
+// Defaults to YES.
+// 内置磁盘缓存在读取时是否校验文件的校验和。写入时会记录数据的长度和快速校验和。长度总是会被检查，这没有开销。校验和需要遍历一次数据，这比解码要便宜得多。
+// 被截断或损坏的文件（例如非原子写入时因崩溃而不完整的文件）会在读取时被删除，而不是在每次查询时都被解码并失败。
+// 校验和只在 `diskCacheWritingOptions` 不是原子写入时计算和校验，并且启动后每个文件只校验一次。因此默认的原子写入使写入和映射读取不需要额外遍历数据。非原子写入时，长度和校验和会在写入数据之前记入日志，没有它们的文件可能不完整，会在读取时被删除。
+// 默认为 YES。
+@property (assign, nonatomic) BOOL shouldVerifyDiskCacheData;
+
 // The custom file manager for disk cache. Pass nil to let disk cache choose the proper file manager.
 // Defaults to nil.
 // @note This value does not support dynamic changes. Which means further modification on this value after cache initlized has no effect.
@@ -119,19 +237,43 @@ typedef NS_ENUM(NSUInteger, SDImageCacheConfigExpireType) {
 // 注意：`NSFileManager` 不支持 `NSCopying`。我们只是在复制过程中通过引用。因此，建议不要在 `defaultCacheConfig` 上设置此值。
 @property (strong, nonatomic, nullable) NSFileManager *fileManager;
 
+// The maximum number of disk cache operations running at the same time. Operations for the same key always run in order, operations for different keys run concurrently, and queries are scheduled before stores and removals, but a pending store or removal runs after a few queries in a row, so the steady queries can not starve it. Expiration and size calculation run alongside the queries, but not the stores and removals. Clearing runs alone. See `SDDiskCache` for the contract of custom disk cache.
+// Defaults to 4. Set this to 1 if your custom disk cache can not be called from multiple threads at the same time.
+// @note This value does not support dynamic changes. Which means further modification on this value after cache initlized has no effect.
+// 同时执行的磁盘缓存操作的最大数量。同一个 key 的操作总是按顺序执行，不同 key 的操作并发执行，并且查询会优先于存储和删除调度，但连续执行几次查询后会执行一个等待中的存储或删除，因此持续的查询不会使其饿死。过期清理和大小计算与查询同时执行，但不与存储和删除同时执行。清空会单独执行。自定义磁盘缓存的约定参见 `SDDiskCache`。
+// 默认为 4。如果你的自定义磁盘缓存不能同时从多个线程调用，请设置为 1。
+// 注意：此值不支持动态更改。这意味着缓存初始化后对该值的进一步修改没有效果。
+@property (assign, nonatomic) NSUInteger maxConcurrentDiskOperationCount;
+
+// The maximum bytes of the disk stores kept in a write-behind buffer. The buffered stores are written in batches when the size or `diskCacheWriteBufferInterval` is reached, and synchronously when app will terminate. A buffered store superseded by a later store or remove of the same key is never written. The buffered images can be queried like the written ones, and the store completion is called once the image is buffered.
+// For the stores without image data, the size of image in memory is counted.
+// Defaults to 0. Which means the stores are written immediately without buffering.
+// @note This value does not support dynamic changes. Which means further modification on this value after cache initlized has no effect.
+// 磁盘存储在延迟写入缓冲区中保留的最大字节数。当达到此大小或 `diskCacheWriteBufferInterval` 时，缓冲的存储会批量写入，app 终止时会同步写入。被同一个 key 后续的存储或删除替代的缓冲存储不会被写入。缓冲中的图像可以像已写入的图像一样被查询，图像进入缓冲后就会调用存储的 completion。
+// 对于没有图像数据的存储，按图像在内存中的大小计算。
+// 默认为 0。这意味着存储会立即写入，不使用缓冲。
+// 注意：此值不支持动态更改。这意味着缓存初始化后对该值的进一步修改没有效果。
+@property (assign, nonatomic) NSUInteger diskCacheWriteBufferSize;
+
+// The maximum time (in seconds) a store is kept in the write-behind buffer, see `diskCacheWriteBufferSize`.
+// Defaults to 2 seconds.
+// 存储在延迟写入缓冲区中保留的最长时间（以秒为单位），参见 `diskCacheWriteBufferSize`。
+// 默认为 2 秒。
+@property (assign, nonatomic) NSTimeInterval diskCacheWriteBufferInterval;
+
 // The custom memory cache class. Provided class instance must conform to `SDMemoryCache` protocol to allow usage.
-// Defaults to built-in `SDMemoryCache` class.
+// Defaults to built-in `SDMemoryCache` class. You can use the built-in `SDLRUMemoryCache` class instead, which use lock-striped LRU shards and scale better when many threads access the cache at the same time.
 // @note This value does not support dynamic changes. Which means further modification on this value after cache initlized has no effect.
 // 自定义内存缓存类。提供的类实例必须符合 `SDMemoryCache` 协议才能使用。
-// 默认为内置的 `SDMemoryCache` 类。
+// 默认为内置的 `SDMemoryCache` 类。你也可以使用内置的 `SDLRUMemoryCache` 类，它使用分段锁的 LRU 分片，在多线程同时访问缓存时扩展性更好。
 // 注意：此值不支持动态更改。这意味着缓存初始化后对该值的进一步修改没有效果。
 @property (assign, nonatomic, nonnull) Class memoryCacheClass;
 
 // The custom disk cache class. Provided class instance must conform to `SDDiskCache` protocol to allow usage.
-// Defaults to built-in `SDDiskCache` class.
+// Defaults to built-in `SDDiskCache` class. You can use the built-in `SDLogDiskCache` class instead, which append entries to a few segment files with an in-memory index, to avoid one file per image.
 // @note This value does not support dynamic changes. Which means further modification on this value after cache initlized has no effect.
 // 自定义磁盘缓存类。提供的类实例必须符合 `SDDiskCache` 协议才能允许使用。
-// 默认为内置 `SDDiskCache` 类。
+// 默认为内置 `SDDiskCache` 类。你也可以使用内置的 `SDLogDiskCache` 类，它将条目追加写入少量分段文件并使用内存索引，避免每张图像一个文件。
 // 注意：此值不支持动态更改。这意味着缓存初始化后对该值的进一步修改没有效果。
 @property (assign ,nonatomic, nonnull) Class diskCacheClass;
 
@@ -12,6 +12,11 @@
 
 static SDImageCacheConfig *_defaultCacheConfig;
 static const NSInteger kDefaultCacheMaxDiskAge = 60 * 60 * 24 * 7; // 1 week
+static const NSUInteger kDefaultCacheMappedReadingThreshold = 128 * 1024; // 128KB
+static const NSUInteger kDefaultCacheMaxConcurrentDiskOperationCount = 4;
+static const NSTimeInterval kDefaultCacheWriteBufferInterval = 2;
+static const NSTimeInterval kDefaultCacheWarmStartTimeLimit = 0.5;
+static const NSUInteger kDefaultCacheWarmStartCostLimit = 20 * 1024 * 1024; // 20MB
 
 @implementation SDImageCacheConfig
 
@@ -28,12 +33,25 @@ static const NSInteger kDefaultCacheMaxDiskAge = 60 * 60 * 24 * 7; // 1 week
         _shouldDisableiCloud = YES;
         _shouldCacheImagesInMemory = YES;
         _shouldUseWeakMemoryCache = YES;
+        _shouldUseMemoryCacheAdmissionFilter = NO;
         _shouldRemoveExpiredDataWhenEnterBackground = YES;
         _diskCacheReadingOptions = 0;
+        _diskCacheMappedReadingThreshold = kDefaultCacheMappedReadingThreshold;
         _diskCacheWritingOptions = NSDataWritingAtomic;
         _maxDiskAge = kDefaultCacheMaxDiskAge;
         _maxDiskSize = 0;
+        _minDiskSize = 0;
         _diskCacheExpireType = SDImageCacheConfigExpireTypeModificationDate;
+        _diskCacheFileNameType = SDImageCacheConfigFileNameTypeFastHash;
+        _diskCacheDirectoryLayout = SDImageCacheConfigDirectoryLayoutFlat;
+        _shouldDeduplicateDiskCacheData = NO;
+        _shouldVerifyDiskCacheData = YES;
+        _maxConcurrentDiskOperationCount = kDefaultCacheMaxConcurrentDiskOperationCount;
+        _diskCacheWriteBufferSize = 0;
+        _diskCacheWriteBufferInterval = kDefaultCacheWriteBufferInterval;
+        _warmStartKeyCount = 0;
+        _warmStartTimeLimit = kDefaultCacheWarmStartTimeLimit;
+        _warmStartCostLimit = kDefaultCacheWarmStartCostLimit;
         _memoryCacheClass = [SDMemoryCache class];
         _diskCacheClass = [SDDiskCache class];
     }
@@ -45,15 +63,29 @@ static const NSInteger kDefaultCacheMaxDiskAge = 60 * 60 * 24 * 7; // 1 week
     config.shouldDisableiCloud = self.shouldDisableiCloud;
     config.shouldCacheImagesInMemory = self.shouldCacheImagesInMemory;
     config.shouldUseWeakMemoryCache = self.shouldUseWeakMemoryCache;
+    config.shouldUseMemoryCacheAdmissionFilter = self.shouldUseMemoryCacheAdmissionFilter;
     config.shouldRemoveExpiredDataWhenEnterBackground = self.shouldRemoveExpiredDataWhenEnterBackground;
     config.diskCacheReadingOptions = self.diskCacheReadingOptions;
+    config.diskCacheMappedReadingThreshold = self.diskCacheMappedReadingThreshold;
     config.diskCacheWritingOptions = self.diskCacheWritingOptions;
     config.maxDiskAge = self.maxDiskAge;
     config.maxDiskSize = self.maxDiskSize;
+    config.minDiskSize = self.minDiskSize;
     config.maxMemoryCost = self.maxMemoryCost;
+    config.maxMemoryDataCost = self.maxMemoryDataCost;
     config.maxMemoryCount = self.maxMemoryCount;
     config.diskCacheExpireType = self.diskCacheExpireType;
+    config.diskCacheFileNameType = self.diskCacheFileNameType;
+    config.diskCacheDirectoryLayout = self.diskCacheDirectoryLayout;
+    config.shouldDeduplicateDiskCacheData = self.shouldDeduplicateDiskCacheData;
+    config.shouldVerifyDiskCacheData = self.shouldVerifyDiskCacheData;
     config.fileManager = self.fileManager; // NSFileManager does not conform to NSCopying, just pass the reference
+    config.maxConcurrentDiskOperationCount = self.maxConcurrentDiskOperationCount;
+    config.diskCacheWriteBufferSize = self.diskCacheWriteBufferSize;
+    config.diskCacheWriteBufferInterval = self.diskCacheWriteBufferInterval;
+    config.warmStartKeyCount = self.warmStartKeyCount;
+    config.warmStartTimeLimit = self.warmStartTimeLimit;
+    config.warmStartCostLimit = self.warmStartCostLimit;
     config.memoryCacheClass = self.memoryCacheClass;
     config.diskCacheClass = self.diskCacheClass;
     
@@ -14,7 +14,8 @@ typedef NS_ENUM(NSUInteger, SDImageCachesManagerOperationPolicy) {
     SDImageCachesManagerOperationPolicySerial, // process all caches serially (from the highest priority to the lowest priority cache by order)
     SDImageCachesManagerOperationPolicyConcurrent, // process all caches concurrently
     SDImageCachesManagerOperationPolicyHighestOnly, // process the highest priority cache only
-    SDImageCachesManagerOperationPolicyLowestOnly // process the lowest priority cache only
+    SDImageCachesManagerOperationPolicyLowestOnly, // process the lowest priority cache only
+    SDImageCachesManagerOperationPolicyFirstHit // query all caches concurrently, the first hit wins and cancel the others, then store the hit into the caches which already missed asynchronously (for query op, the other ops process all caches concurrently)
 };
 
 /**
@@ -32,6 +33,7 @@ typedef NS_ENUM(NSUInteger, SDImageCachesManagerOperationPolicy) {
 /**
  Operation policy for query op.
  Defaults to `Serial`, means query all caches serially (one completion called then next begin) until one cache query success (`image` != nil).
+ For `FirstHit`, the caches which missed before the hit (so they are faster) are backfilled with the hit image and data asynchronously. The query with `SDWebImageDecodeFirstFrameOnly` is not backfilled, because the image is not the original one.
  */
 @property (nonatomic, assign) SDImageCachesManagerOperationPolicy queryOperationPolicy;
 
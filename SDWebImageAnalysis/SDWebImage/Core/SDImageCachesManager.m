@@ -10,6 +10,7 @@
 #import "SDImageCachesManagerOperation.h"
 #import "SDImageCache.h"
 #import "SDInternalMacros.h"
+#import "SDImageTransformer.h"
 
 @interface SDImageCachesManager ()
 
@@ -113,6 +114,13 @@
             return operation;
         }
             break;
+        case SDImageCachesManagerOperationPolicyFirstHit: {
+            SDImageCachesManagerOperation *operation = [SDImageCachesManagerOperation new];
+            [operation beginWithTotalCount:caches.count];
+            [self firstHitQueryImageForKey:key options:options context:context completion:completionBlock enumerator:caches.reverseObjectEnumerator operation:operation];
+            return operation;
+        }
+            break;
         case SDImageCachesManagerOperationPolicySerial: {
             SDImageCachesManagerOperation *operation = [SDImageCachesManagerOperation new];
             [operation beginWithTotalCount:caches.count];
@@ -149,7 +157,8 @@
             [cache storeImage:image imageData:imageData forKey:key cacheType:cacheType completion:completionBlock];
         }
             break;
-        case SDImageCachesManagerOperationPolicyConcurrent: {
+        case SDImageCachesManagerOperationPolicyConcurrent:
+        case SDImageCachesManagerOperationPolicyFirstHit: {
             SDImageCachesManagerOperation *operation = [SDImageCachesManagerOperation new];
             [operation beginWithTotalCount:caches.count];
             [self concurrentStoreImage:image imageData:imageData forKey:key cacheType:cacheType completion:completionBlock enumerator:caches.reverseObjectEnumerator operation:operation];
@@ -187,7 +196,8 @@
             [cache removeImageForKey:key cacheType:cacheType completion:completionBlock];
         }
             break;
-        case SDImageCachesManagerOperationPolicyConcurrent: {
+        case SDImageCachesManagerOperationPolicyConcurrent:
+        case SDImageCachesManagerOperationPolicyFirstHit: {
             SDImageCachesManagerOperation *operation = [SDImageCachesManagerOperation new];
             [operation beginWithTotalCount:caches.count];
             [self concurrentRemoveImageForKey:key cacheType:cacheType completion:completionBlock enumerator:caches.reverseObjectEnumerator operation:operation];
@@ -225,7 +235,8 @@
             [cache containsImageForKey:key cacheType:cacheType completion:completionBlock];
         }
             break;
-        case SDImageCachesManagerOperationPolicyConcurrent: {
+        case SDImageCachesManagerOperationPolicyConcurrent:
+        case SDImageCachesManagerOperationPolicyFirstHit: {
             SDImageCachesManagerOperation *operation = [SDImageCachesManagerOperation new];
             [operation beginWithTotalCount:caches.count];
             [self concurrentContainsImageForKey:key cacheType:cacheType completion:completionBlock enumerator:caches.reverseObjectEnumerator operation:operation];
@@ -262,7 +273,8 @@
             [cache clearWithCacheType:cacheType completion:completionBlock];
         }
             break;
-        case SDImageCachesManagerOperationPolicyConcurrent: {
+        case SDImageCachesManagerOperationPolicyConcurrent:
+        case SDImageCachesManagerOperationPolicyFirstHit: {
             SDImageCachesManagerOperation *operation = [SDImageCachesManagerOperation new];
             [operation beginWithTotalCount:caches.count];
             [self concurrentClearWithCacheType:cacheType completion:completionBlock enumerator:caches.reverseObjectEnumerator operation:operation];
@@ -420,6 +432,79 @@
     }
 }
 
+#pragma mark - First Hit Operation
+
+- (void)firstHitQueryImageForKey:(NSString *)key options:(SDWebImageOptions)options context:(SDWebImageContext *)context completion:(SDImageCacheQueryCompletionBlock)completionBlock enumerator:(NSEnumerator<id<SDImageCache>> *)enumerator operation:(SDImageCachesManagerOperation *)operation {
+    NSParameterAssert(enumerator);
+    NSParameterAssert(operation);
+    dispatch_semaphore_t missedCachesLock = dispatch_semaphore_create(1);
+    NSMutableArray<id<SDImageCache>> *missedCaches = [NSMutableArray array];
+    for (id<SDImageCache> cache in enumerator) {
+        if (operation.isCancelled || operation.isFinished) {
+            // A cache hit synchronously, no need to query the lower priority caches
+            break;
+        }
+        id<SDWebImageOperation> childOperation = [cache queryImageForKey:key options:options context:context completion:^(UIImage * _Nullable image, NSData * _Nullable data, SDImageCacheType cacheType) {
+            if (operation.isCancelled) {
+                // Cancelled
+                return;
+            }
+            if (operation.isFinished) {
+                // Finished
+                return;
+            }
+            [operation completeOne];
+            if (image) {
+                // Success, cancel the slower queries
+                [operation done];
+                [operation cancelChildOperations];
+                if (completionBlock) {
+                    completionBlock(image, data, cacheType);
+                }
+                SD_LOCK(missedCachesLock);
+                NSArray<id<SDImageCache>> *caches = [missedCaches copy];
+                SD_UNLOCK(missedCachesLock);
+                [self backfillImage:image imageData:data forKey:key options:options context:context caches:caches];
+                return;
+            }
+            SD_LOCK(missedCachesLock);
+            [missedCaches addObject:cache];
+            SD_UNLOCK(missedCachesLock);
+            if (operation.pendingCount == 0) {
+                // Complete
+                [operation done];
+                if (completionBlock) {
+                    completionBlock(nil, nil, SDImageCacheTypeNone);
+                }
+            }
+        }];
+        if (childOperation) {
+            [operation addChildOperation:childOperation];
+        }
+    }
+}
+
+// Store the hit into the caches which missed, they answered faster than the hit one
+- (void)backfillImage:(UIImage *)image imageData:(NSData *)imageData forKey:(NSString *)key options:(SDWebImageOptions)options context:(SDWebImageContext *)context caches:(NSArray<id<SDImageCache>> *)caches {
+    if (caches.count == 0 || options & SDWebImageDecodeFirstFrameOnly) {
+        return;
+    }
+    // The transformed image is queried with the transformed key
+    id<SDImageTransformer> transformer = context[SDWebImageContextImageTransformer];
+    if (transformer) {
+        key = SDTransformedKeyForKey(key, transformer.transformerKey);
+    }
+    SDImageCacheType cacheType = SDImageCacheTypeAll;
+    if (context[SDWebImageContextStoreCacheType]) {
+        cacheType = [context[SDWebImageContextStoreCacheType] integerValue];
+    }
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        for (id<SDImageCache> cache in caches) {
+            [cache storeImage:image imageData:imageData forKey:key cacheType:cacheType completion:nil];
+        }
+    });
+}
+
 #pragma mark - Serial Operation
 
 - (void)serialQueryImageForKey:(NSString *)key options:(SDWebImageOptions)options context:(SDWebImageContext *)context completion:(SDImageCacheQueryCompletionBlock)completionBlock enumerator:(NSEnumerator<id<SDImageCache>> *)enumerator operation:(SDImageCachesManagerOperation *)operation {
@@ -31,6 +31,14 @@ FOUNDATION_EXPORT SDImageCoderOption _Nonnull const SDImageCoderDecodeFirstFrame
 // 注意：适用于 `SDImageCoder`、`SDProgressiveImageCoder`、`SDAnimatedImageCoder`。
 FOUNDATION_EXPORT SDImageCoderOption _Nonnull const SDImageCoderDecodeScaleFactor;
 
+// A Boolean value indicating whether to decode the bitmap when the image is created, instead of when the image is rendered. (NSNumber). If not provide, the bitmap is decoded when the image is rendered.
+// Each image created with this allocates its own bitmap of the full image size, even for the partial data. Whether the coder reuses the rows decoded for the next image depends on the codec, and is not guaranteed.
+// @note works for `SDProgressiveImageCoder`.
+// 一个布尔值，表示是否在创建图像时解码位图，而不是在渲染图像时解码。(NSNumber)。如果不提供，位图将在渲染图像时解码。
+// 使用此选项创建的每个图像都会分配自己的完整图像尺寸的位图，即使是部分数据也是如此。coder 是否会为下一次创建的图像复用已解码的行取决于编解码器，并不保证。
+// 注意：适用于 `SDProgressiveImageCoder`。
+FOUNDATION_EXPORT SDImageCoderOption _Nonnull const SDImageCoderDecodeCacheImmediately;
+
 // These options are for image encoding
 // 这些选项用于图像编码
 
@@ -7,6 +7,7 @@
  */
 
 #import "SDImageGIFCoder.h"
+#import "SDMemoryPressureManager.h"
 #import "NSImage+Compatibility.h"
 #import "UIImage+Metadata.h"
 #import <ImageIO/ImageIO.h>
@@ -24,6 +25,10 @@
 @implementation SDGIFCoderFrame
 @end
 
+@interface SDImageGIFCoder () <SDMemoryPressureSubscriber>
+
+@end
+
 @implementation SDImageGIFCoder {
     size_t _width, _height;
     CGImageSourceRef _imageSource;
@@ -41,15 +46,13 @@
         CFRelease(_imageSource);
         _imageSource = NULL;
     }
-#if SD_UIKIT
-    [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
-#endif
 }
 
-- (void)didReceiveMemoryWarning:(NSNotification *)notification
+- (void)trimToFraction:(double)fraction
 {
     if (_imageSource) {
-        for (size_t i = 0; i < _frameCount; i++) {
+        // Keep the cache of the leading frames
+        for (size_t i = (size_t)(_frameCount * fraction); i < _frameCount; i++) {
             CGImageSourceRemoveCacheAtIndex(_imageSource, i);
         }
     }
@@ -189,9 +192,7 @@
             scale = MAX([scaleFactor doubleValue], 1);
         }
         _scale = scale;
-#if SD_UIKIT
-        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(didReceiveMemoryWarning:) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
-#endif
+        [[SDMemoryPressureManager sharedManager] addSubscriber:self];
     }
     return self;
 }
@@ -336,9 +337,7 @@
         _scale = scale;
         _imageSource = imageSource;
         _imageData = data;
-#if SD_UIKIT
-        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(didReceiveMemoryWarning:) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
-#endif
+        [[SDMemoryPressureManager sharedManager] addSubscriber:self];
     }
     return self;
 }
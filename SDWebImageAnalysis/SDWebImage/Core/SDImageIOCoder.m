@@ -7,11 +7,16 @@
  */
 
 #import "SDImageIOCoder.h"
+#import "SDMemoryPressureManager.h"
 #import "SDImageCoderHelper.h"
 #import "NSImage+Compatibility.h"
 #import <ImageIO/ImageIO.h>
 #import "UIImage+Metadata.h"
 
+@interface SDImageIOCoder () <SDMemoryPressureSubscriber>
+
+@end
+
 @implementation SDImageIOCoder {
     size_t _width, _height;
     CGImagePropertyOrientation _orientation;
@@ -25,12 +30,9 @@
         CFRelease(_imageSource);
         _imageSource = NULL;
     }
-#if SD_UIKIT
-    [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
-#endif
 }
 
-- (void)didReceiveMemoryWarning:(NSNotification *)notification
+- (void)trimToFraction:(double)fraction
 {
     if (_imageSource) {
         CGImageSourceRemoveCacheAtIndex(_imageSource, 0);
@@ -94,9 +96,7 @@
             scale = MAX([scaleFactor doubleValue], 1);
         }
         _scale = scale;
-#if SD_UIKIT
-        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(didReceiveMemoryWarning:) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
-#endif
+        [[SDMemoryPressureManager sharedManager] addSubscriber:self];
     }
     return self;
 }
@@ -136,8 +136,9 @@
     UIImage *image;
     
     if (_width + _height > 0) {
-        // Create the image
-        CGImageRef partialImageRef = CGImageSourceCreateImageAtIndex(_imageSource, 0, NULL);
+        // Create the image, decode it immediately if needed, so the source keeps the rows decoded for the next image
+        NSDictionary *imageOptions = [options[SDImageCoderDecodeCacheImmediately] boolValue] ? @{(__bridge NSString *)kCGImageSourceShouldCacheImmediately : @(YES)} : nil;
+        CGImageRef partialImageRef = CGImageSourceCreateImageAtIndex(_imageSource, 0, (__bridge CFDictionaryRef)imageOptions);
         
         if (partialImageRef) {
             CGFloat scale = _scale;
@@ -39,6 +39,14 @@ FOUNDATION_EXPORT UIImage * _Nullable SDImageLoaderDecodeImageData(NSData * _Non
 // operation: 与当前渐进式下载相关联的加载器操作。为什么提供这个是因为渐进式解码需要为每个操作存储部分解码的上下文以避免冲突。你应该从 `loadImageWithURL:` 方法返回值中提供操作。
 FOUNDATION_EXPORT UIImage * _Nullable SDImageLoaderDecodeProgressiveImageData(NSData * _Nonnull imageData, NSURL * _Nonnull imageURL, BOOL finished,  id<SDWebImageOperation> _Nonnull operation, SDWebImageOptions options, SDWebImageContext * _Nullable context);
 
+// This is the built-in decoding process to decode the image while downloading from network, without the partial images. It's used when `shouldDecodeWhileDownloading` of `SDWebImageDownloaderConfig` is set.
+// Call it with the data received so far and `finished` = NO, which feeds the incremental coder, decodes the rows received periodically with `SDImageCoderDecodeCacheImmediately` and returns nil. Each of these steps allocates and releases a full size bitmap of the partial image. Then call it with the full data and `finished` = YES, which returns the image the same as `SDImageLoaderDecodeImageData`, decoded by the coder when it's created. Only the static images (JPEG, or any format with `SDWebImageDecodeFirstFrameOnly`) are decoded in this way, for others it returns nil, and you should call `SDImageLoaderDecodeImageData` instead.
+// operation: The loader operation associated with current download, which stores the incremental coder, the same as `SDImageLoaderDecodeProgressiveImageData`.
+// 这是用于在从网络下载的同时解码图像的内置解码过程，不产生部分图像。当设置 `SDWebImageDownloaderConfig` 的 `shouldDecodeWhileDownloading` 时使用。
+// 使用目前已接收的数据和 `finished` = NO 调用它，会将数据提供给渐进式 coder，使用 `SDImageCoderDecodeCacheImmediately` 定期解码已接收的行，并返回 nil。每一步都会分配并释放一个部分图像的完整尺寸位图。然后使用完整的数据和 `finished` = YES 调用它，会返回与 `SDImageLoaderDecodeImageData` 相同的图像，该图像在创建时由 coder 解码。只有静态图像（JPEG，或设置了 `SDWebImageDecodeFirstFrameOnly` 的任何格式）会以这种方式解码，对于其他图像它返回 nil，你应该改为调用 `SDImageLoaderDecodeImageData`。
+// operation: 与当前下载相关联的加载器操作，它保存渐进式 coder，与 `SDImageLoaderDecodeProgressiveImageData` 相同。
+FOUNDATION_EXPORT UIImage * _Nullable SDImageLoaderDecodeStreamingImageData(NSData * _Nonnull imageData, NSURL * _Nonnull imageURL, BOOL finished,  id<SDWebImageOperation> _Nonnull operation, SDWebImageOptions options, SDWebImageContext * _Nullable context);
+
 #pragma mark - SDImageLoader
 
 // This is the protocol to specify custom image load process. You can create your own class to conform this protocol and use as a image loader to load image from network or any avaiable remote resources defined by yourself.
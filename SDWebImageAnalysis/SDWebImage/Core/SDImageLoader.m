@@ -12,9 +12,16 @@
 #import "SDImageCoderHelper.h"
 #import "SDAnimatedImage.h"
 #import "UIImage+Metadata.h"
+#import "UIImage+ForceDecode.h"
+#import "NSData+ImageContentType.h"
 #import "objc/runtime.h"
 
 static void * SDImageLoaderProgressiveCoderKey = &SDImageLoaderProgressiveCoderKey;
+static void * SDImageLoaderStreamingCoderKey = &SDImageLoaderStreamingCoderKey;
+static void * SDImageLoaderStreamingDecodedLengthKey = &SDImageLoaderStreamingDecodedLengthKey;
+
+// The partial image is decoded again after this many bytes, or a quarter of the bytes decoded, whichever is larger
+static const NSUInteger SDImageLoaderStreamingDecodeMinimumLength = 32 * 1024;
 
 UIImage * _Nullable SDImageLoaderDecodeImageData(NSData * _Nonnull imageData, NSURL * _Nonnull imageURL, SDWebImageOptions options, SDWebImageContext * _Nullable context) {
     NSCParameterAssert(imageData);
@@ -160,4 +167,80 @@ UIImage * _Nullable SDImageLoaderDecodeProgressiveImageData(NSData * _Nonnull im
     return image;
 }
 
+UIImage * _Nullable SDImageLoaderDecodeStreamingImageData(NSData * _Nonnull imageData, NSURL * _Nonnull imageURL, BOOL finished,  id<SDWebImageOperation> _Nonnull operation, SDWebImageOptions options, SDWebImageContext * _Nullable context) {
+    NSCParameterAssert(imageData);
+    NSCParameterAssert(imageURL);
+    NSCParameterAssert(operation);
+    
+    UIImage *image;
+    id<SDWebImageCacheKeyFilter> cacheKeyFilter = context[SDWebImageContextCacheKeyFilter];
+    NSString *cacheKey;
+    if (cacheKeyFilter) {
+        cacheKey = [cacheKeyFilter cacheKeyForURL:imageURL];
+    } else {
+        cacheKey = imageURL.absoluteString;
+    }
+    BOOL decodeFirstFrame = options & SDWebImageDecodeFirstFrameOnly;
+    NSNumber *scaleValue = context[SDWebImageContextImageScaleFactor];
+    CGFloat scale = scaleValue.doubleValue >= 1 ? scaleValue.doubleValue : SDImageScaleFactorForKey(cacheKey);
+    SDImageCoderOptions *coderOptions = @{SDImageCoderDecodeFirstFrameOnly : @(decodeFirstFrame), SDImageCoderDecodeScaleFactor : @(scale)};
+    if (context) {
+        SDImageCoderMutableOptions *mutableCoderOptions = [coderOptions mutableCopy];
+        [mutableCoderOptions setValue:context forKey:SDImageCoderWebImageContext];
+        coderOptions = [mutableCoderOptions copy];
+    }
+    
+    id progressiveCoder = objc_getAssociatedObject(operation, SDImageLoaderStreamingCoderKey);
+    if (!progressiveCoder) {
+        // The incremental decoding produces the first frame only, so the image which may be animated, or should be `SDAnimatedImage`, is decoded after download
+        BOOL isStatic = decodeFirstFrame || ([NSData sd_imageFormatForImageData:imageData] == SDImageFormatJPEG && !context[SDWebImageContextAnimatedImageClass]);
+        if (isStatic) {
+            for (id<SDImageCoder>coder in [SDImageCodersManager sharedManager].coders.reverseObjectEnumerator) {
+                if ([coder conformsToProtocol:@protocol(SDProgressiveImageCoder)] &&
+                    [((id<SDProgressiveImageCoder>)coder) canIncrementalDecodeFromData:imageData]) {
+                    progressiveCoder = [[[coder class] alloc] initIncrementalWithOptions:coderOptions];
+                    break;
+                }
+            }
+        }
+        // Mark with `NSNull` so the check is not repeated for each data
+        objc_setAssociatedObject(operation, SDImageLoaderStreamingCoderKey, progressiveCoder ?: [NSNull null], OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+    if (![progressiveCoder conformsToProtocol:@protocol(SDProgressiveImageCoder)]) {
+        return nil;
+    }
+    
+    [progressiveCoder updateIncrementalData:imageData finished:finished];
+    SDImageCoderMutableOptions *decodeOptions = [coderOptions mutableCopy];
+    if (!finished) {
+        // Decode the rows received periodically, no partial image is returned. Each step allocates a full size bitmap of the partial image, so the steps are spaced by a quarter of the data decoded
+        decodeOptions[SDImageCoderDecodeCacheImmediately] = @(YES);
+        NSUInteger decodedLength = [objc_getAssociatedObject(operation, SDImageLoaderStreamingDecodedLengthKey) unsignedIntegerValue];
+        if (imageData.length >= decodedLength + MAX(decodedLength / 4, SDImageLoaderStreamingDecodeMinimumLength)) {
+            @autoreleasepool {
+                [progressiveCoder incrementalDecodedImageWithOptions:[decodeOptions copy]];
+            }
+            objc_setAssociatedObject(operation, SDImageLoaderStreamingDecodedLengthKey, @(imageData.length), OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+        }
+        return nil;
+    }
+    BOOL shouldDecode = (options & SDWebImageAvoidDecodeImage) == 0;
+    BOOL shouldScaleDown = options & SDWebImageScaleDownLargeImages;
+    // The final image is decoded by the coder when it's created, so it's not drawn again. The scaled down image is drawn from the undecoded one instead, to avoid the full size bitmap
+    BOOL shouldDecodeByCoder = shouldDecode && !shouldScaleDown;
+    if (shouldDecodeByCoder) {
+        decodeOptions[SDImageCoderDecodeCacheImmediately] = @(YES);
+    }
+    image = [progressiveCoder incrementalDecodedImageWithOptions:[decodeOptions copy]];
+    if (image && shouldDecode) {
+        if (shouldDecodeByCoder) {
+            image.sd_isDecoded = YES;
+        } else {
+            image = [SDImageCoderHelper decodedAndScaledDownImageWithImage:image limitBytes:0];
+        }
+    }
+    
+    return image;
+}
+
 SDWebImageContextOption const SDWebImageContextLoaderCachedImage = @"loaderCachedImage";
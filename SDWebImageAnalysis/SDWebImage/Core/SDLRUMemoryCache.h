@@ -0,0 +1,44 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDWebImageCompat.h"
+#import "SDMemoryCache.h"
+
+// A memory cache which split the keys into several lock-striped shards. Each shard is a doubly-linked LRU list with O(1) cost accounting, so threads accessing different keys rarely wait for each other and the least recently used entry is always evicted first.
+// The `maxMemoryCost` and `maxMemoryCount` of config limit the totals of all shards, a shard can hold more than its share while the totals are under the limits. When the limits are exceeded, the shards are trimmed round-robin.
+// Like `SDMemoryCache`, it auto trim the cache on memory pressure and support weak cache (See `SDImageCacheConfig.shouldUseWeakMemoryCache`). The trim evicts the least recently used objects first, and the cost is counted for the budget of `SDMemoryPressureManager`.
+// When `SDImageCacheConfig.shouldUseMemoryCacheAdmissionFilter` is enabled, each shard keeps a frequency sketch of the queried keys, and when the cache is full, a shard only admits a new object which is queried more frequently than its least recently used object.
+// 一种内存缓存，将 key 拆分到多个分段锁保护的分片中。每个分片都是一个双向链表实现的 LRU，开销统计为 O(1)，因此访问不同 key 的线程很少互相等待，并且总是优先淘汰最近最少使用的条目。
+// 配置中的 `maxMemoryCost` 和 `maxMemoryCount` 限制所有分片的总量，在总量未超出限制时，单个分片可以持有超过其份额的对象。超出限制时，会轮流裁剪各个分片。
+// 与 `SDMemoryCache` 一样，它会在内存压力下自动裁剪缓存并支持 weak 缓存（参见 `SDImageCacheConfig.shouldUseWeakMemoryCache`）。裁剪会优先淘汰最近最少使用的对象，其开销会计入 `SDMemoryPressureManager` 的预算。
+// 当启用 `SDImageCacheConfig.shouldUseMemoryCacheAdmissionFilter` 时，每个分片会记录被查询 key 的频率 sketch，缓存已满时，分片只接纳查询频率高于其最近最少使用对象的新对象。
+@interface SDLRUMemoryCache : NSObject <SDMemoryCache, SDMemoryPressureSubscriber>
+
+@property (nonatomic, strong, nonnull, readonly) SDImageCacheConfig *config;
+
+// The number of shards. Always a power of two.
+// 分片数量，总是 2 的幂。
+@property (nonatomic, assign, readonly) NSUInteger shardCount;
+
+// The total cost of objects currently held strongly by the cache.
+// 当前缓存强引用对象的总开销。
+@property (nonatomic, assign, readonly) NSUInteger totalCost;
+
+// The total number of objects currently held strongly by the cache.
+// 当前缓存强引用对象的总数。
+@property (nonatomic, assign, readonly) NSUInteger totalCount;
+
+// Removes the least recently used objects until the `totalCost` is at or below the specified value.
+// 删除最近最少使用的对象，直到 `totalCost` 小于或等于指定值。
+- (void)trimToCost:(NSUInteger)cost;
+
+// Removes the least recently used objects until the `totalCount` is at or below the specified value.
+// 删除最近最少使用的对象，直到 `totalCount` 小于或等于指定值。
+- (void)trimToCount:(NSUInteger)count;
+
+@end
@@ -0,0 +1,556 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDLRUMemoryCache.h"
+#import "SDImageCacheConfig.h"
+#import "UIImage+MemoryCacheCost.h"
+#import "SDInternalMacros.h"
+#import "SDFrequencySketch.h"
+#import "SDAnimatedImage.h"
+#import "UIImage+MemoryCacheCostTracking.h"
+#import <stdatomic.h>
+
+static void * SDLRUMemoryCacheContext = &SDLRUMemoryCacheContext;
+
+// Must be a power of two, so the shard index can be computed with a mask
+// 必须是 2 的幂，这样可以通过掩码计算分片索引
+static const NSUInteger kSDLRUMemoryCacheShardCount = 16;
+
+// The frequency sketch capacity of one shard, when there is no count limit
+// 没有数量限制时，单个分片的频率 sketch 容量
+static const NSUInteger kSDLRUMemoryCacheShardSketchCapacity = 256;
+
+// Convert the config limit (0 means no limit) into the limit of cache
+// 将配置的限制（0 表示不限制）转换为缓存的限制
+static inline NSUInteger SDLRUMemoryCacheLimit(NSUInteger limit) {
+    return limit == 0 ? NSUIntegerMax : limit;
+}
+
+// Release the evicted objects on a background queue, image dealloc may be expensive
+// 在后台队列释放被淘汰的对象，图像的释放可能比较耗时
+static inline void SDLRUMemoryCacheReleaseAsync(id holder) {
+    if (!holder) {
+        return;
+    }
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0), ^{
+        [holder class]; // release in queue
+    });
+}
+
+#pragma mark - Node
+
+// A node in the LRU list. The node is retained by the shard's dictionary, the list links are unretained.
+// LRU 链表中的节点。节点由分片的字典持有，链表指针不持有。
+@interface SDLRUMemoryCacheNode : NSObject {
+    @package
+    __unsafe_unretained SDLRUMemoryCacheNode *_prev;
+    __unsafe_unretained SDLRUMemoryCacheNode *_next;
+    id _key;
+    id _value;
+    NSUInteger _cost;
+}
+@end
+
+@implementation SDLRUMemoryCacheNode
+@end
+
+#pragma mark - Shard
+
+// A shard of the cache. The methods are not thread-safe, caller should hold the `lock`.
+// The changes of totals are also applied to the totals of cache, which are atomic and shared by all shards.
+// 缓存的一个分片。方法不是线程安全的，调用者需要持有 `lock`。
+// 总量的变化也会应用到缓存的总量上，缓存的总量是原子的，由所有分片共享。
+@interface SDLRUMemoryCacheShard : NSObject {
+    @package
+    CFMutableDictionaryRef _dic;
+    __unsafe_unretained SDLRUMemoryCacheNode *_head; // most recently used
+    __unsafe_unretained SDLRUMemoryCacheNode *_tail; // least recently used
+    NSUInteger _totalCost;
+    NSUInteger _totalCount;
+    atomic_ulong *_cacheTotalCost; // owned by cache, which outlives the shards
+    atomic_ulong *_cacheTotalCount;
+}
+
+@property (nonatomic, strong, nonnull) dispatch_semaphore_t lock;
+@property (nonatomic, strong, nullable) SDFrequencySketch *sketch; // admission filter
+#if SD_UIKIT
+@property (nonatomic, strong, nonnull) NSMapTable *weakCache; // strong-weak cache
+#endif
+
+- (nullable SDLRUMemoryCacheNode *)nodeForKey:(nonnull id)key;
+- (void)insertNodeAtHead:(nonnull SDLRUMemoryCacheNode *)node;
+- (void)bringNodeToHead:(nonnull SDLRUMemoryCacheNode *)node;
+- (void)removeNode:(nonnull SDLRUMemoryCacheNode *)node;
+- (nullable SDLRUMemoryCacheNode *)removeTailNode;
+- (void)updateCost:(NSUInteger)cost ofNode:(nonnull SDLRUMemoryCacheNode *)node;
+// The frequency of the tail node, which is evicted first from this shard. NSNotFound if there is no admission filter or the shard is empty
+- (NSUInteger)tailFrequency;
+// Whether a new entry of key should be inserted, when the cache is full and it would evict the victim of frequency. NSNotFound means no victim
+- (BOOL)shouldAdmitKey:(nonnull id)key victimFrequency:(NSUInteger)victimFrequency;
+// Return the old storage, caller can release it outside the lock
+- (nonnull id)removeAll;
+
+@end
+
+@implementation SDLRUMemoryCacheShard
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _dic = CFDictionaryCreateMutable(CFAllocatorGetDefault(), 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+        _lock = dispatch_semaphore_create(1);
+#if SD_UIKIT
+        _weakCache = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsStrongMemory valueOptions:NSPointerFunctionsWeakMemory capacity:0];
+#endif
+    }
+    return self;
+}
+
+- (void)dealloc {
+    CFRelease(_dic);
+}
+
+- (SDLRUMemoryCacheNode *)nodeForKey:(id)key {
+    return (__bridge SDLRUMemoryCacheNode *)CFDictionaryGetValue(_dic, (__bridge const void *)key);
+}
+
+- (void)insertNodeAtHead:(SDLRUMemoryCacheNode *)node {
+    CFDictionarySetValue(_dic, (__bridge const void *)node->_key, (__bridge const void *)node);
+    _totalCost += node->_cost;
+    _totalCount++;
+    atomic_fetch_add_explicit(_cacheTotalCost, node->_cost, memory_order_relaxed);
+    atomic_fetch_add_explicit(_cacheTotalCount, 1, memory_order_relaxed);
+    if (_head) {
+        node->_next = _head;
+        _head->_prev = node;
+        _head = node;
+    } else {
+        _head = _tail = node;
+    }
+}
+
+- (void)bringNodeToHead:(SDLRUMemoryCacheNode *)node {
+    if (_head == node) {
+        return;
+    }
+    if (_tail == node) {
+        _tail = node->_prev;
+        _tail->_next = nil;
+    } else {
+        node->_next->_prev = node->_prev;
+        node->_prev->_next = node->_next;
+    }
+    node->_next = _head;
+    node->_prev = nil;
+    _head->_prev = node;
+    _head = node;
+}
+
+- (void)removeNode:(SDLRUMemoryCacheNode *)node {
+    if (node->_next) node->_next->_prev = node->_prev;
+    if (node->_prev) node->_prev->_next = node->_next;
+    if (_head == node) _head = node->_next;
+    if (_tail == node) _tail = node->_prev;
+    _totalCost -= node->_cost;
+    _totalCount--;
+    atomic_fetch_sub_explicit(_cacheTotalCost, node->_cost, memory_order_relaxed);
+    atomic_fetch_sub_explicit(_cacheTotalCount, 1, memory_order_relaxed);
+    CFDictionaryRemoveValue(_dic, (__bridge const void *)node->_key);
+}
+
+- (SDLRUMemoryCacheNode *)removeTailNode {
+    SDLRUMemoryCacheNode *tail = _tail;
+    if (!tail) {
+        return nil;
+    }
+    [self removeNode:tail];
+    return tail;
+}
+
+- (void)updateCost:(NSUInteger)cost ofNode:(SDLRUMemoryCacheNode *)node {
+    _totalCost = _totalCost - node->_cost + cost;
+    atomic_fetch_sub_explicit(_cacheTotalCost, node->_cost, memory_order_relaxed);
+    atomic_fetch_add_explicit(_cacheTotalCost, cost, memory_order_relaxed);
+    node->_cost = cost;
+}
+
+- (NSUInteger)tailFrequency {
+    if (!_sketch || !_tail) {
+        return NSNotFound;
+    }
+    return [_sketch frequencyForKey:_tail->_key];
+}
+
+- (BOOL)shouldAdmitKey:(id)key victimFrequency:(NSUInteger)victimFrequency {
+    if (!_sketch || victimFrequency == NSNotFound) {
+        return YES;
+    }
+    // TinyLFU, the candidate must be more popular than the victim
+    return [_sketch frequencyForKey:key] > victimFrequency;
+}
+
+- (id)removeAll {
+    id holder = CFBridgingRelease(_dic);
+    _dic = CFDictionaryCreateMutable(CFAllocatorGetDefault(), 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    atomic_fetch_sub_explicit(_cacheTotalCost, _totalCost, memory_order_relaxed);
+    atomic_fetch_sub_explicit(_cacheTotalCount, _totalCount, memory_order_relaxed);
+    _head = nil;
+    _tail = nil;
+    _totalCost = 0;
+    _totalCount = 0;
+    return holder;
+}
+
+@end
+
+#pragma mark - Cache
+
+@interface SDLRUMemoryCache () {
+    atomic_ulong _totalCost;
+    atomic_ulong _totalCount;
+    atomic_ulong _trimCursor; // the shard to trim next, so the eviction is spread round-robin
+}
+
+@property (nonatomic, strong, nullable) SDImageCacheConfig *config;
+@property (nonatomic, copy, nonnull) NSArray<SDLRUMemoryCacheShard *> *shards;
+@property (atomic, assign) NSUInteger costLimit;
+@property (atomic, assign) NSUInteger countLimit;
+
+@end
+
+@implementation SDLRUMemoryCache
+
+- (void)dealloc {
+    [_config removeObserver:self forKeyPath:NSStringFromSelector(@selector(maxMemoryCost)) context:SDLRUMemoryCacheContext];
+    [_config removeObserver:self forKeyPath:NSStringFromSelector(@selector(maxMemoryCount)) context:SDLRUMemoryCacheContext];
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _config = [[SDImageCacheConfig alloc] init];
+        [self commonInit];
+    }
+    return self;
+}
+
+- (instancetype)initWithConfig:(SDImageCacheConfig *)config {
+    self = [super init];
+    if (self) {
+        _config = config;
+        [self commonInit];
+    }
+    return self;
+}
+
+- (void)commonInit {
+    SDImageCacheConfig *config = self.config;
+    _shardCount = kSDLRUMemoryCacheShardCount;
+    NSMutableArray<SDLRUMemoryCacheShard *> *shards = [NSMutableArray arrayWithCapacity:_shardCount];
+    atomic_init(&_totalCost, 0);
+    atomic_init(&_totalCount, 0);
+    atomic_init(&_trimCursor, 0);
+    self.costLimit = SDLRUMemoryCacheLimit(config.maxMemoryCost);
+    self.countLimit = SDLRUMemoryCacheLimit(config.maxMemoryCount);
+    // The keys are spread evenly, so each shard sees about its share of the count
+    NSUInteger sketchCapacity = config.maxMemoryCount > 0 ? MAX(config.maxMemoryCount / _shardCount, 1) : kSDLRUMemoryCacheShardSketchCapacity;
+    for (NSUInteger i = 0; i < _shardCount; i++) {
+        SDLRUMemoryCacheShard *shard = [SDLRUMemoryCacheShard new];
+        shard->_cacheTotalCost = &_totalCost;
+        shard->_cacheTotalCount = &_totalCount;
+        if (config.shouldUseMemoryCacheAdmissionFilter) {
+            shard.sketch = [[SDFrequencySketch alloc] initWithCapacity:sketchCapacity];
+        }
+        [shards addObject:shard];
+    }
+    self.shards = shards;
+
+    [config addObserver:self forKeyPath:NSStringFromSelector(@selector(maxMemoryCost)) options:0 context:SDLRUMemoryCacheContext];
+    [config addObserver:self forKeyPath:NSStringFromSelector(@selector(maxMemoryCount)) options:0 context:SDLRUMemoryCacheContext];
+
+    [[SDMemoryPressureManager sharedManager] addSubscriber:self];
+}
+
+- (SDLRUMemoryCacheShard *)shardForKey:(id)key {
+    return self.shards[[key hash] & (_shardCount - 1)];
+}
+
+// Make sure to call without any shard lock held. The limits are global, a shard can exceed its share while the total is under the limit, so one large image is not evicted just because its shard is small. The shards are trimmed round-robin, one least recently used object at a time
+- (void)trimToCostLimit:(NSUInteger)costLimit countLimit:(NSUInteger)countLimit {
+    NSMutableArray *holder;
+    NSUInteger shardIndex = atomic_fetch_add_explicit(&_trimCursor, 1, memory_order_relaxed);
+    NSUInteger emptyShardCount = 0;
+    while (emptyShardCount < _shardCount
+           && (atomic_load_explicit(&_totalCost, memory_order_relaxed) > costLimit || atomic_load_explicit(&_totalCount, memory_order_relaxed) > countLimit)) {
+        SDLRUMemoryCacheShard *shard = self.shards[shardIndex & (_shardCount - 1)];
+        shardIndex++;
+        SD_LOCK(shard.lock);
+        SDLRUMemoryCacheNode *node = [shard removeTailNode];
+        SD_UNLOCK(shard.lock);
+        if (!node) {
+            emptyShardCount++;
+            continue;
+        }
+        emptyShardCount = 0;
+        if (!holder) {
+            holder = [NSMutableArray array];
+        }
+        [holder addObject:node];
+    }
+    atomic_store_explicit(&_trimCursor, shardIndex, memory_order_relaxed);
+    SDLRUMemoryCacheReleaseAsync(holder);
+}
+
+// Make sure to call without any shard lock held. The frequency of the entry which the trim evicts next to make room for the cost, NSNotFound if the cache is not full or there is no admission filter
+// The trim is global and round-robin, so the victim is the tail of the first shard not empty from the trim cursor, not the tail of the shard of candidate. Each shard is locked only while peeking, so no two shard locks are held at the same time
+// 确保在未持有任何分片锁时调用。为腾出 cost 的空间，裁剪下一个淘汰的条目的频率。如果缓存未满或没有准入过滤器，则返回 NSNotFound
+// 裁剪是全局且轮转的，因此淘汰对象是从裁剪游标开始第一个非空分片的尾节点，而不是候选者所在分片的尾节点。每个分片只在查看时加锁，因此不会同时持有两个分片锁
+- (NSUInteger)victimFrequencyForCost:(NSUInteger)cost {
+    if (!self.shards.firstObject.sketch) {
+        return NSNotFound;
+    }
+    NSUInteger costLimit = self.costLimit;
+    NSUInteger totalCost = atomic_load_explicit(&_totalCost, memory_order_relaxed);
+    NSUInteger totalCount = atomic_load_explicit(&_totalCount, memory_order_relaxed);
+    BOOL isFull = totalCount >= self.countLimit || (costLimit != NSUIntegerMax && totalCost + cost > costLimit);
+    if (!isFull) {
+        return NSNotFound;
+    }
+    NSUInteger shardIndex = atomic_load_explicit(&_trimCursor, memory_order_relaxed);
+    for (NSUInteger i = 0; i < _shardCount; i++) {
+        SDLRUMemoryCacheShard *shard = self.shards[(shardIndex + i) & (_shardCount - 1)];
+        SD_LOCK(shard.lock);
+        NSUInteger frequency = [shard tailFrequency];
+        SD_UNLOCK(shard.lock);
+        if (frequency != NSNotFound) {
+            return frequency;
+        }
+    }
+    return NSNotFound;
+}
+
+- (void)trimToLimitIfNeeded {
+    [self trimToCostLimit:self.costLimit countLimit:self.countLimit];
+}
+
+// Make sure to call with the shard lock held. Return the evicted nodes, if any
+- (nullable NSMutableArray *)trimShard:(SDLRUMemoryCacheShard *)shard toCost:(NSUInteger)costLimit count:(NSUInteger)countLimit {
+    NSMutableArray *holder;
+    while (shard->_tail && (shard->_totalCost > costLimit || shard->_totalCount > countLimit)) {
+        SDLRUMemoryCacheNode *node = [shard removeTailNode];
+        if (!holder) {
+            holder = [NSMutableArray array];
+        }
+        [holder addObject:node];
+    }
+    return holder;
+}
+
+#pragma mark - SDMemoryPressureSubscriber
+
+- (void)trimToFraction:(double)fraction {
+    // Only remove cache, but keep weak cache. Each shard evicts its least recently used objects
+    // 只删除缓存，但保留 weak 缓存。每个分片淘汰其最近最少使用的对象
+    for (SDLRUMemoryCacheShard *shard in self.shards) {
+        SD_LOCK(shard.lock);
+        id holder;
+        if (fraction <= 0) {
+            holder = [shard removeAll];
+        } else {
+            holder = [self trimShard:shard toCost:(NSUInteger)(shard->_totalCost * fraction) count:(NSUInteger)(shard->_totalCount * fraction)];
+        }
+        SD_UNLOCK(shard.lock);
+        SDLRUMemoryCacheReleaseAsync(holder);
+    }
+}
+
+- (NSUInteger)memoryPressureCost {
+    return self.totalCost;
+}
+
+#pragma mark - SDMemoryCache
+
+- (id)objectForKey:(id)key {
+    if (!key) {
+        return nil;
+    }
+    SDLRUMemoryCacheShard *shard = [self shardForKey:key];
+    id obj;
+    BOOL needsTrim = NO;
+    SD_LOCK(shard.lock);
+    // Record the misses as well, so an image requested again is admitted when stored
+    [shard.sketch incrementKey:key];
+    SDLRUMemoryCacheNode *node = [shard nodeForKey:key];
+    if (node) {
+        [shard bringNodeToHead:node];
+        obj = node->_value;
+    }
+#if SD_UIKIT
+    else if (self.config.shouldUseWeakMemoryCache) {
+        // Check weak cache
+        obj = [shard.weakCache objectForKey:key];
+        if (obj) {
+            // Sync cache
+            node = [SDLRUMemoryCacheNode new];
+            node->_key = key;
+            node->_value = obj;
+            if ([obj isKindOfClass:[UIImage class]]) {
+                node->_cost = [(UIImage *)obj sd_memoryCost];
+            }
+            [shard insertNodeAtHead:node];
+            needsTrim = YES;
+        }
+    }
+#endif
+    SD_UNLOCK(shard.lock);
+    if (needsTrim) {
+        [self trimToLimitIfNeeded];
+    }
+    return obj;
+}
+
+- (void)setObject:(id)object forKey:(id)key {
+    [self setObject:object forKey:key cost:0];
+}
+
+- (void)setObject:(id)object forKey:(id)key cost:(NSUInteger)cost {
+    if (!key) {
+        return;
+    }
+    if (!object) {
+        [self removeObjectForKey:key];
+        return;
+    }
+    SDLRUMemoryCacheShard *shard = [self shardForKey:key];
+    // Peeked before locking the shard of key, it's only used when the key is new
+    // 在锁定 key 所在分片之前查看，仅在 key 是新的时使用
+    NSUInteger victimFrequency = [self victimFrequencyForCost:cost];
+    SD_LOCK(shard.lock);
+    SDLRUMemoryCacheNode *node = [shard nodeForKey:key];
+    if (node) {
+        [shard updateCost:cost ofNode:node];
+        node->_value = object;
+        [shard bringNodeToHead:node];
+    } else if ([shard shouldAdmitKey:key victimFrequency:victimFrequency]) {
+        node = [SDLRUMemoryCacheNode new];
+        node->_key = key;
+        node->_value = object;
+        node->_cost = cost;
+        [shard insertNodeAtHead:node];
+    }
+#if SD_UIKIT
+    if (self.config.shouldUseWeakMemoryCache) {
+        // Store weak cache
+        [shard.weakCache setObject:object forKey:key];
+    }
+#endif
+    SD_UNLOCK(shard.lock);
+    [self trimToLimitIfNeeded];
+    if ([object isKindOfClass:[UIImage class]] && [[object class] conformsToProtocol:@protocol(SDAnimatedImage)]) {
+        // The animated image cost changes when frames are loaded, track it
+        // 动图的开销会在帧加载时变化，需要跟踪
+        [(UIImage *)object sd_trackMemoryCostInCache:self key:key];
+    }
+    [[SDMemoryPressureManager sharedManager] setNeedsEnforceMemoryBudget];
+}
+
+- (void)updateCost:(NSUInteger)cost forObject:(id)object key:(id)key {
+    if (!object || !key) {
+        return;
+    }
+    SDLRUMemoryCacheShard *shard = [self shardForKey:key];
+    BOOL needsTrim = NO;
+    SD_LOCK(shard.lock);
+    SDLRUMemoryCacheNode *node = [shard nodeForKey:key];
+    // Only update when it's not evicted or replaced, and keep the LRU order
+    // 仅在未被淘汰或替换时更新，并保持 LRU 顺序
+    if (node && node->_value == object && node->_cost != cost) {
+        needsTrim = cost > node->_cost;
+        [shard updateCost:cost ofNode:node];
+    }
+    SD_UNLOCK(shard.lock);
+    if (needsTrim) {
+        [self trimToLimitIfNeeded];
+    }
+    [[SDMemoryPressureManager sharedManager] setNeedsEnforceMemoryBudget];
+}
+
+- (void)removeObjectForKey:(id)key {
+    if (!key) {
+        return;
+    }
+    SDLRUMemoryCacheShard *shard = [self shardForKey:key];
+    SD_LOCK(shard.lock);
+    SDLRUMemoryCacheNode *node = [shard nodeForKey:key];
+    if (node) {
+        [shard removeNode:node];
+    }
+#if SD_UIKIT
+    if (self.config.shouldUseWeakMemoryCache) {
+        // Remove weak cache
+        [shard.weakCache removeObjectForKey:key];
+    }
+#endif
+    SD_UNLOCK(shard.lock);
+    SDLRUMemoryCacheReleaseAsync(node);
+}
+
+- (void)removeAllObjects {
+    for (SDLRUMemoryCacheShard *shard in self.shards) {
+        SD_LOCK(shard.lock);
+        id holder = [shard removeAll];
+#if SD_UIKIT
+        if (self.config.shouldUseWeakMemoryCache) {
+            // Manually remove should also remove weak cache
+            [shard.weakCache removeAllObjects];
+        }
+#endif
+        SD_UNLOCK(shard.lock);
+        SDLRUMemoryCacheReleaseAsync(holder);
+    }
+}
+
+#pragma mark - Trim
+
+- (NSUInteger)totalCost {
+    return atomic_load_explicit(&_totalCost, memory_order_relaxed);
+}
+
+- (NSUInteger)totalCount {
+    return atomic_load_explicit(&_totalCount, memory_order_relaxed);
+}
+
+- (void)trimToCost:(NSUInteger)cost {
+    [self trimToCostLimit:cost countLimit:NSUIntegerMax];
+}
+
+- (void)trimToCount:(NSUInteger)count {
+    [self trimToCostLimit:NSUIntegerMax countLimit:count];
+}
+
+#pragma mark - KVO
+
+- (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary<NSKeyValueChangeKey,id> *)change context:(void *)context {
+    if (context == SDLRUMemoryCacheContext) {
+        if ([keyPath isEqualToString:NSStringFromSelector(@selector(maxMemoryCost))]) {
+            self.costLimit = SDLRUMemoryCacheLimit(self.config.maxMemoryCost);
+            if (self.config.maxMemoryCost > 0) {
+                [self trimToCost:self.config.maxMemoryCost];
+            }
+        } else if ([keyPath isEqualToString:NSStringFromSelector(@selector(maxMemoryCount))]) {
+            self.countLimit = SDLRUMemoryCacheLimit(self.config.maxMemoryCount);
+            if (self.config.maxMemoryCount > 0) {
+                [self trimToCount:self.config.maxMemoryCount];
+            }
+        }
+    } else {
+        [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
+    }
+}
+
+@end
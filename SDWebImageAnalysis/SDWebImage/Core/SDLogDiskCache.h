@@ -0,0 +1,34 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDWebImageCompat.h"
+#import "SDDiskCache.h"
+
+// A log-structured disk cache. Instead of one file per key, entries are appended to a few segment files, and an in-memory index maps each key to its segment, offset, length and dates.
+// Reading an entry is one `pread`, `totalSize`/`totalCount` never touch the file system, and `removeExpiredData` picks the entries from the index and appends a tombstone for each removed one, then compacts the segments which contain mostly dead entries. Both are done in bounded steps, the lock is released between them, so reads and writes go on meanwhile.
+// The index is checkpointed atomically to disk, and the records appended after the last checkpoint are replayed on launch, so a crash only lose the torn tail record.
+// 一种日志结构的磁盘缓存。不再为每个 key 写一个文件，而是把条目追加写入少量的分段文件中，并使用内存中的索引将每个 key 映射到它所在的分段、偏移、长度和日期。
+// 读取一个条目只需要一次 `pread`，`totalSize`/`totalCount` 不会访问文件系统，`removeExpiredData` 从索引中挑选条目，并为每个被删除的条目追加一条删除记录，然后压缩包含大量无效条目的分段。两者都分步进行，步骤之间会释放锁，因此读写可以同时进行。
+// 索引会原子地写入磁盘作为检查点，启动时会重放最后一次检查点之后追加的记录，因此崩溃时只会丢失被截断的最后一条记录。
+@interface SDLogDiskCache : NSObject <SDDiskCache>
+
+// Cache Config object - storing all kind of settings.
+// 缓存配置对象 - 存储所有类型的设置
+@property (nonatomic, strong, readonly, nonnull) SDImageCacheConfig *config;
+
+- (nonnull instancetype)init NS_UNAVAILABLE;
+
+// The entries are not stored as individual files, so this always return nil.
+// 条目不会存储为单独的文件，因此总是返回 nil。
+- (nullable NSString *)cachePathForKey:(nonnull NSString *)key;
+
+// Write the in-memory index to disk immediately. This is done automatically in background after some writes and after `removeExpiredData`.
+// 立即将内存中的索引写入磁盘。在一定次数的写入后以及 `removeExpiredData` 之后会自动在后台进行。
+- (void)checkpoint;
+
+@end
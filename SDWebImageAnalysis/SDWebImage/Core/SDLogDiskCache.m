@@ -0,0 +1,863 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDLogDiskCache.h"
+#import "SDImageCacheConfig.h"
+#import "SDInternalMacros.h"
+#import <fcntl.h>
+#import <unistd.h>
+#import <sys/stat.h>
+#import <sys/uio.h>
+
+static const uint32_t kSDLogDiskCacheRecordMagic = 0x53444C47; // "SDLG"
+static const uint32_t kSDLogDiskCacheIndexMagic = 0x53444C49; // "SDLI"
+static const uint32_t kSDLogDiskCacheIndexVersion = 1;
+// Start a new segment when the active one grows beyond this size
+// 当前分段超过此大小时开始新的分段
+static const uint64_t kSDLogDiskCacheSegmentSize = 32 * 1024 * 1024;
+// Checkpoint the index after this number of writes and removes
+// 每写入和删除这么多次后保存一次索引检查点
+static const NSUInteger kSDLogDiskCacheCheckpointInterval = 256;
+// Compact a sealed segment when less than this ratio of its bytes are still alive
+// 当已封闭分段中的有效字节比例低于此值时压缩该分段
+static const double kSDLogDiskCacheCompactionRatio = 0.5;
+// The number of keys removed in one hold of the lock during `removeExpiredData`
+// `removeExpiredData` 期间每次持有锁时删除的 key 的数量
+static const NSUInteger kSDLogDiskCacheRemovalBatchCount = 64;
+static NSString * const kSDLogDiskCacheIndexFileName = @"index";
+static NSString * const kSDLogDiskCacheSegmentExtension = @"log";
+
+typedef NS_ENUM(uint32_t, SDLogDiskCacheRecordType) {
+    SDLogDiskCacheRecordTypeSet = 1,
+    SDLogDiskCacheRecordTypeRemove = 2
+};
+
+// Record layout in segment: header, key bytes (UTF-8), data bytes
+// 分段中的记录布局：header，key 字节（UTF-8），data 字节
+typedef struct {
+    uint32_t magic;
+    uint32_t type;
+    uint32_t keyLength;
+    uint32_t dataLength;
+    double modificationTime;
+} SDLogDiskCacheRecordHeader;
+
+// Entry layout in index file, followed by the key bytes (UTF-8)
+// 索引文件中的条目布局，后面跟着 key 字节（UTF-8）
+typedef struct {
+    uint32_t segmentID;
+    uint32_t keyLength;
+    uint64_t offset;
+    uint32_t dataLength;
+    uint32_t flags;
+    double modificationTime;
+    double accessTime;
+} SDLogDiskCacheIndexEntry;
+
+// The index entry is the tombstone of a removed key, only the segment ID and the key are meaningful
+// 该索引条目是已删除 key 的删除记录，只有分段 ID 和 key 有意义
+static const uint32_t kSDLogDiskCacheIndexEntryTombstone = 1;
+
+static inline uint64_t SDLogDiskCacheRecordSize(uint32_t keyLength, uint32_t dataLength) {
+    return sizeof(SDLogDiskCacheRecordHeader) + keyLength + dataLength;
+}
+
+#pragma mark - Entry
+
+@interface SDLogDiskCacheEntry : NSObject {
+    @package
+    uint32_t _segmentID;
+    uint64_t _offset; // offset of the record, not the data
+    uint32_t _keyLength;
+    uint32_t _dataLength;
+    NSTimeInterval _modificationTime;
+    NSTimeInterval _accessTime;
+}
+@end
+
+@implementation SDLogDiskCacheEntry
+@end
+
+#pragma mark - Segment
+
+@interface SDLogDiskCacheSegment : NSObject {
+    @package
+    uint32_t _segmentID;
+    int _fd;
+    uint64_t _length;
+    uint64_t _liveBytes;
+}
+@end
+
+@implementation SDLogDiskCacheSegment
+
+// The file descriptor keeps valid until the segment is released, even if the file is unlinked by compaction, so readers holding the segment can still read.
+- (void)dealloc {
+    if (_fd >= 0) {
+        close(_fd);
+    }
+}
+
+@end
+
+#pragma mark - Checkpoint
+
+// Serialize the index: header, segment lengths, entries and tombstones, see `SDLogDiskCacheIndexEntry`
+static NSData * SDLogDiskCacheCheckpointData(NSDictionary<NSNumber *, NSNumber *> *segmentLengths, NSDictionary<NSString *, SDLogDiskCacheEntry *> *entries, NSDictionary<NSString *, NSNumber *> *tombstones) {
+    NSMutableData *data = [NSMutableData data];
+    uint32_t header[4] = {kSDLogDiskCacheIndexMagic, kSDLogDiskCacheIndexVersion, (uint32_t)segmentLengths.count, (uint32_t)(entries.count + tombstones.count)};
+    [data appendBytes:header length:sizeof(header)];
+    [segmentLengths enumerateKeysAndObjectsUsingBlock:^(NSNumber * _Nonnull segmentID, NSNumber * _Nonnull segmentLength, BOOL * _Nonnull stop) {
+        uint32_t segmentHeader[2] = {segmentID.unsignedIntValue, 0};
+        uint64_t length = segmentLength.unsignedLongLongValue;
+        [data appendBytes:segmentHeader length:sizeof(segmentHeader)];
+        [data appendBytes:&length length:sizeof(uint64_t)];
+    }];
+    [entries enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull key, SDLogDiskCacheEntry * _Nonnull entry, BOOL * _Nonnull stop) {
+        SDLogDiskCacheIndexEntry indexEntry = {
+            .segmentID = entry->_segmentID,
+            .keyLength = entry->_keyLength,
+            .offset = entry->_offset,
+            .dataLength = entry->_dataLength,
+            .flags = 0,
+            .modificationTime = entry->_modificationTime,
+            .accessTime = entry->_accessTime
+        };
+        [data appendBytes:&indexEntry length:sizeof(indexEntry)];
+        const char *keyBytes = key.UTF8String;
+        [data appendBytes:keyBytes length:entry->_keyLength];
+    }];
+    [tombstones enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull key, NSNumber * _Nonnull segmentID, BOOL * _Nonnull stop) {
+        const char *keyBytes = key.UTF8String;
+        SDLogDiskCacheIndexEntry indexEntry = {
+            .segmentID = segmentID.unsignedIntValue,
+            .keyLength = (uint32_t)strlen(keyBytes),
+            .flags = kSDLogDiskCacheIndexEntryTombstone
+        };
+        [data appendBytes:&indexEntry length:sizeof(indexEntry)];
+        [data appendBytes:keyBytes length:indexEntry.keyLength];
+    }];
+    return data;
+}
+
+#pragma mark - Cache
+
+@interface SDLogDiskCache ()
+
+@property (nonatomic, copy) NSString *diskCachePath;
+@property (nonatomic, strong, nonnull) NSFileManager *fileManager;
+@property (nonatomic, strong, nonnull) dispatch_semaphore_t lock; // a lock to keep the access to index and segments thread-safe
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSString *, SDLogDiskCacheEntry *> *entries;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSNumber *, SDLogDiskCacheSegment *> *segments;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSString *, NSNumber *> *tombstones; // the segment ID of the remove record of each removed key, kept while an older segment may still hold a set record of the key
+@property (nonatomic, strong, nonnull) dispatch_queue_t checkpointQueue; // serial, the segment syncs and the index writes run in order, without the lock held
+@property (nonatomic, strong, nullable) SDLogDiskCacheSegment *activeSegment;
+@property (nonatomic, assign) uint32_t nextSegmentID;
+@property (nonatomic, assign) NSUInteger pendingMutationCount;
+
+@end
+
+@implementation SDLogDiskCache
+
+- (instancetype)init {
+    NSAssert(NO, @"Use `initWithCachePath:` with the disk cache path");
+    return nil;
+}
+
+- (void)dealloc {
+    if (_pendingMutationCount > 0) {
+        [self _checkpoint];
+    }
+}
+
+#pragma mark - SDDiskCache Protocol
+
+- (instancetype)initWithCachePath:(NSString *)cachePath config:(nonnull SDImageCacheConfig *)config {
+    if (self = [super init]) {
+        _diskCachePath = cachePath;
+        _config = config;
+        [self commonInit];
+    }
+    return self;
+}
+
+- (void)commonInit {
+    if (self.config.fileManager) {
+        self.fileManager = self.config.fileManager;
+    } else {
+        self.fileManager = [NSFileManager new];
+    }
+    self.lock = dispatch_semaphore_create(1);
+    self.entries = [NSMutableDictionary dictionary];
+    self.segments = [NSMutableDictionary dictionary];
+    self.tombstones = [NSMutableDictionary dictionary];
+    self.checkpointQueue = dispatch_queue_create("com.hackemist.SDLogDiskCache.checkpoint", DISPATCH_QUEUE_SERIAL);
+    [self createDirectoryIfNeeded];
+    [self loadIndex];
+}
+
+- (BOOL)containsDataForKey:(NSString *)key {
+    NSParameterAssert(key);
+    SD_LOCK(self.lock);
+    BOOL exists = self.entries[key] != nil;
+    SD_UNLOCK(self.lock);
+    return exists;
+}
+
+- (NSData *)dataForKey:(NSString *)key {
+    NSParameterAssert(key);
+    SD_LOCK(self.lock);
+    SDLogDiskCacheEntry *entry = self.entries[key];
+    SDLogDiskCacheSegment *segment = entry ? self.segments[@(entry->_segmentID)] : nil;
+    if (!segment) {
+        SD_UNLOCK(self.lock);
+        return nil;
+    }
+    entry->_accessTime = [NSDate date].timeIntervalSince1970;
+    uint64_t offset = entry->_offset + sizeof(SDLogDiskCacheRecordHeader) + entry->_keyLength;
+    size_t length = entry->_dataLength;
+    SD_UNLOCK(self.lock);
+
+    // Read outside the lock, the segment is retained so the file descriptor keeps valid
+    // 在锁外读取，分段被持有，因此文件描述符保持有效
+    return [self readDataFromSegment:segment offset:offset length:length];
+}
+
+- (void)setData:(NSData *)data forKey:(NSString *)key {
+    NSParameterAssert(data);
+    NSParameterAssert(key);
+    SD_LOCK(self.lock);
+    SDLogDiskCacheEntry *entry = [self appendRecordWithType:SDLogDiskCacheRecordTypeSet key:key data:data modificationTime:[NSDate date].timeIntervalSince1970];
+    if (entry) {
+        [self setEntry:entry forKey:key];
+        [self didMutate];
+    }
+    SD_UNLOCK(self.lock);
+}
+
+- (void)removeDataForKey:(NSString *)key {
+    NSParameterAssert(key);
+    SD_LOCK(self.lock);
+    if (self.entries[key]) {
+        [self removeEntryWithTombstoneForKey:key];
+    }
+    SD_UNLOCK(self.lock);
+}
+
+- (void)removeAllData {
+    SD_LOCK(self.lock);
+    // Wait for the checkpoint in progress, which would write the stale index after the directory is removed
+    dispatch_sync(self.checkpointQueue, ^{});
+    [self.entries removeAllObjects];
+    [self.segments removeAllObjects];
+    [self.tombstones removeAllObjects];
+    self.activeSegment = nil;
+    self.nextSegmentID = 0;
+    self.pendingMutationCount = 0;
+    [self.fileManager removeItemAtPath:self.diskCachePath error:nil];
+    [self createDirectoryIfNeeded];
+    SD_UNLOCK(self.lock);
+}
+
+- (void)removeExpiredData {
+    BOOL useAccessTime = self.config.diskCacheExpireType == SDImageCacheConfigExpireTypeAccessDate;
+    // The entries are picked from the index, then removed in batches, the lock is released between them
+    // 从索引中挑选条目，然后分批删除，批次之间会释放锁
+
+    // 1. Remove entries that are older than the expiration date
+    // 1. 删除超过过期日期的条目
+    if (self.config.maxDiskAge >= 0) {
+        NSTimeInterval expirationTime = [NSDate date].timeIntervalSince1970 - self.config.maxDiskAge;
+        NSMutableArray<NSString *> *expiredKeys = [NSMutableArray array];
+        NSMutableArray<SDLogDiskCacheEntry *> *expiredEntries = [NSMutableArray array];
+        SD_LOCK(self.lock);
+        [self.entries enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull key, SDLogDiskCacheEntry * _Nonnull entry, BOOL * _Nonnull stop) {
+            NSTimeInterval time = useAccessTime ? entry->_accessTime : entry->_modificationTime;
+            if (time <= expirationTime) {
+                [expiredKeys addObject:key];
+                [expiredEntries addObject:entry];
+            }
+        }];
+        SD_UNLOCK(self.lock);
+        [self removeKeys:expiredKeys entries:expiredEntries];
+    }
+
+    // 2. If the remaining entries exceed the maximum size, remove the oldest ones until half of the maximum size
+    // 2. 如果剩余的条目超过了最大 size，删除最旧的条目直到最大 size 的一半
+    NSUInteger maxDiskSize = self.config.maxDiskSize;
+    if (maxDiskSize > 0) {
+        NSMutableArray<NSString *> *trimmedKeys = [NSMutableArray array];
+        NSMutableArray<SDLogDiskCacheEntry *> *trimmedEntries = [NSMutableArray array];
+        SD_LOCK(self.lock);
+        uint64_t currentCacheSize = [self liveBytes];
+        if (currentCacheSize > maxDiskSize) {
+            const uint64_t desiredCacheSize = maxDiskSize / 2;
+            NSArray<NSString *> *sortedKeys = [self.entries keysSortedByValueWithOptions:NSSortConcurrent usingComparator:^NSComparisonResult(SDLogDiskCacheEntry * _Nonnull entry1, SDLogDiskCacheEntry * _Nonnull entry2) {
+                NSTimeInterval time1 = useAccessTime ? entry1->_accessTime : entry1->_modificationTime;
+                NSTimeInterval time2 = useAccessTime ? entry2->_accessTime : entry2->_modificationTime;
+                return time1 < time2 ? NSOrderedAscending : (time1 > time2 ? NSOrderedDescending : NSOrderedSame);
+            }];
+            for (NSString *key in sortedKeys) {
+                SDLogDiskCacheEntry *entry = self.entries[key];
+                currentCacheSize -= SDLogDiskCacheRecordSize(entry->_keyLength, entry->_dataLength);
+                [trimmedKeys addObject:key];
+                [trimmedEntries addObject:entry];
+                if (currentCacheSize < desiredCacheSize) {
+                    break;
+                }
+            }
+        }
+        SD_UNLOCK(self.lock);
+        [self removeKeys:trimmedKeys entries:trimmedEntries];
+    }
+
+    // 3. Reclaim the space of dead entries
+    // 3. 回收无效条目的空间
+    [self compact];
+}
+
+// Remove the keys whose entries are not changed meanwhile, with the lock held for one batch at a time
+- (void)removeKeys:(NSArray<NSString *> *)keys entries:(NSArray<SDLogDiskCacheEntry *> *)entries {
+    for (NSUInteger i = 0; i < keys.count; i += kSDLogDiskCacheRemovalBatchCount) {
+        NSUInteger end = MIN(i + kSDLogDiskCacheRemovalBatchCount, keys.count);
+        SD_LOCK(self.lock);
+        for (NSUInteger j = i; j < end; j++) {
+            if (self.entries[keys[j]] == entries[j]) {
+                [self removeEntryWithTombstoneForKey:keys[j]];
+            }
+        }
+        SD_UNLOCK(self.lock);
+    }
+}
+
+- (nullable NSString *)cachePathForKey:(NSString *)key {
+    NSParameterAssert(key);
+    return nil;
+}
+
+- (NSUInteger)totalSize {
+    SD_LOCK(self.lock);
+    uint64_t size = 0;
+    for (SDLogDiskCacheSegment *segment in self.segments.allValues) {
+        size += segment->_length;
+    }
+    SD_UNLOCK(self.lock);
+    return (NSUInteger)size;
+}
+
+- (NSUInteger)totalCount {
+    SD_LOCK(self.lock);
+    NSUInteger count = self.entries.count;
+    SD_UNLOCK(self.lock);
+    return count;
+}
+
+- (void)checkpoint {
+    SD_LOCK(self.lock);
+    [self _checkpoint];
+    SD_UNLOCK(self.lock);
+}
+
+#pragma mark - Index
+
+// Make sure to call with the lock held
+- (void)setEntry:(SDLogDiskCacheEntry *)entry forKey:(NSString *)key {
+    SDLogDiskCacheEntry *oldEntry = self.entries[key];
+    if (oldEntry) {
+        [self markEntryDead:oldEntry];
+    }
+    self.entries[key] = entry;
+    [self.tombstones removeObjectForKey:key];
+    SDLogDiskCacheSegment *segment = self.segments[@(entry->_segmentID)];
+    segment->_liveBytes += SDLogDiskCacheRecordSize(entry->_keyLength, entry->_dataLength);
+}
+
+// Make sure to call with the lock held. Append a tombstone, so replaying the log after a crash does not bring the entry back
+- (void)removeEntryWithTombstoneForKey:(NSString *)key {
+    SDLogDiskCacheEntry *tombstone = [self appendRecordWithType:SDLogDiskCacheRecordTypeRemove key:key data:nil modificationTime:[NSDate date].timeIntervalSince1970];
+    [self removeEntryForKey:key];
+    if (tombstone) {
+        self.tombstones[key] = @(tombstone->_segmentID);
+    }
+    [self didMutate];
+}
+
+// Make sure to call with the lock held
+- (void)removeEntryForKey:(NSString *)key {
+    SDLogDiskCacheEntry *entry = self.entries[key];
+    if (!entry) {
+        return;
+    }
+    [self markEntryDead:entry];
+    [self.entries removeObjectForKey:key];
+}
+
+- (void)markEntryDead:(SDLogDiskCacheEntry *)entry {
+    SDLogDiskCacheSegment *segment = self.segments[@(entry->_segmentID)];
+    uint64_t recordSize = SDLogDiskCacheRecordSize(entry->_keyLength, entry->_dataLength);
+    segment->_liveBytes = segment->_liveBytes > recordSize ? segment->_liveBytes - recordSize : 0;
+}
+
+- (uint64_t)liveBytes {
+    uint64_t bytes = 0;
+    for (SDLogDiskCacheSegment *segment in self.segments.allValues) {
+        bytes += segment->_liveBytes;
+    }
+    return bytes;
+}
+
+- (void)didMutate {
+    self.pendingMutationCount++;
+    if (self.pendingMutationCount >= kSDLogDiskCacheCheckpointInterval) {
+        // The records are already in the log, the checkpoint only shortens the replay on launch, so it's written in background
+        // 记录已经在日志中，检查点只是缩短启动时的重放，因此在后台写入
+        [self checkpointWaitUntilDone:NO];
+    }
+}
+
+- (void)loadIndex {
+    // Open all the existing segments
+    // 打开所有已存在的分段
+    NSArray<NSString *> *fileNames = [self.fileManager contentsOfDirectoryAtPath:self.diskCachePath error:nil];
+    for (NSString *fileName in fileNames) {
+        if (![fileName.pathExtension isEqualToString:kSDLogDiskCacheSegmentExtension]) {
+            continue;
+        }
+        uint32_t segmentID = (uint32_t)fileName.stringByDeletingPathExtension.longLongValue;
+        SDLogDiskCacheSegment *segment = [self openSegmentWithID:segmentID create:NO];
+        if (segment) {
+            self.segments[@(segmentID)] = segment;
+            self.nextSegmentID = MAX(self.nextSegmentID, segmentID + 1);
+        }
+    }
+
+    // Restore the last checkpoint. If it's missing or does not match the segments, rebuild the index from the whole log
+    // 恢复最后一次检查点。如果检查点不存在或与分段不匹配，则从整个日志重建索引
+    NSDictionary<NSNumber *, NSNumber *> *checkpointLengths = [self restoreCheckpoint];
+    if (!checkpointLengths) {
+        [self.entries removeAllObjects];
+        [self.tombstones removeAllObjects];
+    } else {
+        // Segment IDs only grow, so a segment older than the checkpointed ones but not in the checkpoint was already compacted, delete it
+        // 分段 ID 只会增长，因此比检查点中的分段更旧但不在检查点中的分段已经被压缩过，删除它
+        NSNumber *maxCheckpointedID = [checkpointLengths.allKeys valueForKeyPath:@"@max.self"];
+        for (NSNumber *segmentID in self.segments.allKeys) {
+            if (maxCheckpointedID && !checkpointLengths[segmentID] && [segmentID compare:maxCheckpointedID] == NSOrderedAscending) {
+                [self.segments removeObjectForKey:segmentID];
+                [self.fileManager removeItemAtPath:[self pathForSegmentID:segmentID.unsignedIntValue] error:nil];
+            }
+        }
+    }
+    for (SDLogDiskCacheEntry *entry in self.entries.allValues) {
+        SDLogDiskCacheSegment *segment = self.segments[@(entry->_segmentID)];
+        segment->_liveBytes += SDLogDiskCacheRecordSize(entry->_keyLength, entry->_dataLength);
+    }
+
+    // Replay the records appended after the checkpoint, in order
+    // 按顺序重放检查点之后追加的记录
+    NSArray<NSNumber *> *segmentIDs = [self.segments.allKeys sortedArrayUsingSelector:@selector(compare:)];
+    for (NSNumber *segmentID in segmentIDs) {
+        SDLogDiskCacheSegment *segment = self.segments[segmentID];
+        [self replaySegment:segment fromOffset:checkpointLengths[segmentID].unsignedLongLongValue];
+    }
+    if (segmentIDs.lastObject) {
+        self.activeSegment = self.segments[segmentIDs.lastObject];
+    }
+}
+
+- (nullable NSDictionary<NSNumber *, NSNumber *> *)restoreCheckpoint {
+    NSString *indexPath = [self.diskCachePath stringByAppendingPathComponent:kSDLogDiskCacheIndexFileName];
+    NSData *data = [NSData dataWithContentsOfFile:indexPath options:NSDataReadingMappedIfSafe error:nil];
+    const uint8_t *bytes = data.bytes;
+    NSUInteger length = data.length;
+    NSUInteger cursor = 0;
+
+    uint32_t header[4]; // magic, version, segment count, entry count
+    if (length < sizeof(header)) {
+        return nil;
+    }
+    memcpy(header, bytes, sizeof(header));
+    cursor += sizeof(header);
+    if (header[0] != kSDLogDiskCacheIndexMagic || header[1] != kSDLogDiskCacheIndexVersion) {
+        return nil;
+    }
+
+    NSMutableDictionary<NSNumber *, NSNumber *> *lengths = [NSMutableDictionary dictionaryWithCapacity:header[2]];
+    for (uint32_t i = 0; i < header[2]; i++) {
+        uint32_t segmentID;
+        uint64_t segmentLength;
+        if (cursor + sizeof(uint32_t) * 2 + sizeof(uint64_t) > length) {
+            return nil;
+        }
+        memcpy(&segmentID, bytes + cursor, sizeof(uint32_t));
+        cursor += sizeof(uint32_t) * 2;
+        memcpy(&segmentLength, bytes + cursor, sizeof(uint64_t));
+        cursor += sizeof(uint64_t);
+        // The segment was lost or truncated after the checkpoint
+        // 检查点之后分段丢失或被截断
+        SDLogDiskCacheSegment *segment = self.segments[@(segmentID)];
+        if (!segment || segment->_length < segmentLength) {
+            return nil;
+        }
+        lengths[@(segmentID)] = @(segmentLength);
+    }
+
+    NSMutableDictionary<NSString *, SDLogDiskCacheEntry *> *entries = [NSMutableDictionary dictionaryWithCapacity:header[3]];
+    NSMutableDictionary<NSString *, NSNumber *> *tombstones = [NSMutableDictionary dictionary];
+    for (uint32_t i = 0; i < header[3]; i++) {
+        SDLogDiskCacheIndexEntry indexEntry;
+        if (cursor + sizeof(indexEntry) > length) {
+            return nil;
+        }
+        memcpy(&indexEntry, bytes + cursor, sizeof(indexEntry));
+        cursor += sizeof(indexEntry);
+        if (cursor + indexEntry.keyLength > length) {
+            return nil;
+        }
+        NSString *key = [[NSString alloc] initWithBytes:bytes + cursor length:indexEntry.keyLength encoding:NSUTF8StringEncoding];
+        cursor += indexEntry.keyLength;
+        NSNumber *segmentLength = lengths[@(indexEntry.segmentID)];
+        if (key && segmentLength && (indexEntry.flags & kSDLogDiskCacheIndexEntryTombstone)) {
+            tombstones[key] = @(indexEntry.segmentID);
+            continue;
+        }
+        if (!key || !segmentLength || indexEntry.offset + SDLogDiskCacheRecordSize(indexEntry.keyLength, indexEntry.dataLength) > segmentLength.unsignedLongLongValue) {
+            return nil;
+        }
+        SDLogDiskCacheEntry *entry = [SDLogDiskCacheEntry new];
+        entry->_segmentID = indexEntry.segmentID;
+        entry->_offset = indexEntry.offset;
+        entry->_keyLength = indexEntry.keyLength;
+        entry->_dataLength = indexEntry.dataLength;
+        entry->_modificationTime = indexEntry.modificationTime;
+        entry->_accessTime = indexEntry.accessTime;
+        entries[key] = entry;
+    }
+
+    self.entries = entries;
+    self.tombstones = tombstones;
+    return [lengths copy];
+}
+
+// Make sure to call with the lock held
+- (void)_checkpoint {
+    [self checkpointWaitUntilDone:YES];
+}
+
+// Make sure to call with the lock held. The index is captured under the lock, but serialized and written in checkpoint queue, so a large index does not block the readers. The checkpoints are written in order
+- (void)checkpointWaitUntilDone:(BOOL)waitUntilDone {
+    NSMutableDictionary<NSNumber *, NSNumber *> *segmentLengths = [NSMutableDictionary dictionaryWithCapacity:self.segments.count];
+    for (SDLogDiskCacheSegment *segment in self.segments.allValues) {
+        segmentLengths[@(segment->_segmentID)] = @(segment->_length);
+    }
+    // The entries are not changed after appended, only the access time is updated
+    NSDictionary<NSString *, SDLogDiskCacheEntry *> *entries = [self.entries copy];
+    NSDictionary<NSString *, NSNumber *> *tombstones = [self.tombstones copy];
+    SDLogDiskCacheSegment *activeSegment = self.activeSegment;
+    NSString *indexPath = [self.diskCachePath stringByAppendingPathComponent:kSDLogDiskCacheIndexFileName];
+    self.pendingMutationCount = 0;
+
+    // Do not capture self, this is also called from dealloc
+    dispatch_block_t block = ^{
+        @autoreleasepool {
+            // Make sure the checkpointed segment length is durable before the index point to it. The sealed segments are synced when sealed, in this queue before
+            // 确保索引引用分段长度之前，分段的数据已经持久化。已封闭的分段在封闭时已经在此队列中同步过
+            if (activeSegment) {
+                fsync(activeSegment->_fd);
+            }
+            NSData *data = SDLogDiskCacheCheckpointData(segmentLengths, entries, tombstones);
+            // Atomic writing, the old checkpoint keeps valid until the new one is complete
+            // 原子写入，新检查点完成之前旧检查点一直有效
+            [data writeToFile:indexPath options:NSDataWritingAtomic error:nil];
+        }
+    };
+    if (waitUntilDone) {
+        dispatch_sync(self.checkpointQueue, block);
+    } else {
+        dispatch_async(self.checkpointQueue, block);
+    }
+}
+
+#pragma mark - Segments
+
+- (void)createDirectoryIfNeeded {
+    if (![self.fileManager fileExistsAtPath:self.diskCachePath]) {
+        [self.fileManager createDirectoryAtPath:self.diskCachePath withIntermediateDirectories:YES attributes:nil error:NULL];
+    }
+    // disable iCloud backup, the directory flag applies to all the segments inside
+    // 禁用 iCloud 备份，目录的标记会作用于其中所有的分段
+    if (self.config.shouldDisableiCloud) {
+        NSURL *directoryURL = [NSURL fileURLWithPath:self.diskCachePath isDirectory:YES];
+        [directoryURL setResourceValue:@YES forKey:NSURLIsExcludedFromBackupKey error:nil];
+    }
+}
+
+- (NSString *)pathForSegmentID:(uint32_t)segmentID {
+    NSString *fileName = [[NSString stringWithFormat:@"%08u", segmentID] stringByAppendingPathExtension:kSDLogDiskCacheSegmentExtension];
+    return [self.diskCachePath stringByAppendingPathComponent:fileName];
+}
+
+- (nullable SDLogDiskCacheSegment *)openSegmentWithID:(uint32_t)segmentID create:(BOOL)create {
+    NSString *path = [self pathForSegmentID:segmentID];
+    int flags = O_RDWR | O_APPEND | (create ? O_CREAT : 0);
+    int fd = open(path.fileSystemRepresentation, flags, 0644);
+    if (fd < 0) {
+        return nil;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return nil;
+    }
+    SDLogDiskCacheSegment *segment = [SDLogDiskCacheSegment new];
+    segment->_segmentID = segmentID;
+    segment->_fd = fd;
+    segment->_length = (uint64_t)st.st_size;
+    return segment;
+}
+
+// Make sure to call with the lock held
+- (nullable SDLogDiskCacheSegment *)writableSegmentForRecordSize:(uint64_t)recordSize {
+    SDLogDiskCacheSegment *segment = self.activeSegment;
+    if (!segment || (segment->_length > 0 && segment->_length + recordSize > kSDLogDiskCacheSegmentSize)) {
+        if (![self.fileManager fileExistsAtPath:self.diskCachePath]) {
+            [self createDirectoryIfNeeded];
+        }
+        SDLogDiskCacheSegment *sealedSegment = segment;
+        segment = [self openSegmentWithID:self.nextSegmentID create:YES];
+        if (!segment) {
+            return nil;
+        }
+        if (sealedSegment) {
+            // The sealed segment is never written again, sync it once. The checkpoints referencing it are written after this in the same queue
+            // 已封闭的分段不会再被写入，同步一次即可。引用它的检查点会在同一队列中于此之后写入
+            dispatch_async(self.checkpointQueue, ^{
+                fsync(sealedSegment->_fd);
+            });
+        }
+        self.nextSegmentID++;
+        self.segments[@(segment->_segmentID)] = segment;
+        self.activeSegment = segment;
+    }
+    return segment;
+}
+
+// Make sure to call with the lock held. Return the entry for the appended record, or nil if failed
+- (nullable SDLogDiskCacheEntry *)appendRecordWithType:(SDLogDiskCacheRecordType)type key:(NSString *)key data:(nullable NSData *)data modificationTime:(NSTimeInterval)modificationTime {
+    NSData *keyData = [key dataUsingEncoding:NSUTF8StringEncoding];
+    if (!keyData || keyData.length > UINT32_MAX || data.length > UINT32_MAX) {
+        return nil;
+    }
+    SDLogDiskCacheRecordHeader header = {
+        .magic = kSDLogDiskCacheRecordMagic,
+        .type = type,
+        .keyLength = (uint32_t)keyData.length,
+        .dataLength = (uint32_t)data.length,
+        .modificationTime = modificationTime
+    };
+    uint64_t recordSize = SDLogDiskCacheRecordSize(header.keyLength, header.dataLength);
+    SDLogDiskCacheSegment *segment = [self writableSegmentForRecordSize:recordSize];
+    if (!segment) {
+        return nil;
+    }
+
+    uint64_t offset = segment->_length;
+    struct iovec iov[3] = {
+        {.iov_base = &header, .iov_len = sizeof(header)},
+        {.iov_base = (void *)keyData.bytes, .iov_len = keyData.length},
+        {.iov_base = (void *)data.bytes, .iov_len = data.length}
+    };
+    ssize_t written = writev(segment->_fd, iov, data.length > 0 ? 3 : 2);
+    if (written != (ssize_t)recordSize) {
+        // Drop the partial record, keep the log parseable
+        // 丢弃不完整的记录，保持日志可以解析
+        ftruncate(segment->_fd, (off_t)offset);
+        return nil;
+    }
+    segment->_length += recordSize;
+
+    SDLogDiskCacheEntry *entry = [SDLogDiskCacheEntry new];
+    entry->_segmentID = segment->_segmentID;
+    entry->_offset = offset;
+    entry->_keyLength = header.keyLength;
+    entry->_dataLength = header.dataLength;
+    entry->_modificationTime = modificationTime;
+    entry->_accessTime = modificationTime;
+    return entry;
+}
+
+- (nullable NSData *)readDataFromSegment:(SDLogDiskCacheSegment *)segment offset:(uint64_t)offset length:(size_t)length {
+    if (length == 0) {
+        return [NSData data];
+    }
+    void *bytes = malloc(length);
+    if (!bytes) {
+        return nil;
+    }
+    ssize_t readLength = pread(segment->_fd, bytes, length, (off_t)offset);
+    if (readLength != (ssize_t)length) {
+        free(bytes);
+        return nil;
+    }
+    return [NSData dataWithBytesNoCopy:bytes length:length freeWhenDone:YES];
+}
+
+// Make sure to call with the lock held
+- (void)replaySegment:(SDLogDiskCacheSegment *)segment fromOffset:(uint64_t)offset {
+    while (offset + sizeof(SDLogDiskCacheRecordHeader) <= segment->_length) {
+        SDLogDiskCacheRecordHeader header;
+        if (pread(segment->_fd, &header, sizeof(header), (off_t)offset) != sizeof(header)) {
+            break;
+        }
+        if (header.magic != kSDLogDiskCacheRecordMagic || (header.type != SDLogDiskCacheRecordTypeSet && header.type != SDLogDiskCacheRecordTypeRemove)) {
+            break;
+        }
+        uint64_t recordSize = SDLogDiskCacheRecordSize(header.keyLength, header.dataLength);
+        if (offset + recordSize > segment->_length) {
+            break;
+        }
+        NSMutableData *keyData = [NSMutableData dataWithLength:header.keyLength];
+        if (pread(segment->_fd, keyData.mutableBytes, header.keyLength, (off_t)(offset + sizeof(header))) != (ssize_t)header.keyLength) {
+            break;
+        }
+        NSString *key = [[NSString alloc] initWithData:keyData encoding:NSUTF8StringEncoding];
+        if (!key) {
+            break;
+        }
+        if (header.type == SDLogDiskCacheRecordTypeSet) {
+            SDLogDiskCacheEntry *entry = [SDLogDiskCacheEntry new];
+            entry->_segmentID = segment->_segmentID;
+            entry->_offset = offset;
+            entry->_keyLength = header.keyLength;
+            entry->_dataLength = header.dataLength;
+            entry->_modificationTime = header.modificationTime;
+            entry->_accessTime = header.modificationTime;
+            [self setEntry:entry forKey:key];
+        } else {
+            [self removeEntryForKey:key];
+            self.tombstones[key] = @(segment->_segmentID);
+        }
+        offset += recordSize;
+    }
+    if (offset < segment->_length) {
+        // Torn or corrupted tail from a crash, drop it
+        // 崩溃导致的不完整或损坏的尾部，丢弃它
+        ftruncate(segment->_fd, (off_t)offset);
+        segment->_length = offset;
+    }
+}
+
+// Copy the live records of the sparse sealed segments to the active segment, then delete them. The records are moved one at a time, each read without the lock and appended with the lock, so the reads and writes go on during compaction. The sealed segments are never written, so no entry is added to them meanwhile
+- (void)compact {
+    SD_LOCK(self.lock);
+    NSMutableArray<SDLogDiskCacheSegment *> *compactedSegments = [NSMutableArray array];
+    for (SDLogDiskCacheSegment *segment in self.segments.allValues) {
+        if (segment == self.activeSegment) {
+            continue;
+        }
+        if (segment->_liveBytes < segment->_length * kSDLogDiskCacheCompactionRatio) {
+            [compactedSegments addObject:segment];
+        }
+    }
+    if (compactedSegments.count == 0) {
+        if (self.pendingMutationCount > 0) {
+            [self checkpointWaitUntilDone:NO];
+        }
+        SD_UNLOCK(self.lock);
+        return;
+    }
+    NSMutableSet<NSNumber *> *compactedSegmentIDs = [NSMutableSet setWithCapacity:compactedSegments.count];
+    for (SDLogDiskCacheSegment *segment in compactedSegments) {
+        [compactedSegmentIDs addObject:@(segment->_segmentID)];
+    }
+    NSMutableArray<NSString *> *movedKeys = [NSMutableArray array];
+    [self.entries enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull key, SDLogDiskCacheEntry * _Nonnull entry, BOOL * _Nonnull stop) {
+        if ([compactedSegmentIDs containsObject:@(entry->_segmentID)]) {
+            [movedKeys addObject:key];
+        }
+    }];
+    SD_UNLOCK(self.lock);
+
+    // Copy the live entries of the sparse segments to the active segment
+    // 将稀疏分段中的有效条目复制到当前分段
+    for (NSString *key in movedKeys) {
+        @autoreleasepool {
+            SD_LOCK(self.lock);
+            SDLogDiskCacheEntry *entry = self.entries[key];
+            SDLogDiskCacheSegment *segment = [compactedSegmentIDs containsObject:@(entry->_segmentID)] ? self.segments[@(entry->_segmentID)] : nil;
+            SD_UNLOCK(self.lock);
+            if (!segment) {
+                // Removed or written again meanwhile
+                continue;
+            }
+            NSData *data = [self readDataFromSegment:segment offset:entry->_offset + sizeof(SDLogDiskCacheRecordHeader) + entry->_keyLength length:entry->_dataLength];
+            SD_LOCK(self.lock);
+            if (self.entries[key] == entry) {
+                SDLogDiskCacheEntry *movedEntry = data ? [self appendRecordWithType:SDLogDiskCacheRecordTypeSet key:key data:data modificationTime:entry->_modificationTime] : nil;
+                if (movedEntry) {
+                    movedEntry->_accessTime = entry->_accessTime;
+                    [self setEntry:movedEntry forKey:key];
+                } else {
+                    [self removeEntryForKey:key];
+                }
+            }
+            SD_UNLOCK(self.lock);
+        }
+    }
+
+    SD_LOCK(self.lock);
+    // Keep the tombstones of compacted segments while an older segment survives, it may hold a set record of the key, which would come back if the index is rebuilt from the log
+    // 当存在更旧的分段时保留被压缩分段中的删除记录，更旧的分段可能包含该 key 的写入记录，如果从日志重建索引，该条目会被恢复
+    uint32_t oldestSurvivingSegmentID = UINT32_MAX;
+    for (SDLogDiskCacheSegment *segment in self.segments.allValues) {
+        if (![compactedSegmentIDs containsObject:@(segment->_segmentID)]) {
+            oldestSurvivingSegmentID = MIN(oldestSurvivingSegmentID, segment->_segmentID);
+        }
+    }
+    NSMutableArray<NSString *> *tombstoneKeys = [NSMutableArray array];
+    [self.tombstones enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull key, NSNumber * _Nonnull segmentID, BOOL * _Nonnull stop) {
+        if ([compactedSegmentIDs containsObject:segmentID]) {
+            [tombstoneKeys addObject:key];
+        }
+    }];
+    for (NSString *key in tombstoneKeys) {
+        uint32_t segmentID = self.tombstones[key].unsignedIntValue;
+        SDLogDiskCacheEntry *tombstone;
+        if (oldestSurvivingSegmentID < segmentID) {
+            tombstone = [self appendRecordWithType:SDLogDiskCacheRecordTypeRemove key:key data:nil modificationTime:[NSDate date].timeIntervalSince1970];
+        }
+        if (tombstone) {
+            self.tombstones[key] = @(tombstone->_segmentID);
+        } else {
+            [self.tombstones removeObjectForKey:key];
+        }
+    }
+
+    // The segments may be removed meanwhile by `removeAllData`
+    // 分段可能同时被 `removeAllData` 删除
+    NSMutableArray<NSString *> *compactedPaths = [NSMutableArray arrayWithCapacity:compactedSegments.count];
+    for (SDLogDiskCacheSegment *segment in compactedSegments) {
+        if (self.segments[@(segment->_segmentID)] == segment) {
+            [self.segments removeObjectForKey:@(segment->_segmentID)];
+            [compactedPaths addObject:[self pathForSegmentID:segment->_segmentID]];
+        }
+    }
+    [self checkpointWaitUntilDone:NO];
+    SD_UNLOCK(self.lock);
+
+    // Delete after the checkpoint in the same serial queue, so the index never point to a deleted segment
+    // 在同一串行队列中于检查点之后删除，这样索引永远不会引用已删除的分段
+    NSFileManager *fileManager = self.fileManager;
+    dispatch_async(self.checkpointQueue, ^{
+        for (NSString *path in compactedPaths) {
+            [fileManager removeItemAtPath:path error:nil];
+        }
+    });
+}
+
+@end
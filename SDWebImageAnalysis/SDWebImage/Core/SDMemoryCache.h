@@ -7,6 +7,7 @@
  */
 
 #import "SDWebImageCompat.h"
+#import "SDMemoryPressureManager.h"
 
 @class SDImageCacheConfig;
 // A protocol to allow custom memory cache used in SDImageCache.
@@ -56,11 +57,23 @@
  */
 - (void)removeAllObjects;
 
+@optional
+/**
+ Updates the cost of the specified key, only if the cache still holds the same object. This is called when the memory cost of an animated image changes after it's stored, such as frames preloaded or buffered by views, so the cost limit is enforced against the real memory.
+ 
+ @param cost   The new cost.
+ @param object The object whose cost changed.
+ @param key    The key which the object was stored with.
+ */
+- (void)updateCost:(NSUInteger)cost forObject:(nonnull id)object key:(nonnull id)key;
+
 @end
 
-// A memory cache which auto purge the cache on memory warning and support weak cache.
-// 一种内存缓存，在内存出现警告时自动清除缓存并支持 weak 缓存。
-@interface SDMemoryCache <KeyType, ObjectType> : NSCache <KeyType, ObjectType> <SDMemoryCache>
+// A memory cache which auto trim the cache on memory pressure (See `SDMemoryPressureManager`) and support weak cache.
+// `NSCache` does not expose the eviction order, so when the weak cache is enabled, the largest objects found in weak cache are evicted first to trim to a fraction, otherwise the cache is purged.
+// 一种内存缓存，在内存压力下自动裁剪缓存（参见 `SDMemoryPressureManager`）并支持 weak 缓存。
+// `NSCache` 不暴露淘汰顺序，因此启用 weak 缓存时，裁剪到一定比例会优先淘汰在 weak 缓存中找到的最大的对象，否则清除整个缓存。
+@interface SDMemoryCache <KeyType, ObjectType> : NSCache <KeyType, ObjectType> <SDMemoryCache, SDMemoryPressureSubscriber>
 
 @property (nonatomic, strong, nonnull, readonly) SDImageCacheConfig *config;
 
@@ -10,6 +10,8 @@
 #import "SDImageCacheConfig.h"
 #import "UIImage+MemoryCacheCost.h"
 #import "SDInternalMacros.h"
+#import "SDAnimatedImage.h"
+#import "UIImage+MemoryCacheCostTracking.h"
 
 static void * SDMemoryCacheContext = &SDMemoryCacheContext;
 
@@ -27,9 +29,6 @@ static void * SDMemoryCacheContext = &SDMemoryCacheContext;
 - (void)dealloc {
     [_config removeObserver:self forKeyPath:NSStringFromSelector(@selector(maxMemoryCost)) context:SDMemoryCacheContext];
     [_config removeObserver:self forKeyPath:NSStringFromSelector(@selector(maxMemoryCount)) context:SDMemoryCacheContext];
-#if SD_UIKIT
-    [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
-#endif
 }
 
 - (instancetype)init {
@@ -61,18 +60,47 @@ static void * SDMemoryCacheContext = &SDMemoryCacheContext;
 #if SD_UIKIT
     self.weakCache = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsStrongMemory valueOptions:NSPointerFunctionsWeakMemory capacity:0];
     self.weakCacheLock = dispatch_semaphore_create(1);
-    
-    // 接收内存警告通知
-    [[NSNotificationCenter defaultCenter] addObserver:self
-                                             selector:@selector(didReceiveMemoryWarning:)
-                                                 name:UIApplicationDidReceiveMemoryWarningNotification
-                                               object:nil];
 #endif
+    
+    // 订阅内存压力
+    [[SDMemoryPressureManager sharedManager] addSubscriber:self];
 }
 
-// Current this seems no use on macOS (macOS use virtual memory and do not clear cache when memory warning). So we only override on iOS/tvOS platform.
+#pragma mark - SDMemoryPressureSubscriber
+
+- (void)trimToFraction:(double)fraction {
 #if SD_UIKIT
-- (void)didReceiveMemoryWarning:(NSNotification *)notification {
+    if (fraction > 0 && self.config.shouldUseWeakMemoryCache) {
+        // Only remove cache, but keep weak cache. Find the cached objects from weak cache, and evict the largest first
+        // 只删除缓存，但保留 weak 缓存。从 weak 缓存中找到已缓存的对象，优先淘汰最大的
+        SD_LOCK(self.weakCacheLock);
+        NSDictionary *weakObjects = self.weakCache.dictionaryRepresentation;
+        SD_UNLOCK(self.weakCacheLock);
+        NSMutableDictionary<id, NSNumber *> *costs = [NSMutableDictionary dictionaryWithCapacity:weakObjects.count];
+        NSUInteger totalCost = 0;
+        for (id key in weakObjects) {
+            id obj = [super objectForKey:key];
+            if (!obj) {
+                continue;
+            }
+            NSUInteger cost = [obj isKindOfClass:[UIImage class]] ? [(UIImage *)obj sd_memoryCost] : 0;
+            costs[key] = @(cost);
+            totalCost += cost;
+        }
+        NSArray *keys = [costs keysSortedByValueUsingComparator:^NSComparisonResult(NSNumber * _Nonnull cost1, NSNumber * _Nonnull cost2) {
+            return [cost2 compare:cost1];
+        }];
+        NSUInteger targetCost = (NSUInteger)(totalCost * fraction);
+        for (id key in keys) {
+            if (totalCost <= targetCost) {
+                break;
+            }
+            [super removeObjectForKey:key];
+            totalCost -= costs[key].unsignedIntegerValue;
+        }
+        return;
+    }
+#endif
     // Only remove cache, but keep weak cache
     // 只删除缓存，但保留 weak 缓存
     [super removeAllObjects];
@@ -81,6 +109,12 @@ static void * SDMemoryCacheContext = &SDMemoryCacheContext;
 // `setObject:forKey:` just call this with 0 cost. Override this is enough
 - (void)setObject:(id)obj forKey:(id)key cost:(NSUInteger)g {
     [super setObject:obj forKey:key cost:g];
+    if (key && [obj isKindOfClass:[UIImage class]] && [[obj class] conformsToProtocol:@protocol(SDAnimatedImage)]) {
+        // The animated image cost changes when frames are loaded, track it
+        // 动图的开销会在帧加载时变化，需要跟踪
+        [(UIImage *)obj sd_trackMemoryCostInCache:self key:key];
+    }
+#if SD_UIKIT
     if (!self.config.shouldUseWeakMemoryCache) {
         return;
     }
@@ -90,8 +124,22 @@ static void * SDMemoryCacheContext = &SDMemoryCacheContext;
         [self.weakCache setObject:obj forKey:key];
         SD_UNLOCK(self.weakCacheLock);
     }
+#endif
+}
+
+- (void)updateCost:(NSUInteger)cost forObject:(id)object key:(id)key {
+    if (!object || !key) {
+        return;
+    }
+    // Only update when it's not evicted or replaced
+    // 仅在未被淘汰或替换时更新
+    if ([super objectForKey:key] == object) {
+        [super setObject:object forKey:key cost:cost];
+    }
 }
 
+#if SD_UIKIT
+
 - (id)objectForKey:(id)key {
     id obj = [super objectForKey:key];
     if (!self.config.shouldUseWeakMemoryCache) {
@@ -0,0 +1,97 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "SDWebImageCompat.h"
+
+/// Memory Pressure Level
+/// 内存压力等级
+typedef NS_ENUM(NSUInteger, SDMemoryPressureLevel) {
+
+    // No pressure, nothing is trimmed
+    // 没有压力，不进行裁剪
+    SDMemoryPressureLevelNormal,
+    // The memory warning of UIKit, or the warning level of system memory pressure. Trim to `warningTrimFraction`
+    // UIKit 的内存警告，或系统内存压力的警告等级。裁剪到 `warningTrimFraction`
+    SDMemoryPressureLevelWarning,
+    // The critical level of system memory pressure. Trim to `criticalTrimFraction`
+    // 系统内存压力的严重等级。裁剪到 `criticalTrimFraction`
+    SDMemoryPressureLevelCritical
+};
+
+// The object which hold memory that can be released under memory pressure, such as the memory cache, the frame buffer of animated image view, and the frame cache of coders.
+// 在内存压力下可以释放内存的对象，例如内存缓存、动图视图的帧缓冲和解码器的帧缓存。
+@protocol SDMemoryPressureSubscriber <NSObject>
+
+// Release the memory until the cost is at or below `fraction` (0 to 1) of current cost. The coldest and largest entries should be released first. A fraction of 0 means release all that can be released.
+// This may be called from any thread.
+// 释放内存，直到开销小于或等于当前开销的 `fraction`（0 到 1）。应该优先释放最冷和开销最大的条目。fraction 为 0 表示释放所有可以释放的内存。
+// 可能在任意线程调用。
+- (void)trimToFraction:(double)fraction;
+
+@optional
+// The current cost in bytes, used for the process-wide budget. The subscriber which does not implement this is only trimmed by the pressure levels.
+// 当前以字节为单位的开销，用于进程范围的预算。未实现此方法的订阅者只会按压力等级裁剪。
+- (NSUInteger)memoryPressureCost;
+
+@end
+
+// The manager to dispatch the graded memory pressure to all the subscribers, instead of wiping all the memory on each memory warning, which cause a decode storm right after and trigger the next warning.
+// It observes the memory warning of UIKit and the memory pressure of system, and can be driven manually by `applyPressureLevel:` or `trimToFraction:` as well, such as from a test harness.
+// 将分级的内存压力分发给所有订阅者的管理器，而不是在每次内存警告时清空所有内存，这会在之后立即导致大量解码并触发下一次警告。
+// 它会观察 UIKit 的内存警告和系统的内存压力，也可以通过 `applyPressureLevel:` 或 `trimToFraction:` 手动驱动，例如在测试工具中。
+@interface SDMemoryPressureManager : NSObject
+
+// Returns the global shared manager instance.
+// 返回全局共享的管理器实例。
+@property (nonatomic, class, readonly, nonnull) SDMemoryPressureManager *sharedManager;
+
+// The fraction of memory to keep on the warning level.
+// Defaults to 0.5.
+// 在警告等级时保留的内存比例。
+// 默认为 0.5。
+@property (atomic, assign) double warningTrimFraction;
+
+// The fraction of memory to keep on the critical level.
+// Defaults to 0. Which means release all that can be released.
+// 在严重等级时保留的内存比例。
+// 默认为 0。这意味着释放所有可以释放的内存。
+@property (atomic, assign) double criticalTrimFraction;
+
+// The process-wide budget in bytes for the total `memoryPressureCost` of all the subscribers. When exceeded, all the subscribers are trimmed to the same fraction to fit the budget.
+// Defaults to 0. Which means there is no budget.
+// 所有订阅者的 `memoryPressureCost` 总和的进程范围预算（以字节为单位）。超出时，所有订阅者会被裁剪到相同的比例以符合预算。
+// 默认为 0。这意味着没有预算。
+@property (atomic, assign) NSUInteger memoryBudget;
+
+// The total `memoryPressureCost` of all the subscribers.
+// 所有订阅者的 `memoryPressureCost` 总和。
+@property (nonatomic, assign, readonly) NSUInteger totalCost;
+
+// The subscribers are held weakly, no need to remove them before dealloc.
+// 订阅者是弱引用的，dealloc 之前无需移除。
+- (void)addSubscriber:(nonnull id<SDMemoryPressureSubscriber>)subscriber;
+- (void)removeSubscriber:(nonnull id<SDMemoryPressureSubscriber>)subscriber;
+
+// Trim all the subscribers with the fraction of the level.
+// 使用该等级对应的比例裁剪所有订阅者。
+- (void)applyPressureLevel:(SDMemoryPressureLevel)level;
+
+// Trim all the subscribers to the fraction.
+// 将所有订阅者裁剪到该比例。
+- (void)trimToFraction:(double)fraction;
+
+// Trim the subscribers if the `totalCost` exceeds the `memoryBudget`.
+// 如果 `totalCost` 超出 `memoryBudget`，则裁剪订阅者。
+- (void)enforceMemoryBudget;
+
+// Schedule a `enforceMemoryBudget` on a background queue, the calls before it runs are coalesced. This is called by the subscribers after they grow, and do nothing when there is no budget.
+// 在后台队列中调度一次 `enforceMemoryBudget`，在其执行之前的调用会被合并。订阅者在增长后调用此方法，没有预算时不做任何事情。
+- (void)setNeedsEnforceMemoryBudget;
+
+@end
@@ -0,0 +1,184 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDMemoryPressureManager.h"
+#import "SDInternalMacros.h"
+
+@interface SDMemoryPressureManager ()
+
+@property (nonatomic, strong, nonnull) dispatch_semaphore_t subscribersLock;
+@property (nonatomic, strong, nonnull) NSHashTable<id<SDMemoryPressureSubscriber>> *subscribers;
+@property (nonatomic, strong, nullable) dispatch_source_t pressureSource;
+@property (nonatomic, assign) BOOL budgetCheckScheduled;
+
+@end
+
+@implementation SDMemoryPressureManager
+
++ (SDMemoryPressureManager *)sharedManager {
+    static dispatch_once_t onceToken;
+    static SDMemoryPressureManager *manager;
+    dispatch_once(&onceToken, ^{
+        manager = [[SDMemoryPressureManager alloc] init];
+    });
+    return manager;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _warningTrimFraction = 0.5;
+        _criticalTrimFraction = 0;
+        _subscribersLock = dispatch_semaphore_create(1);
+        _subscribers = [NSHashTable weakObjectsHashTable];
+
+        // The warning level of UIKit is the memory warning, only observe the critical level of system
+        // UIKit 的警告等级是内存警告，只观察系统的严重等级
+#if SD_UIKIT
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(didReceiveMemoryWarning:) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+        dispatch_source_memorypressure_flags_t mask = DISPATCH_MEMORYPRESSURE_CRITICAL;
+#else
+        dispatch_source_memorypressure_flags_t mask = DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL;
+#endif
+        _pressureSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0, mask, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+        __weak typeof(self) wself = self;
+        dispatch_source_set_event_handler(_pressureSource, ^{
+            __strong typeof(wself) sself = wself;
+            if (!sself) {
+                return;
+            }
+            unsigned long flags = dispatch_source_get_data(sself.pressureSource);
+            if (flags & DISPATCH_MEMORYPRESSURE_CRITICAL) {
+                [sself applyPressureLevel:SDMemoryPressureLevelCritical];
+            } else if (flags & DISPATCH_MEMORYPRESSURE_WARN) {
+                [sself applyPressureLevel:SDMemoryPressureLevelWarning];
+            }
+        });
+        dispatch_resume(_pressureSource);
+    }
+    return self;
+}
+
+- (void)dealloc {
+#if SD_UIKIT
+    [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+#endif
+    if (_pressureSource) {
+        dispatch_source_cancel(_pressureSource);
+    }
+}
+
+#if SD_UIKIT
+- (void)didReceiveMemoryWarning:(NSNotification *)notification {
+    [self applyPressureLevel:SDMemoryPressureLevelWarning];
+}
+#endif
+
+#pragma mark - Subscribers
+
+- (void)addSubscriber:(id<SDMemoryPressureSubscriber>)subscriber {
+    NSParameterAssert(subscriber);
+    SD_LOCK(self.subscribersLock);
+    [self.subscribers addObject:subscriber];
+    SD_UNLOCK(self.subscribersLock);
+}
+
+- (void)removeSubscriber:(id<SDMemoryPressureSubscriber>)subscriber {
+    NSParameterAssert(subscriber);
+    SD_LOCK(self.subscribersLock);
+    [self.subscribers removeObject:subscriber];
+    SD_UNLOCK(self.subscribersLock);
+}
+
+- (NSArray<id<SDMemoryPressureSubscriber>> *)allSubscribers {
+    SD_LOCK(self.subscribersLock);
+    NSArray<id<SDMemoryPressureSubscriber>> *subscribers = self.subscribers.allObjects;
+    SD_UNLOCK(self.subscribersLock);
+    return subscribers;
+}
+
+#pragma mark - Trim
+
+- (void)applyPressureLevel:(SDMemoryPressureLevel)level {
+    switch (level) {
+        case SDMemoryPressureLevelWarning:
+            [self trimToFraction:self.warningTrimFraction];
+            break;
+        case SDMemoryPressureLevelCritical:
+            [self trimToFraction:self.criticalTrimFraction];
+            break;
+        default:
+            break;
+    }
+}
+
+- (void)trimToFraction:(double)fraction {
+    fraction = MIN(MAX(fraction, 0), 1);
+    if (fraction >= 1) {
+        return;
+    }
+    for (id<SDMemoryPressureSubscriber> subscriber in [self allSubscribers]) {
+        [subscriber trimToFraction:fraction];
+    }
+}
+
+- (NSUInteger)totalCost {
+    NSUInteger totalCost = 0;
+    for (id<SDMemoryPressureSubscriber> subscriber in [self allSubscribers]) {
+        if ([subscriber respondsToSelector:@selector(memoryPressureCost)]) {
+            totalCost += [subscriber memoryPressureCost];
+        }
+    }
+    return totalCost;
+}
+
+- (void)enforceMemoryBudget {
+    NSUInteger budget = self.memoryBudget;
+    if (budget == 0) {
+        return;
+    }
+    NSArray<id<SDMemoryPressureSubscriber>> *subscribers = [self allSubscribers];
+    NSMutableArray<id<SDMemoryPressureSubscriber>> *costSubscribers = [NSMutableArray arrayWithCapacity:subscribers.count];
+    NSUInteger totalCost = 0;
+    for (id<SDMemoryPressureSubscriber> subscriber in subscribers) {
+        if ([subscriber respondsToSelector:@selector(memoryPressureCost)]) {
+            totalCost += [subscriber memoryPressureCost];
+            [costSubscribers addObject:subscriber];
+        }
+    }
+    if (totalCost <= budget) {
+        return;
+    }
+    // Trim each subscriber to the same fraction, the ones without cost are not counted so not trimmed
+    // 将每个订阅者裁剪到相同的比例，没有开销的订阅者不计入预算，因此不裁剪
+    double fraction = (double)budget / totalCost;
+    for (id<SDMemoryPressureSubscriber> subscriber in costSubscribers) {
+        [subscriber trimToFraction:fraction];
+    }
+}
+
+- (void)setNeedsEnforceMemoryBudget {
+    if (self.memoryBudget == 0) {
+        return;
+    }
+    SD_LOCK(self.subscribersLock);
+    BOOL shouldSchedule = !self.budgetCheckScheduled;
+    self.budgetCheckScheduled = YES;
+    SD_UNLOCK(self.subscribersLock);
+    if (!shouldSchedule) {
+        return;
+    }
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        SD_LOCK(self.subscribersLock);
+        self.budgetCheckScheduled = NO;
+        SD_UNLOCK(self.subscribersLock);
+        [self enforceMemoryBudget];
+    });
+}
+
+@end
@@ -172,6 +172,12 @@ typedef NS_OPTIONS(NSUInteger, SDWebImageOptions) {
     // 使用此选项，可以确保我们始终使用您提供的 class 回调图像。如果生成失败，将使用「SDWebImageErrorBadImageData」报错。
     // 注意，此选项与「SDWebImageDecodeFirstFrameOnly」不兼容，后者始终生成 UIImage / NSImage。
     SDWebImageMatchAnimatedImageClass = 1 << 21,
+    
+    // By default, when you use image transformer and the transformed image is not in cache, we query the original image from cache and transform it locally, instead of downloading it again. So the different transformed images (such as different thumbnail sizes) of one URL only need one download. The original image is in cache when it's loaded without transformer, or stored with `SDWebImageContextOriginalStoreCacheType`.
+    // Using this option, the original image is not queried, and the image is always downloaded when the transformed image is not in cache.
+    // 默认情况下，当你使用图像转换器并且转换后的图像不在缓存中时，我们会从缓存中查询原始图像并在本地转换，而不是再次下载。因此一个 URL 的不同转换图像（例如不同的缩略图尺寸）只需要下载一次。当原始图像在没有转换器的情况下加载，或使用「SDWebImageContextOriginalStoreCacheType」存储时，它会在缓存中。
+    // 使用此选项，不会查询原始图像，当转换后的图像不在缓存中时总是下载图像。
+    SDWebImageAvoidOriginalCacheQuery = 1 << 22,
 };
 
 
@@ -211,6 +217,10 @@ FOUNDATION_EXPORT SDWebImageContextOption _Nonnull const SDWebImageContextStoreC
 // 如果未提供或值无效，我们将使用 SDImageCacheTypeNone，它不会将原始图像存储到缓存中。
 FOUNDATION_EXPORT SDWebImageContextOption _Nonnull const SDWebImageContextOriginalStoreCacheType;
 
+// A BOOL value which specify that the image found in disk cache by the query is not stored into memory cache. The manager uses this to query the original image for image transformer, unless `SDWebImageContextOriginalStoreCacheType` stores the original image into memory cache. If not provide, we will use NO. (NSNumber)
+// BOOL 类型，指定查询在磁盘缓存中找到的图像不存储到内存缓存中。管理器在为图像转换器查询原始图像时使用它，除非「SDWebImageContextOriginalStoreCacheType」将原始图像存储到内存缓存中。如果未提供，我们将使用 NO。
+FOUNDATION_EXPORT SDWebImageContextOption _Nonnull const SDWebImageContextQueryAvoidMemoryCache;
+
 // A Class object which the instance is a `UIImage/NSImage` subclass and adopt `SDAnimatedImage` protocol. We will call `initWithData:scale:options:` to create the instance (or `initWithAnimatedCoder:scale:` when using progressive download) . If the instance create failed, fallback to normal `UIImage/NSImage`.
 // This can be used to improve animated images rendering performance (especially memory usage on big animated images) with `SDAnimatedImageView` (Class).
 // 符合 SDAnimatedImage 协议的 UIImage/NSImage 子类实例对象类型。我们将调用 initWithData:scale:options: 来创建实例（或调用 initWithAnimatedCoder:scale: 渐进式下载）。如果实例创建失败，则回退到正常的 UIImage/NSImage。
@@ -12,6 +12,7 @@
 #import "SDWebImageOperation.h"
 #import "SDWebImageDownloaderConfig.h"
 #import "SDWebImageDownloaderRequestModifier.h"
+#import "SDWebImageDownloaderConcurrencyController.h"
 #import "SDImageLoader.h"
 
 /// Downloader options
@@ -108,6 +109,12 @@ typedef SDImageLoaderCompletedBlock SDWebImageDownloaderCompletedBlock;
 // The download's response.
 @property (nonatomic, strong, nullable, readonly) NSURLResponse *response;
 
+// The download's priority, from 0.0 to 1.0. It can be changed at any time, such as lowering it when the image view scrolls offscreen. A download shared by several tokens runs at the highest priority of its tokens not cancelled, which decides the order to start the waiting downloads, and the priority of the running URLSession task.
+// Defaults to `NSURLSessionTaskPriorityHigh` for `SDWebImageDownloaderHighPriority`, `NSURLSessionTaskPriorityLow` for `SDWebImageDownloaderLowPriority`, otherwise `NSURLSessionTaskPriorityDefault`.
+// 下载的优先级，从 0.0 到 1.0。可以随时更改，例如在图像视图滚动到屏幕外时降低优先级。由多个 token 共享的下载以其未取消的 token 中的最高优先级运行，这决定了等待中的下载的启动顺序，以及正在运行的 URLSession 任务的优先级。
+// 对于 `SDWebImageDownloaderHighPriority` 默认为 `NSURLSessionTaskPriorityHigh`，对于 `SDWebImageDownloaderLowPriority` 默认为 `NSURLSessionTaskPriorityLow`，否则为 `NSURLSessionTaskPriorityDefault`。
+@property (nonatomic, assign) float priority;
+
 @end
 
 
@@ -141,6 +148,12 @@ typedef SDImageLoaderCompletedBlock SDWebImageDownloaderCompletedBlock;
 // Gets/Sets 下载队列挂起状态。
 @property (nonatomic, assign, getter=isSuspended) BOOL suspended;
 
+// The controller which adjusts the concurrent downloads, and provides the metrics of it, such as the current limit, throughput, time to first byte and error rate.
+// Nil unless `shouldAdaptConcurrentDownloads` of config is YES.
+// 调整并发下载数的控制器，并提供其指标，例如当前限制、吞吐量、首字节时间和错误率。
+// 除非配置的 `shouldAdaptConcurrentDownloads` 为 YES，否则为 nil。
+@property (nonatomic, strong, readonly, nullable) SDWebImageDownloaderConcurrencyController *concurrencyController;
+
 // Shows the current amount of downloads that still need to be downloaded
 // 显示当前需要下载的下载数量
 @property (nonatomic, assign, readonly) NSUInteger currentDownloadCount;
@@ -11,6 +11,7 @@
 #import "SDWebImageDownloaderOperation.h"
 #import "SDWebImageError.h"
 #import "SDInternalMacros.h"
+#import "SDWebImageDownloaderScheduler.h"
 
 NSNotificationName const SDWebImageDownloadStartNotification = @"SDWebImageDownloadStartNotification";
 NSNotificationName const SDWebImageDownloadReceiveResponseNotification = @"SDWebImageDownloadReceiveResponseNotification";
@@ -19,6 +20,15 @@ NSNotificationName const SDWebImageDownloadFinishNotification = @"SDWebImageDown
 
 static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
 
+static inline float SDWebImageDownloaderPriorityForOptions(SDWebImageDownloaderOptions options) {
+    if (options & SDWebImageDownloaderHighPriority) {
+        return NSURLSessionTaskPriorityHigh;
+    } else if (options & SDWebImageDownloaderLowPriority) {
+        return NSURLSessionTaskPriorityLow;
+    }
+    return NSURLSessionTaskPriorityDefault;
+}
+
 @interface SDWebImageDownloadToken ()
 
 @property (nonatomic, strong, nullable, readwrite) NSURL *url;
@@ -38,7 +48,10 @@ static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
 @interface SDWebImageDownloader () <NSURLSessionTaskDelegate, NSURLSessionDataDelegate>
 
 @property (strong, nonatomic, nonnull) NSOperationQueue *downloadQueue;
-@property (weak, nonatomic, nullable) NSOperation *lastAddedOperation;
+@property (strong, nonatomic, nonnull) SDWebImageDownloaderScheduler *scheduler; // the operations waiting for a slot, added to `downloadQueue` by priority
+@property (assign, nonatomic) NSUInteger admittedCount; // the operations added to `downloadQueue` and not finished
+@property (strong, nonatomic, nonnull) NSMapTable<NSOperation *, NSHashTable<SDWebImageDownloadToken *> *> *operationTokens; // the tokens of each operation, to get its priority
+@property (strong, nonatomic, readwrite, nullable) SDWebImageDownloaderConcurrencyController *concurrencyController; // nil if `shouldAdaptConcurrentDownloads` is NO, adapts the limit of admitted operations
 @property (strong, nonatomic, nonnull) NSMutableDictionary<NSURL *, NSOperation<SDWebImageDownloaderOperation> *> *URLOperations;
 @property (strong, nonatomic, nullable) NSMutableDictionary<NSString *, NSString *> *HTTPHeaders;
 @property (strong, nonatomic, nonnull) dispatch_semaphore_t HTTPHeadersLock; // A lock to keep the access to `HTTPHeaders` thread-safe
@@ -48,6 +61,8 @@ static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
 // 所有的任务 (tasks) 将在此会话 (session) 中进行
 @property (strong, nonatomic) NSURLSession *session;
 
+- (void)updatePriorityForToken:(nonnull SDWebImageDownloadToken *)token;
+
 @end
 
 @implementation SDWebImageDownloader
@@ -100,8 +115,19 @@ static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
         [_config addObserver:self forKeyPath:NSStringFromSelector(@selector(maxConcurrentDownloads)) options:0 context:SDWebImageDownloaderContext];
         _downloadQueue = [NSOperationQueue new];
         _downloadQueue.maxConcurrentOperationCount = _config.maxConcurrentDownloads;
+        if (_config.shouldAdaptConcurrentDownloads) {
+            // The admission follows the adaptive limit, the queue only needs to allow the upper bound
+            // 准入遵循自适应限制，队列只需要允许上限
+            NSUInteger minLimit = MAX(_config.minAdaptiveConcurrentDownloads, 1);
+            NSUInteger maxLimit = MAX(_config.maxAdaptiveConcurrentDownloads, 1);
+            NSUInteger initialLimit = MAX(_config.maxConcurrentDownloads, 1);
+            _concurrencyController = [[SDWebImageDownloaderConcurrencyController alloc] initWithMinLimit:minLimit maxLimit:maxLimit initialLimit:initialLimit];
+            _downloadQueue.maxConcurrentOperationCount = _concurrencyController.maxConcurrencyLimit;
+        }
         _downloadQueue.name = @"com.hackemist.SDWebImageDownloader";
         _URLOperations = [NSMutableDictionary new];
+        _scheduler = [SDWebImageDownloaderScheduler new];
+        _operationTokens = [NSMapTable weakToStrongObjectsMapTable];
         NSMutableDictionary<NSString *, NSString *> *headerDictionary = [NSMutableDictionary dictionary];
         NSString *userAgent = nil;
 #if SD_UIKIT
@@ -147,6 +173,9 @@ static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
     self.session = nil;
     
     [self.downloadQueue cancelAllOperations];
+    for (NSOperation *operation in [self.scheduler removeAllOperations]) {
+        [operation cancel];
+    }
     [self.config removeObserver:self forKeyPath:NSStringFromSelector(@selector(maxConcurrentDownloads)) context:SDWebImageDownloaderContext];
 }
 
@@ -230,28 +259,26 @@ static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
             }
             SD_LOCK(self.operationsLock);
             [self.URLOperations removeObjectForKey:url];
+            // Free the slot for the next waiting operation
+            // 释放槽位给下一个等待中的操作
+            if (self.admittedCount > 0) {
+                self.admittedCount--;
+            }
+            [self admitOperationsIfNeeded];
             SD_UNLOCK(self.operationsLock);
         };
         self.URLOperations[url] = operation;
-        // Add operation to operation queue only after all configuration done according to Apple's doc.
-        // `addOperation:` does not synchronously execute the `operation.completionBlock` so this will not cause deadlock.
-        [self.downloadQueue addOperation:operation];
         downloadOperationCancelToken = [operation addHandlersForProgress:progressBlock completed:completedBlock];
+        // Add operation to scheduler only after all configuration done, it's added to operation queue when there is a slot
+        // 只有在所有配置完成后才将操作添加到调度器，当有槽位时它会被添加到操作队列
+        [self.scheduler addOperation:operation priority:SDWebImageDownloaderPriorityForOptions(options)];
+        [self admitOperationsIfNeeded];
     } else {
         // When we reuse the download operation to attach more callbacks, there may be thread safe issue because the getter of callbacks may in another queue (decoding queue or delegate queue)
         // So we lock the operation here, and in `SDWebImageDownloaderOperation`, we use `@synchonzied (self)`, to ensure the thread safe between these two classes.
         @synchronized (operation) {
             downloadOperationCancelToken = [operation addHandlersForProgress:progressBlock completed:completedBlock];
         }
-        if (!operation.isExecuting) {
-            if (options & SDWebImageDownloaderHighPriority) {
-                operation.queuePriority = NSOperationQueuePriorityHigh;
-            } else if (options & SDWebImageDownloaderLowPriority) {
-                operation.queuePriority = NSOperationQueuePriorityLow;
-            } else {
-                operation.queuePriority = NSOperationQueuePriorityNormal;
-            }
-        }
     }
     SD_UNLOCK(self.operationsLock);
     
@@ -259,7 +286,11 @@ static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
     token.url = url;
     token.request = operation.request;
     token.downloadOperationCancelToken = downloadOperationCancelToken;
+    token.priority = SDWebImageDownloaderPriorityForOptions(options);
     token.downloader = self;
+    // The operation shared by tokens runs at the highest priority of them
+    // 由多个 token 共享的操作以其中最高的优先级运行
+    [self updatePriorityForToken:token];
     
     return token;
 }
@@ -328,22 +359,87 @@ static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
         operation.minimumProgressInterval = MIN(MAX(self.config.minimumProgressInterval, 0), 1);
     }
     
+    if ([operation respondsToSelector:@selector(setMinimumResumableSize:)]) {
+        operation.minimumResumableSize = self.config.minimumResumableDownloadSize;
+    }
+    
+    if ([operation respondsToSelector:@selector(setDecodesWhileDownloading:)]) {
+        operation.decodesWhileDownloading = self.config.shouldDecodeWhileDownloading;
+    }
+    
     if (options & SDWebImageDownloaderHighPriority) {
         operation.queuePriority = NSOperationQueuePriorityHigh;
     } else if (options & SDWebImageDownloaderLowPriority) {
         operation.queuePriority = NSOperationQueuePriorityLow;
     }
     
-    if (self.config.executionOrder == SDWebImageDownloaderLIFOExecutionOrder) {
-        // Emulate LIFO execution order by systematically adding new operations as last operation's dependency
-        // 如果是 LIFO，则让前面的 operation 依赖于最新添加的 operation
-        [self.lastAddedOperation addDependency:operation];
-        self.lastAddedOperation = operation;
-    }
-    
     return operation;
 }
 
+#pragma mark - Scheduling
+
+// Make sure to call with `operationsLock` held. The execution order (FIFO or LIFO) and priority are applied by scheduler, the operation queue only runs the admitted ones
+// 确保在持有 `operationsLock` 时调用。执行顺序（FIFO 或 LIFO）和优先级由调度器处理，操作队列只运行已准入的操作
+- (void)admitOperationsIfNeeded {
+    NSInteger maxConcurrentDownloads = self.concurrencyController ? (NSInteger)self.concurrencyController.concurrencyLimit : self.config.maxConcurrentDownloads;
+    while (maxConcurrentDownloads < 0 || self.admittedCount < (NSUInteger)maxConcurrentDownloads) {
+        NSOperation *operation = [self.scheduler dequeueOperationWithExecutionOrder:self.config.executionOrder];
+        if (!operation) {
+            break;
+        }
+        self.admittedCount++;
+        // The time spent in suspended queue is not the network's, do not measure it
+        // 在挂起队列中花费的时间不属于网络，不进行测量
+        if (self.concurrencyController && !self.downloadQueue.isSuspended) {
+            [self.concurrencyController requestDidStart:operation];
+        }
+        // `addOperation:` does not synchronously execute the `operation.completionBlock` so this will not cause deadlock.
+        [self.downloadQueue addOperation:operation];
+    }
+}
+
+- (void)updatePriorityForToken:(SDWebImageDownloadToken *)token {
+    NSOperation<SDWebImageDownloaderOperation> *operation = token.downloadOperation;
+    if (!operation) {
+        return;
+    }
+    SD_LOCK(self.operationsLock);
+    NSHashTable<SDWebImageDownloadToken *> *tokens = [self.operationTokens objectForKey:operation];
+    if (!tokens) {
+        tokens = [NSHashTable weakObjectsHashTable];
+        [self.operationTokens setObject:tokens forKey:operation];
+    }
+    [tokens addObject:token];
+    [self updatePriorityForOperation:operation];
+    SD_UNLOCK(self.operationsLock);
+}
+
+// Make sure to call with `operationsLock` held
+- (void)updatePriorityForOperation:(nonnull NSOperation<SDWebImageDownloaderOperation> *)operation {
+    float priority = -1;
+    for (SDWebImageDownloadToken *token in [self.operationTokens objectForKey:operation]) {
+        if (!token.isCancelled) {
+            priority = MAX(priority, token.priority);
+        }
+    }
+    if (priority < 0) {
+        return;
+    }
+    [self.scheduler setPriority:priority forOperation:operation];
+    if (!operation.isExecuting) {
+        if (priority > NSURLSessionTaskPriorityDefault) {
+            operation.queuePriority = NSOperationQueuePriorityHigh;
+        } else if (priority < NSURLSessionTaskPriorityDefault) {
+            operation.queuePriority = NSOperationQueuePriorityLow;
+        } else {
+            operation.queuePriority = NSOperationQueuePriorityNormal;
+        }
+    }
+    if ([operation respondsToSelector:@selector(setPriority:)]) {
+        operation.priority = priority;
+    }
+}
+
 - (void)cancel:(nullable SDWebImageDownloadToken *)token {
     NSURL *url = token.url;
     if (!url) {
@@ -355,12 +451,32 @@ static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
         BOOL canceled = [operation cancel:token.downloadOperationCancelToken];
         if (canceled) {
             [self.URLOperations removeObjectForKey:url];
+            // The waiting operation does not wait for a slot anymore, add it to queue as cancelled, so it finishes and calls the completion now
+            // 等待中的操作不再等待空位，以已取消状态添加到队列，这样它会立即结束并回调完成
+            if ([self.scheduler removeOperation:operation]) {
+                self.admittedCount++;
+                [self.downloadQueue addOperation:operation];
+            }
+        } else {
+            // The cancelled token no longer counts for the priority
+            // 已取消的 token 不再计入优先级
+            [self updatePriorityForOperation:operation];
         }
     }
     SD_UNLOCK(self.operationsLock);
 }
 
 - (void)cancelAllDownloads {
+    // The waiting operations are added to queue as cancelled, so they finish and call the completion
+    // 等待中的操作以已取消状态添加到队列，这样它们会结束并回调完成
+    SD_LOCK(self.operationsLock);
+    NSArray<NSOperation *> *operations = [self.scheduler removeAllOperations];
+    self.admittedCount += operations.count;
+    SD_UNLOCK(self.operationsLock);
+    for (NSOperation *operation in operations) {
+        [operation cancel];
+    }
+    [self.downloadQueue addOperations:operations waitUntilFinished:NO];
     [self.downloadQueue cancelAllOperations];
 }
 
@@ -375,7 +491,10 @@ static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
 }
 
 - (NSUInteger)currentDownloadCount {
-    return self.downloadQueue.operationCount;
+    SD_LOCK(self.operationsLock);
+    NSUInteger count = self.scheduler.count;
+    SD_UNLOCK(self.operationsLock);
+    return self.downloadQueue.operationCount + count;
 }
 
 - (NSURLSessionConfiguration *)sessionConfiguration {
@@ -387,7 +506,12 @@ static void * SDWebImageDownloaderContext = &SDWebImageDownloaderContext;
 - (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary<NSKeyValueChangeKey,id> *)change context:(void *)context {
     if (context == SDWebImageDownloaderContext) {
         if ([keyPath isEqualToString:NSStringFromSelector(@selector(maxConcurrentDownloads))]) {
-            self.downloadQueue.maxConcurrentOperationCount = self.config.maxConcurrentDownloads;
+            if (!self.concurrencyController) {
+                self.downloadQueue.maxConcurrentOperationCount = self.config.maxConcurrentDownloads;
+            }
+            SD_LOCK(self.operationsLock);
+            [self admitOperationsIfNeeded];
+            SD_UNLOCK(self.operationsLock);
         }
     } else {
         [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
@@ -419,6 +543,9 @@ didReceiveResponse:(NSURLResponse *)response
     // Identify the operation that runs this task and pass it the delegate method
     // 确定运行此任务的操作并将 delegate 方法传递给它
     NSOperation<SDWebImageDownloaderOperation> *dataOperation = [self operationWithTask:dataTask];
+    if (dataOperation) {
+        [self.concurrencyController requestDidReceiveResponse:dataOperation];
+    }
     if ([dataOperation respondsToSelector:@selector(URLSession:dataTask:didReceiveResponse:completionHandler:)]) {
         [dataOperation URLSession:session dataTask:dataTask didReceiveResponse:response completionHandler:completionHandler];
     } else {
@@ -432,6 +559,9 @@ didReceiveResponse:(NSURLResponse *)response
 
     // Identify the operation that runs this task and pass it the delegate method
     NSOperation<SDWebImageDownloaderOperation> *dataOperation = [self operationWithTask:dataTask];
+    if (dataOperation) {
+        [self.concurrencyController request:dataOperation didReceiveDataLength:data.length];
+    }
     if ([dataOperation respondsToSelector:@selector(URLSession:dataTask:didReceiveData:)]) {
         [dataOperation URLSession:session dataTask:dataTask didReceiveData:data];
     }
@@ -459,6 +589,11 @@ didReceiveResponse:(NSURLResponse *)response
     
     // Identify the operation that runs this task and pass it the delegate method
     NSOperation<SDWebImageDownloaderOperation> *dataOperation = [self operationWithTask:task];
+    // Update the limit before the operation finishes and frees its slot
+    // 在操作结束并释放槽位之前更新限制
+    if (dataOperation) {
+        [self.concurrencyController request:dataOperation didCompleteWithError:error];
+    }
     if ([dataOperation respondsToSelector:@selector(URLSession:task:didCompleteWithError:)]) {
         [dataOperation URLSession:session task:task didCompleteWithError:error];
     }
@@ -514,6 +649,11 @@ didReceiveResponse:(NSURLResponse *)response
     }
 }
 
+- (void)setPriority:(float)priority {
+    _priority = MIN(MAX(priority, 0), 1);
+    [self.downloader updatePriorityForToken:self];
+}
+
 - (void)cancel {
     @synchronized (self) {
         if (self.isCancelled) {
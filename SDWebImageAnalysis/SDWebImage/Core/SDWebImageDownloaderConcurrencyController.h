@@ -0,0 +1,58 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "SDWebImageCompat.h"
+
+// The controller to adjust the concurrent downloads of `SDWebImageDownloader` by the measured network condition, see `shouldAdaptConcurrentDownloads` of `SDWebImageDownloaderConfig`.
+// The limit grows by one after a round (`concurrencyLimit` requests) completes while the limit is reached, and halves when a request fails by timeout or lost connection, or its time to first byte inflates to several times of the fastest one. Only the requests started after the last decrease can decrease it again, so a burst of failures from the same round is counted once.
+// The downloader reports each request, it can be driven manually as well, such as from a test harness. Thread-safe.
+// 根据测量的网络状况调整 `SDWebImageDownloader` 的并发下载数的控制器，参见 `SDWebImageDownloaderConfig` 的 `shouldAdaptConcurrentDownloads`。
+// 当达到限制时，一轮（`concurrencyLimit` 个）请求完成后限制增加 1；当请求因超时或连接丢失而失败，或者其首字节时间膨胀到最快请求的数倍时，限制减半。只有在上一次减少之后开始的请求才能再次减少限制，因此同一轮的一连串失败只计算一次。
+// 下载器会报告每个请求，也可以手动驱动，例如在测试工具中。线程安全。
+@interface SDWebImageDownloaderConcurrencyController : NSObject
+
+// The current limit of concurrent downloads.
+// 当前并发下载数的限制。
+@property (nonatomic, assign, readonly) NSUInteger concurrencyLimit;
+
+// The bounds of the limit.
+// 限制的上下限。
+@property (nonatomic, assign, readonly) NSUInteger minConcurrencyLimit;
+@property (nonatomic, assign, readonly) NSUInteger maxConcurrencyLimit;
+
+// The bytes per second of one request, from the response to the completion. The metrics are averaged over the recent requests, 0 if no request completed.
+// 单个请求每秒的字节数，从响应到完成。指标为最近请求的平均值，如果没有请求完成则为 0。
+@property (nonatomic, assign, readonly) double throughput;
+
+// The seconds from the start of request to the response.
+// 从请求开始到响应的秒数。
+@property (nonatomic, assign, readonly) NSTimeInterval timeToFirstByte;
+
+// The fraction (0 to 1) of requests failed by network errors, such as timeout.
+// 因网络错误（例如超时）而失败的请求比例（0 到 1）。
+@property (nonatomic, assign, readonly) double errorRate;
+
+// The number of requests running, and the number completed.
+// 正在运行的请求数，以及已完成的请求数。
+@property (nonatomic, assign, readonly) NSUInteger runningCount;
+@property (nonatomic, assign, readonly) NSUInteger completedCount;
+
+// The limit starts from `initialLimit`, which is clamped to the bounds.
+// 限制从 `initialLimit` 开始，它会被限制在上下限之内。
+- (nonnull instancetype)initWithMinLimit:(NSUInteger)minLimit maxLimit:(NSUInteger)maxLimit initialLimit:(NSUInteger)initialLimit NS_DESIGNATED_INITIALIZER;
+- (nonnull instancetype)init NS_UNAVAILABLE;
+
+// Report the events of a request, the request is any object identifies it, such as the download operation. It's held weakly.
+// 报告请求的事件，request 是标识该请求的任意对象，例如下载操作。它会被弱引用。
+- (void)requestDidStart:(nonnull id)request;
+- (void)requestDidReceiveResponse:(nonnull id)request;
+- (void)request:(nonnull id)request didReceiveDataLength:(NSUInteger)length;
+- (void)request:(nonnull id)request didCompleteWithError:(nullable NSError *)error;
+
+@end
@@ -0,0 +1,169 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDWebImageDownloaderConcurrencyController.h"
+#import "SDInternalMacros.h"
+
+static const double kConcurrencyMetricsSmoothingFactor = 0.2; // the weight of the latest request in the averages
+static const double kTimeToFirstByteInflationFactor = 4; // the inflation over the fastest one which means the requests are queued in network
+static const double kTimeToFirstByteBaselineDrift = 0.01; // let the fastest one drift up slowly, so it follows a changed network
+
+@interface SDWebImageDownloaderConcurrencySample : NSObject
+
+@property (nonatomic, assign) CFAbsoluteTime startTime;
+@property (nonatomic, assign) CFAbsoluteTime responseTime; // 0 before response
+@property (nonatomic, assign) NSUInteger receivedLength;
+
+@end
+
+@implementation SDWebImageDownloaderConcurrencySample
+@end
+
+// The exponential moving average, the first value is taken as is
+static inline double SDConcurrencyMetricsAverage(double average, double value, NSUInteger count) {
+    if (count <= 1) {
+        return value;
+    }
+    return average + (value - average) * kConcurrencyMetricsSmoothingFactor;
+}
+
+@interface SDWebImageDownloaderConcurrencyController ()
+
+@property (nonatomic, strong, nonnull) dispatch_semaphore_t lock;
+@property (nonatomic, strong, nonnull) NSMapTable<id, SDWebImageDownloaderConcurrencySample *> *samples;
+@property (nonatomic, assign, readwrite) NSUInteger concurrencyLimit;
+@property (nonatomic, assign, readwrite) double throughput;
+@property (nonatomic, assign, readwrite) NSTimeInterval timeToFirstByte;
+@property (nonatomic, assign, readwrite) double errorRate;
+@property (nonatomic, assign, readwrite) NSUInteger completedCount;
+@property (nonatomic, assign) NSTimeInterval baselineTimeToFirstByte; // the fastest one recently, 0 if unknown
+@property (nonatomic, assign) double increaseCredit; // the fraction of a round completed since last increase
+@property (nonatomic, assign) CFAbsoluteTime lastDecreaseTime;
+
+@end
+
+@implementation SDWebImageDownloaderConcurrencyController
+
+- (instancetype)initWithMinLimit:(NSUInteger)minLimit maxLimit:(NSUInteger)maxLimit initialLimit:(NSUInteger)initialLimit {
+    self = [super init];
+    if (self) {
+        _minConcurrencyLimit = MAX(minLimit, 1);
+        _maxConcurrencyLimit = MAX(maxLimit, _minConcurrencyLimit);
+        _concurrencyLimit = MIN(MAX(initialLimit, _minConcurrencyLimit), _maxConcurrencyLimit);
+        _lock = dispatch_semaphore_create(1);
+        _samples = [NSMapTable weakToStrongObjectsMapTable];
+    }
+    return self;
+}
+
+- (NSUInteger)runningCount {
+    SD_LOCK(self.lock);
+    NSUInteger count = self.samples.count;
+    SD_UNLOCK(self.lock);
+    return count;
+}
+
+#pragma mark - Requests
+
+- (void)requestDidStart:(id)request {
+    NSParameterAssert(request);
+    SDWebImageDownloaderConcurrencySample *sample = [SDWebImageDownloaderConcurrencySample new];
+    sample.startTime = CFAbsoluteTimeGetCurrent();
+    SD_LOCK(self.lock);
+    [self.samples setObject:sample forKey:request];
+    SD_UNLOCK(self.lock);
+}
+
+- (void)requestDidReceiveResponse:(id)request {
+    NSParameterAssert(request);
+    SD_LOCK(self.lock);
+    SDWebImageDownloaderConcurrencySample *sample = [self.samples objectForKey:request];
+    if (sample.responseTime == 0) {
+        sample.responseTime = CFAbsoluteTimeGetCurrent();
+    }
+    SD_UNLOCK(self.lock);
+}
+
+- (void)request:(id)request didReceiveDataLength:(NSUInteger)length {
+    NSParameterAssert(request);
+    SD_LOCK(self.lock);
+    SDWebImageDownloaderConcurrencySample *sample = [self.samples objectForKey:request];
+    sample.receivedLength += length;
+    SD_UNLOCK(self.lock);
+}
+
+- (void)request:(id)request didCompleteWithError:(NSError *)error {
+    NSParameterAssert(request);
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    SD_LOCK(self.lock);
+    SDWebImageDownloaderConcurrencySample *sample = [self.samples objectForKey:request];
+    // Saturated means the limit was reached, only then the success is a proof that the limit can grow
+    BOOL saturated = self.samples.count >= self.concurrencyLimit;
+    [self.samples removeObjectForKey:request];
+    // The cancelled request says nothing about the network
+    if (!sample || [self isCancelledError:error]) {
+        SD_UNLOCK(self.lock);
+        return;
+    }
+    self.completedCount++;
+    BOOL failed = [self isNetworkError:error];
+    self.errorRate = SDConcurrencyMetricsAverage(self.errorRate, failed ? 1 : 0, self.completedCount);
+    BOOL inflated = NO;
+    if (sample.responseTime > 0) {
+        NSTimeInterval timeToFirstByte = sample.responseTime - sample.startTime;
+        self.timeToFirstByte = SDConcurrencyMetricsAverage(self.timeToFirstByte, timeToFirstByte, self.completedCount);
+        NSTimeInterval transferTime = now - sample.responseTime;
+        if (transferTime > 0) {
+            self.throughput = SDConcurrencyMetricsAverage(self.throughput, sample.receivedLength / transferTime, self.completedCount);
+        }
+        NSTimeInterval baseline = self.baselineTimeToFirstByte;
+        if (baseline == 0 || timeToFirstByte < baseline) {
+            self.baselineTimeToFirstByte = timeToFirstByte;
+        } else {
+            inflated = timeToFirstByte > baseline * kTimeToFirstByteInflationFactor;
+            self.baselineTimeToFirstByte = baseline + (timeToFirstByte - baseline) * kTimeToFirstByteBaselineDrift;
+        }
+    }
+
+    if (failed || inflated) {
+        // Multiplicative decrease, once for the requests of the same round
+        // 乘性减少，同一轮的请求只减少一次
+        if (sample.startTime > self.lastDecreaseTime) {
+            self.concurrencyLimit = MAX(self.concurrencyLimit / 2, self.minConcurrencyLimit);
+            self.increaseCredit = 0;
+            self.lastDecreaseTime = now;
+        }
+    } else if (saturated && self.concurrencyLimit < self.maxConcurrencyLimit) {
+        // Additive increase, by one for each round
+        // 加性增加，每一轮增加 1
+        self.increaseCredit += 1.0 / self.concurrencyLimit;
+        if (self.increaseCredit >= 1) {
+            self.concurrencyLimit++;
+            self.increaseCredit = 0;
+        }
+    }
+    SD_UNLOCK(self.lock);
+}
+
+#pragma mark - Helper
+
+- (BOOL)isCancelledError:(NSError *)error {
+    return [error.domain isEqualToString:NSURLErrorDomain] && error.code == NSURLErrorCancelled;
+}
+
+// The errors caused by a congested or poor network, the errors of server or content are not counted
+- (BOOL)isNetworkError:(NSError *)error {
+    if (![error.domain isEqualToString:NSURLErrorDomain]) {
+        return NO;
+    }
+    return error.code == NSURLErrorTimedOut
+        || error.code == NSURLErrorNetworkConnectionLost
+        || error.code == NSURLErrorCannotConnectToHost;
+}
+
+@end
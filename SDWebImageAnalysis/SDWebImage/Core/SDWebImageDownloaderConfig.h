@@ -40,6 +40,30 @@ typedef NS_ENUM(NSInteger, SDWebImageDownloaderExecutionOrder) {
 // 默认为 6
 @property (nonatomic, assign) NSInteger maxConcurrentDownloads;
 
+// Whether to adjust the concurrent downloads by the measured network condition, instead of the fixed `maxConcurrentDownloads`. The limit starts from `maxConcurrentDownloads`, grows by one after a round of requests completes quickly, and halves when requests time out or the time to first byte inflates (AIMD), within `minAdaptiveConcurrentDownloads` and `maxAdaptiveConcurrentDownloads`. See `concurrencyController` of `SDWebImageDownloader` for the metrics.
+// Defaults to NO.
+// @note This property does not support dynamic changes, means it's immutable after the downloader instance initialized.
+// 是否根据测量的网络状况调整并发下载数，而不是使用固定的 `maxConcurrentDownloads`。限制从 `maxConcurrentDownloads` 开始，在一轮请求快速完成后增加 1，在请求超时或首字节时间膨胀时减半（AIMD），范围在 `minAdaptiveConcurrentDownloads` 和 `maxAdaptiveConcurrentDownloads` 之间。指标参见 `SDWebImageDownloader` 的 `concurrencyController`。
+// 默认为 NO。
+// 注意：此属性不支持动态更改，意味着它在 downloader 实例初始化后是不可变的。
+@property (nonatomic, assign) BOOL shouldAdaptConcurrentDownloads;
+
+// The lower bound of the adaptive concurrent downloads.
+// Defaults to 2.
+// @note This property does not support dynamic changes, means it's immutable after the downloader instance initialized.
+// 自适应并发下载数的下限。
+// 默认为 2。
+// 注意：此属性不支持动态更改，意味着它在 downloader 实例初始化后是不可变的。
+@property (nonatomic, assign) NSInteger minAdaptiveConcurrentDownloads;
+
+// The upper bound of the adaptive concurrent downloads.
+// Defaults to 16.
+// @note This property does not support dynamic changes, means it's immutable after the downloader instance initialized.
+// 自适应并发下载数的上限。
+// 默认为 16。
+// 注意：此属性不支持动态更改，意味着它在 downloader 实例初始化后是不可变的。
+@property (nonatomic, assign) NSInteger maxAdaptiveConcurrentDownloads;
+
 // The timeout value (in seconds) for each download operation.
 // Defaults to 15.0.
 // 每次下载操作的超时 value（以秒为单位）
@@ -58,6 +82,26 @@ typedef NS_ENUM(NSInteger, SDWebImageDownloaderExecutionOrder) {
 // 默认为 0，这意味着每次从 URLSession 接收新数据时，我们立即回调 progressBlock。
 @property (nonatomic, assign) double minimumProgressInterval;
 
+// The minimum bytes received for an interrupted download to be resumed. When a download fails or is cancelled after receiving this many bytes, the partial data is kept on disk with the validator (strong ETag or Last-Modified) of response, and the next download of the same URL requests the rest with `Range` and `If-Range` headers. If the image changed on server, the full image is downloaded instead.
+// Only the GET requests of HTTP/HTTPS whose response has a validator and no content encoding are resumable.
+// The partial data of all downloaders is limited to 50MB in total, the least recently used one is removed first. It's also counted in the `diskBudget` of `SDDiskBudgetManager`.
+// Defaults to 0. Which means the downloads are not resumed.
+// 被中断的下载可以续传所需接收的最小字节数。当下载在接收了这么多字节后失败或被取消时，部分数据会连同响应的校验器（强 ETag 或 Last-Modified）保存在磁盘上，下一次下载相同的 URL 时会使用 `Range` 和 `If-Range` 头请求剩余部分。如果服务器上的图像已更改，则会改为下载完整的图像。
+// 只有响应带有校验器且没有内容编码的 HTTP/HTTPS GET 请求才可以续传。
+// 所有下载器的部分数据总共限制为 50MB，最久未使用的会被优先删除。它也会计入 `SDDiskBudgetManager` 的 `diskBudget`。
+// 默认为 0。这意味着下载不会续传。
+@property (nonatomic, assign) NSUInteger minimumResumableDownloadSize;
+
+// Whether to decode the image while downloading. The received data is fed to the incremental coder (`SDProgressiveImageCoder`) in the coder queue as it arrives, and the rows received are decoded periodically, instead of feeding all the data after the download finishes. Unlike `SDWebImageDownloaderProgressiveLoad`, no partial image is called back. This takes no effect when that option is set.
+// Each periodic decoding allocates a full size bitmap of the partial image, so the peak memory of a download grows by one decoded image (width * height * 4 bytes) while it's decoding. How much of the final decoding is saved depends on the codec, measure it with your images before enabling this.
+// Only the static images (JPEG, or any format with `SDWebImageDownloaderDecodeFirstFrameOnly`) are decoded in this way, others are decoded after the download as usual. See `SDImageLoaderDecodeStreamingImageData`.
+// Defaults to NO.
+// 是否在下载的同时解码图像。接收到的数据会在到达时于 coder 队列中提供给渐进式 coder（`SDProgressiveImageCoder`），并定期解码已接收的行，而不是在下载完成后才提供所有数据。与 `SDWebImageDownloaderProgressiveLoad` 不同，不会回调部分图像。设置该选项时此属性无效。
+// 每次定期解码都会分配一个部分图像的完整尺寸位图，因此解码期间一次下载的峰值内存会增加一张解码后的图像（宽 * 高 * 4 字节）。最终解码能节省多少取决于编解码器，启用之前请使用你的图像进行测量。
+// 只有静态图像（JPEG，或设置了 `SDWebImageDownloaderDecodeFirstFrameOnly` 的任何格式）会以这种方式解码，其他图像照常在下载后解码。参见 `SDImageLoaderDecodeStreamingImageData`。
+// 默认为 NO。
+@property (nonatomic, assign) BOOL shouldDecodeWhileDownloading;
+
 // The custom session configuration in use by NSURLSession. If you don't provide one, we will use `defaultSessionConfiguration` instead.
 // Defatuls to nil.
 // @note This property does not support dynamic changes, means it's immutable after the downloader instance initialized.
@@ -74,9 +118,9 @@ typedef NS_ENUM(NSInteger, SDWebImageDownloaderExecutionOrder) {
 // 注意：将 `NSOperation<SDWebImageDownloaderOperation>` 设置为默认值。设置 `nil` 将恢复为 `SDWebImageDownloaderOperation`。
 @property (nonatomic, assign, nullable) Class operationClass;
 
-// Changes download operations execution order.
+// Changes download operations execution order. The downloads of higher priority always start first, this is the order of the downloads with the same priority.
 // Defaults to `SDWebImageDownloaderFIFOExecutionOrder`.
-// 更改下载操作执行顺序。
+// 更改下载操作执行顺序。优先级更高的下载总是先启动，这是相同优先级的下载的顺序。
 // 默认为 `SDWebImageDownloaderFIFOExecutionOrder`
 @property (nonatomic, assign) SDWebImageDownloaderExecutionOrder executionOrder;
 
@@ -24,7 +24,11 @@ static SDWebImageDownloaderConfig * _defaultDownloaderConfig;
     self = [super init];
     if (self) {
         _maxConcurrentDownloads = 6;
+        _shouldAdaptConcurrentDownloads = NO;
+        _minAdaptiveConcurrentDownloads = 2;
+        _maxAdaptiveConcurrentDownloads = 16;
         _downloadTimeout = 15.0;
+        _shouldDecodeWhileDownloading = NO;
         _executionOrder = SDWebImageDownloaderFIFOExecutionOrder;
     }
     return self;
@@ -33,8 +37,13 @@ static SDWebImageDownloaderConfig * _defaultDownloaderConfig;
 - (id)copyWithZone:(NSZone *)zone {
     SDWebImageDownloaderConfig *config = [[[self class] allocWithZone:zone] init];
     config.maxConcurrentDownloads = self.maxConcurrentDownloads;
+    config.shouldAdaptConcurrentDownloads = self.shouldAdaptConcurrentDownloads;
+    config.minAdaptiveConcurrentDownloads = self.minAdaptiveConcurrentDownloads;
+    config.maxAdaptiveConcurrentDownloads = self.maxAdaptiveConcurrentDownloads;
     config.downloadTimeout = self.downloadTimeout;
     config.minimumProgressInterval = self.minimumProgressInterval;
+    config.minimumResumableDownloadSize = self.minimumResumableDownloadSize;
+    config.shouldDecodeWhileDownloading = self.shouldDecodeWhileDownloading;
     config.sessionConfiguration = [self.sessionConfiguration copyWithZone:zone];
     config.operationClass = self.operationClass;
     config.executionOrder = self.executionOrder;
@@ -39,6 +39,9 @@
 @property (strong, nonatomic, readonly, nullable) NSURLSessionTask *dataTask;
 @property (strong, nonatomic, nullable) NSURLCredential *credential;
 @property (assign, nonatomic) double minimumProgressInterval;
+@property (assign, nonatomic) float priority;
+@property (assign, nonatomic) NSUInteger minimumResumableSize;
+@property (assign, nonatomic) BOOL decodesWhileDownloading;
 
 @end
 
@@ -73,6 +76,24 @@
  */
 @property (assign, nonatomic) double minimumProgressInterval;
 
+// The priority of the operation's task, from 0.0 to 1.0, see `NSURLSessionTask.priority`. It can be changed at any time, the running task is updated as well.
+// Defaults to `NSURLSessionTaskPriorityHigh` for `SDWebImageDownloaderHighPriority`, `NSURLSessionTaskPriorityLow` for `SDWebImageDownloaderLowPriority`, otherwise `NSURLSessionTaskPriorityDefault`.
+// 操作任务的优先级，从 0.0 到 1.0，参见 `NSURLSessionTask.priority`。可以随时更改，正在运行的任务也会被更新。
+// 对于 `SDWebImageDownloaderHighPriority` 默认为 `NSURLSessionTaskPriorityHigh`，对于 `SDWebImageDownloaderLowPriority` 默认为 `NSURLSessionTaskPriorityLow`，否则为 `NSURLSessionTaskPriorityDefault`。
+@property (assign, nonatomic) float priority;
+
+// The minimum bytes received for the interrupted download to be resumed by next operation of the same URL, see `minimumResumableDownloadSize` of `SDWebImageDownloaderConfig`.
+// Defaults to 0. Which means the download is not resumed.
+// 被中断的下载可以由相同 URL 的下一个操作续传所需接收的最小字节数，参见 `SDWebImageDownloaderConfig` 的 `minimumResumableDownloadSize`。
+// 默认为 0。这意味着下载不会续传。
+@property (assign, nonatomic) NSUInteger minimumResumableSize;
+
+// Whether to feed the received data to the incremental coder while downloading, without the partial images, see `shouldDecodeWhileDownloading` of `SDWebImageDownloaderConfig`.
+// Defaults to NO.
+// 是否在下载的同时将接收到的数据提供给渐进式 coder，不产生部分图像，参见 `SDWebImageDownloaderConfig` 的 `shouldDecodeWhileDownloading`。
+// 默认为 NO。
+@property (assign, nonatomic) BOOL decodesWhileDownloading;
+
 /**
  * The options for the receiver.
  */
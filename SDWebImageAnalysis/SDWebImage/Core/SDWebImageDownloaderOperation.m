@@ -9,6 +9,8 @@
 #import "SDWebImageDownloaderOperation.h"
 #import "SDWebImageError.h"
 #import "SDInternalMacros.h"
+#import "SDWebImageDownloaderDataBuffer.h"
+#import "SDWebImageDownloaderResumeStore.h"
 
 // iOS 8 Foundation.framework extern these symbol but the define is in CFNetwork.framework. We just fix this without import CFNetwork.framework
 #if (__IPHONE_OS_VERSION_MIN_REQUIRED && __IPHONE_OS_VERSION_MIN_REQUIRED < __IPHONE_9_0)
@@ -31,13 +33,17 @@ typedef NSMutableDictionary<NSString *, id> SDCallbacksDictionary;
 
 @property (assign, nonatomic, getter = isExecuting) BOOL executing;
 @property (assign, nonatomic, getter = isFinished) BOOL finished;
-@property (strong, nonatomic, nullable) NSMutableData *imageData;
+@property (strong, nonatomic, nullable) SDWebImageDownloaderDataBuffer *imageData; // append-only, snapshots are taken without copy
 @property (copy, nonatomic, nullable) NSData *cachedData; // for `SDWebImageDownloaderIgnoreCachedResponse`
 @property (assign, nonatomic) NSUInteger expectedSize; // may be 0
 @property (assign, nonatomic) NSUInteger receivedSize;
 @property (strong, nonatomic, nullable, readwrite) NSURLResponse *response;
 @property (strong, nonatomic, nullable) NSError *responseError;
 @property (assign, nonatomic) double previousProgress; // previous progress percent
+@property (assign, nonatomic) NSUInteger resumeLength; // the length of partial data of last interrupted download requested with `Range`, 0 if not resuming
+@property (copy, nonatomic, nullable) NSString *resumeRangeValidator; // the validator of partial data sent with `If-Range`, nil if not resuming
+@property (copy, nonatomic, nullable) NSString *resumeValidator; // the validator of response for `If-Range`, nil if the download is not resumable
+@property (assign, nonatomic) BOOL streamingDecodeScheduled; // a streaming decode is pending in coder queue
 
 // This is weak because it is injected by whoever manages this session. If this gets nil-ed out, we won't be able to run
 // the task associated with this operation
@@ -54,6 +60,34 @@ typedef NSMutableDictionary<NSString *, id> SDCallbacksDictionary;
 
 @end
 
+static inline NSString * _Nullable SDWebImageDownloaderHeaderValue(NSHTTPURLResponse * _Nonnull response, NSString * _Nonnull field) {
+    // The header fields are case-insensitive
+    for (NSString *key in response.allHeaderFields) {
+        if ([key caseInsensitiveCompare:field] == NSOrderedSame) {
+            id value = response.allHeaderFields[key];
+            return [value isKindOfClass:[NSString class]] ? value : nil;
+        }
+    }
+    return nil;
+}
+
+// The first byte position of `Content-Range: bytes <first>-<last>/<length>`, -1 if there is none
+static inline long long SDWebImageDownloaderContentRangeStart(NSURLResponse * _Nonnull response) {
+    if (![response isKindOfClass:[NSHTTPURLResponse class]]) {
+        return -1;
+    }
+    NSString *contentRange = SDWebImageDownloaderHeaderValue((NSHTTPURLResponse *)response, @"Content-Range");
+    if (!contentRange) {
+        return -1;
+    }
+    NSScanner *scanner = [NSScanner scannerWithString:contentRange];
+    long long start = -1;
+    if (![scanner scanString:@"bytes" intoString:nil] || ![scanner scanLongLong:&start]) {
+        return -1;
+    }
+    return start;
+}
+
 @implementation SDWebImageDownloaderOperation
 
 @synthesize executing = _executing;
@@ -79,6 +113,13 @@ typedef NSMutableDictionary<NSString *, id> SDCallbacksDictionary;
         _executing = NO;
         _finished = NO;
         _expectedSize = 0;
+        if (options & SDWebImageDownloaderHighPriority) {
+            _priority = NSURLSessionTaskPriorityHigh;
+        } else if (options & SDWebImageDownloaderLowPriority) {
+            _priority = NSURLSessionTaskPriorityLow;
+        } else {
+            _priority = NSURLSessionTaskPriorityDefault;
+        }
         _unownedSession = session;
         _coderQueue = dispatch_queue_create("com.hackemist.SDWebImageDownloaderOperationCoderQueue", DISPATCH_QUEUE_SERIAL);
 #if SD_UIKIT
@@ -191,16 +232,12 @@ typedef NSMutableDictionary<NSString *, id> SDCallbacksDictionary;
             }
         }
         
-        self.dataTask = [session dataTaskWithRequest:self.request];
+        self.dataTask = [session dataTaskWithRequest:[self requestResumingPartialData]];
+        self.dataTask.priority = self.priority;
         self.executing = YES;
     }
 
     if (self.dataTask) {
-        if (self.options & SDWebImageDownloaderHighPriority) {
-            self.dataTask.priority = NSURLSessionTaskPriorityHigh;
-        } else if (self.options & SDWebImageDownloaderLowPriority) {
-            self.dataTask.priority = NSURLSessionTaskPriorityLow;
-        }
         [self.dataTask resume];
         for (SDWebImageDownloaderProgressBlock progressBlock in [self callbacksForKey:kProgressCallbackKey]) {
             progressBlock(0, NSURLResponseUnknownLength, self.request.URL);
@@ -221,6 +258,13 @@ typedef NSMutableDictionary<NSString *, id> SDCallbacksDictionary;
     }
 }
 
+- (void)setPriority:(float)priority {
+    @synchronized (self) {
+        _priority = MIN(MAX(priority, 0), 1);
+        self.dataTask.priority = _priority;
+    }
+}
+
 - (void)cancelInternal {
     if (self.isFinished) return;
     [super cancel];
@@ -237,6 +281,9 @@ typedef NSMutableDictionary<NSString *, id> SDCallbacksDictionary;
         if (self.isExecuting) self.executing = NO;
         if (!self.isFinished) self.finished = YES;
     }
+    // Keep the received data, the next download of the same URL resumes from it
+    // 保留已接收的数据，下一次下载相同的 URL 时从这里继续
+    [self storePartialDataIfNeeded];
     // Operation cancelled by user before sending the request
     [self callCompletionBlocksWithError:[NSError errorWithDomain:SDWebImageErrorDomain code:SDWebImageErrorCancelled userInfo:nil]];
 
@@ -286,18 +333,182 @@ typedef NSMutableDictionary<NSString *, id> SDCallbacksDictionary;
     return YES;
 }
 
+#pragma mark Streaming Decode
+
+- (BOOL)shouldDecodeWhileDownloading {
+    // The progressive decoding already consumes the data while downloading
+    return self.decodesWhileDownloading && !(self.options & SDWebImageDownloaderProgressiveLoad);
+}
+
+// Feed the data received to the coder in coder queue, the calls before it runs are coalesced, so the coder queue does not fall behind the data
+- (void)setNeedsStreamingDecode {
+    @synchronized (self) {
+        if (self.streamingDecodeScheduled) {
+            return;
+        }
+        self.streamingDecodeScheduled = YES;
+    }
+    dispatch_async(self.coderQueue, ^{
+        NSData *imageData;
+        @synchronized (self) {
+            self.streamingDecodeScheduled = NO;
+            // nil after completion, the final decoding is queued already
+            imageData = [self.imageData snapshot];
+        }
+        if (!imageData || self.isCancelled) {
+            return;
+        }
+        @autoreleasepool {
+            SDImageLoaderDecodeStreamingImageData(imageData, self.request.URL, NO, self, [[self class] imageOptionsFromDownloaderOptions:self.options], self.context);
+        }
+    });
+}
+
+#pragma mark Resume
+
+- (BOOL)isResumableRequest:(NSURLRequest *)request {
+    if (self.minimumResumableSize == 0 || !request.URL) {
+        return NO;
+    }
+    // The cached response is compared with the full data
+    if (self.options & SDWebImageDownloaderIgnoreCachedResponse) {
+        return NO;
+    }
+    NSString *scheme = request.URL.scheme.lowercaseString;
+    if (![scheme isEqualToString:@"http"] && ![scheme isEqualToString:@"https"]) {
+        return NO;
+    }
+    if (request.HTTPMethod && ![request.HTTPMethod isEqualToString:@"GET"]) {
+        return NO;
+    }
+    return [request valueForHTTPHeaderField:@"Range"] == nil;
+}
+
+// Make sure to call with lock held. Returns the request for the rest, if there is partial data of the interrupted download. Only the in-memory entry is looked up, the partial data is read when the server sends the rest
+- (nonnull NSURLRequest *)requestResumingPartialData {
+    NSURLRequest *request = self.request;
+    self.resumeLength = 0;
+    self.resumeRangeValidator = nil;
+    if (![self isResumableRequest:request]) {
+        return request;
+    }
+    NSUInteger partialLength = 0;
+    NSString *validator;
+    if (![[SDWebImageDownloaderResumeStore sharedStore] getPartialDataLength:&partialLength validator:&validator forURL:request.URL] || partialLength == 0 || !validator) {
+        return request;
+    }
+    // `If-Range` makes the server send the full image if it changed, instead of the rest of another image
+    // `If-Range` 使服务器在图像已更改时发送完整图像，而不是另一个图像的剩余部分
+    NSMutableURLRequest *mutableRequest = [request mutableCopy];
+    [mutableRequest setValue:[NSString stringWithFormat:@"bytes=%lu-", (unsigned long)partialLength] forHTTPHeaderField:@"Range"];
+    [mutableRequest setValue:validator forHTTPHeaderField:@"If-Range"];
+    self.resumeLength = partialLength;
+    self.resumeRangeValidator = validator;
+    return [mutableRequest copy];
+}
+
+// The strong ETag, or the Last-Modified date. Returns nil if the response can not be resumed
+- (nullable NSString *)resumeValidatorForResponse:(nonnull NSURLResponse *)response {
+    if (![self isResumableRequest:self.request] || ![response isKindOfClass:[NSHTTPURLResponse class]]) {
+        return nil;
+    }
+    NSHTTPURLResponse *HTTPResponse = (NSHTTPURLResponse *)response;
+    // URLSession decodes the content, the length of decoded data is not the offset of range
+    NSString *contentEncoding = SDWebImageDownloaderHeaderValue(HTTPResponse, @"Content-Encoding");
+    if (contentEncoding.length > 0 && ![contentEncoding.lowercaseString isEqualToString:@"identity"]) {
+        return nil;
+    }
+    if ([SDWebImageDownloaderHeaderValue(HTTPResponse, @"Accept-Ranges").lowercaseString isEqualToString:@"none"]) {
+        return nil;
+    }
+    // The weak ETag can not be used for `If-Range`
+    NSString *eTag = SDWebImageDownloaderHeaderValue(HTTPResponse, @"ETag");
+    if (eTag.length > 0 && ![eTag hasPrefix:@"W/"]) {
+        return eTag;
+    }
+    NSString *lastModified = SDWebImageDownloaderHeaderValue(HTTPResponse, @"Last-Modified");
+    return lastModified.length > 0 ? lastModified : nil;
+}
+
+// Make sure to call with lock held
+- (void)storePartialDataIfNeeded {
+    NSUInteger minimumResumableSize = self.minimumResumableSize;
+    if (minimumResumableSize == 0 || !self.resumeValidator || self.imageData.length < minimumResumableSize) {
+        return;
+    }
+    // The snapshot does not copy, and the write is asynchronous
+    [[SDWebImageDownloaderResumeStore sharedStore] storePartialData:[self.imageData snapshot] validator:self.resumeValidator forURL:self.request.URL];
+    self.resumeValidator = nil;
+}
+
+// Replace the task with the one for the full image, the callbacks of the replaced task are ignored. Returns NO if the operation is cancelled
+- (BOOL)restartDataTaskWithoutRange {
+    NSURLSessionTask *dataTask;
+    @synchronized (self) {
+        NSURLSession *session = self.ownedSession ?: self.unownedSession;
+        if (self.isCancelled || !session) {
+            return NO;
+        }
+        dataTask = [session dataTaskWithRequest:self.request];
+        dataTask.priority = self.priority;
+        self.dataTask = dataTask;
+    }
+    [dataTask resume];
+    return YES;
+}
+
 #pragma mark NSURLSessionDataDelegate
 
 - (void)URLSession:(NSURLSession *)session
           dataTask:(NSURLSessionDataTask *)dataTask
 didReceiveResponse:(NSURLResponse *)response
  completionHandler:(void (^)(NSURLSessionResponseDisposition disposition))completionHandler {
+    NSInteger statusCode = [response respondsToSelector:@selector(statusCode)] ? ((NSHTTPURLResponse *)response).statusCode : 200;
+    NSUInteger resumeLength = self.resumeLength;
+    NSString *resumeRangeValidator = self.resumeRangeValidator;
+    self.resumeLength = 0;
+    self.resumeRangeValidator = nil;
+    if (resumeLength > 0 && statusCode == 206 && SDWebImageDownloaderContentRangeStart(response) == (long long)resumeLength) {
+        // Read the partial data only when the server sends the rest. It's read in the queue of resume store, because the delegate queue is shared by all downloads. The data is not received before calling `completionHandler`
+        // 只在服务器发送剩余部分时读取部分数据。在续传存储的队列中读取，因为代理队列由所有下载共享。调用 `completionHandler` 之前不会接收到数据
+        [[SDWebImageDownloaderResumeStore sharedStore] readPartialDataForURL:self.request.URL validator:resumeRangeValidator length:resumeLength completion:^(NSData * _Nullable resumeData) {
+            [self didReceiveResponse:response resumeData:resumeData resumeLength:resumeLength completionHandler:completionHandler];
+        }];
+        return;
+    }
+    [self didReceiveResponse:response resumeData:nil resumeLength:resumeLength completionHandler:completionHandler];
+}
+
+// `resumeLength` is 0 if not resuming, `resumeData` is nil if the partial data does not fit the response
+- (void)didReceiveResponse:(nonnull NSURLResponse *)response resumeData:(nullable NSData *)resumeData resumeLength:(NSUInteger)resumeLength completionHandler:(void (^)(NSURLSessionResponseDisposition disposition))completionHandler {
     NSURLSessionResponseDisposition disposition = NSURLSessionResponseAllow;
     NSInteger expected = (NSInteger)response.expectedContentLength;
     expected = expected > 0 ? expected : 0;
+    NSInteger statusCode = [response respondsToSelector:@selector(statusCode)] ? ((NSHTTPURLResponse *)response).statusCode : 200;
+    if (resumeLength > 0) {
+        if (resumeData) {
+            // The server sends the rest, continue from the partial data
+            // 服务器发送剩余部分，从部分数据继续
+            @synchronized (self) {
+                self.imageData = [[SDWebImageDownloaderDataBuffer alloc] initWithCapacity:resumeLength + expected];
+                [self.imageData appendData:resumeData];
+            }
+            self.receivedSize = resumeLength;
+            expected = expected > 0 ? resumeLength + expected : 0;
+        } else {
+            // The server sends the full image because it changed (200), or the partial data does not fit it (206 of other range, or 416), or the partial data is removed meanwhile. Drop the partial data
+            // 服务器因为图像已更改而发送完整图像（200），或者部分数据与其不匹配（其他范围的 206，或 416），或者部分数据同时被删除了。丢弃部分数据
+            [[SDWebImageDownloaderResumeStore sharedStore] removePartialDataForURL:self.request.URL];
+            if ((statusCode == 206 || statusCode == 416) && [self restartDataTaskWithoutRange]) {
+                if (completionHandler) {
+                    completionHandler(NSURLSessionResponseCancel);
+                }
+                return;
+            }
+        }
+    }
     self.expectedSize = expected;
     self.response = response;
-    NSInteger statusCode = [response respondsToSelector:@selector(statusCode)] ? ((NSHTTPURLResponse *)response).statusCode : 200;
     BOOL valid = statusCode >= 200 && statusCode < 400;
     if (!valid) {
         self.responseError = [NSError errorWithDomain:SDWebImageErrorDomain code:SDWebImageErrorInvalidDownloadStatusCode userInfo:@{SDWebImageErrorDownloadStatusCodeKey : @(statusCode)}];
@@ -310,8 +521,9 @@ didReceiveResponse:(NSURLResponse *)response
     }
     
     if (valid) {
+        self.resumeValidator = [self resumeValidatorForResponse:response];
         for (SDWebImageDownloaderProgressBlock progressBlock in [self callbacksForKey:kProgressCallbackKey]) {
-            progressBlock(0, expected, self.request.URL);
+            progressBlock(self.receivedSize, expected, self.request.URL);
         }
     } else {
         // Status code invalid and marked as cancelled. Do not call `[self.dataTask cancel]` which may mass up URLSession life cycle
@@ -328,10 +540,17 @@ didReceiveResponse:(NSURLResponse *)response
 }
 
 - (void)URLSession:(NSURLSession *)session dataTask:(NSURLSessionDataTask *)dataTask didReceiveData:(NSData *)data {
-    if (!self.imageData) {
-        self.imageData = [[NSMutableData alloc] initWithCapacity:self.expectedSize];
+    // Lock with the snapshot of partial data on cancel
+    // 与取消时的部分数据快照互斥
+    @synchronized (self) {
+        if (!self.imageData) {
+            self.imageData = [[SDWebImageDownloaderDataBuffer alloc] initWithCapacity:self.expectedSize];
+        }
+        [self.imageData appendData:data];
+    }
+    if ([self shouldDecodeWhileDownloading]) {
+        [self setNeedsStreamingDecode];
     }
-    [self.imageData appendData:data];
     
     self.receivedSize = self.imageData.length;
     if (self.expectedSize == 0) {
@@ -355,8 +574,8 @@ didReceiveResponse:(NSURLResponse *)response
     self.previousProgress = currentProgress;
 
     if (self.options & SDWebImageDownloaderProgressiveLoad) {
-        // Get the image data
-        NSData *imageData = [self.imageData copy];
+        // Get the image data, the snapshot does not copy the bytes received
+        NSData *imageData = [self.imageData snapshot];
         
         // progressive decode the image in coder queue
         dispatch_async(self.coderQueue, ^{
@@ -397,6 +616,8 @@ didReceiveResponse:(NSURLResponse *)response
 - (void)URLSession:(NSURLSession *)session task:(NSURLSessionTask *)task didCompleteWithError:(NSError *)error {
     // If we already cancel the operation or anything mark the operation finished, don't callback twice
     if (self.isFinished) return;
+    // The task replaced by `restartDataTaskWithoutRange`
+    if (self.dataTask && task != self.dataTask) return;
     
     @synchronized(self) {
         self.dataTask = nil;
@@ -415,12 +636,21 @@ didReceiveResponse:(NSURLResponse *)response
         if (self.responseError) {
             error = self.responseError;
         }
+        @synchronized (self) {
+            [self storePartialDataIfNeeded];
+        }
         [self callCompletionBlocksWithError:error];
         [self done];
     } else {
+        if ([self isResumableRequest:self.request]) {
+            [[SDWebImageDownloaderResumeStore sharedStore] removePartialDataForURL:self.request.URL];
+        }
         if ([self callbacksForKey:kCompletedCallbackKey].count > 0) {
-            NSData *imageData = [self.imageData copy];
-            self.imageData = nil;
+            NSData *imageData;
+            @synchronized (self) {
+                imageData = [self.imageData compactedData];
+                self.imageData = nil;
+            }
             if (imageData) {
                 // if you specified to only use cached data via `SDWebImageDownloaderIgnoreCachedResponse`, then we should check if the cached data is equal to image data
                 // 如果指定仅通过 `SDWebImageDownloaderIgnoreCachedResponse` 使用缓存数据，则应检查缓存数据是否等于图像数据
@@ -434,7 +664,15 @@ didReceiveResponse:(NSURLResponse *)response
                     // 在 coder 队列中解码图像
                     dispatch_async(self.coderQueue, ^{
                         @autoreleasepool {
-                            UIImage *image = SDImageLoaderDecodeImageData(imageData, self.request.URL, [[self class] imageOptionsFromDownloaderOptions:self.options], self.context);
+                            UIImage *image;
+                            if ([self shouldDecodeWhileDownloading]) {
+                                // Finish with the coder which has consumed the data received
+                                // 使用已处理过接收数据的 coder 完成解码
+                                image = SDImageLoaderDecodeStreamingImageData(imageData, self.request.URL, YES, self, [[self class] imageOptionsFromDownloaderOptions:self.options], self.context);
+                            }
+                            if (!image) {
+                                image = SDImageLoaderDecodeImageData(imageData, self.request.URL, [[self class] imageOptionsFromDownloaderOptions:self.options], self.context);
+                            }
                             CGSize imageSize = image.size;
                             if (imageSize.width == 0 || imageSize.height == 0) {
                                 [self callCompletionBlocksWithError:[NSError errorWithDomain:SDWebImageErrorDomain code:SDWebImageErrorBadImageData userInfo:@{NSLocalizedDescriptionKey : @"Downloaded image has 0 pixels"}]];
@@ -206,6 +206,13 @@ static id<SDImageLoader> _defaultImageLoader;
                 [self safelyRemoveOperationFromRunning:operation];
                 return;
             }
+            // The transformed image missed, try to transform the original image in cache
+            // 转换后的图像未命中，尝试转换缓存中的原始图像
+            id<SDImageTransformer> transformer = context[SDWebImageContextImageTransformer];
+            if (!cachedImage && transformer && !(options & SDWebImageAvoidOriginalCacheQuery) && !(options & SDWebImageRefreshCached)) {
+                [self callOriginalCacheProcessForOperation:operation url:url options:options context:context progress:progressBlock completed:completedBlock];
+                return;
+            }
             // Continue download process
             // 继续下载进程
             [self callDownloadProcessForOperation:operation url:url options:options context:context cachedImage:cachedImage cachedData:cachedData cacheType:cacheType progress:progressBlock completed:completedBlock];
@@ -217,6 +224,66 @@ static id<SDImageLoader> _defaultImageLoader;
     }
 }
 
+// Query original cache process, the transformed image is derived from the original image instead of downloading
+- (void)callOriginalCacheProcessForOperation:(nonnull SDWebImageCombinedOperation *)operation
+                                         url:(nonnull NSURL *)url
+                                     options:(SDWebImageOptions)options
+                                     context:(nullable SDWebImageContext *)context
+                                    progress:(nullable SDImageLoaderProgressBlock)progressBlock
+                                   completed:(nullable SDInternalCompletionBlock)completedBlock {
+    id<SDWebImageCacheKeyFilter> cacheKeyFilter = context[SDWebImageContextCacheKeyFilter];
+    NSString *key = [self cacheKeyForURL:url cacheKeyFilter:cacheKeyFilter];
+    id<SDImageTransformer> transformer = context[SDWebImageContextImageTransformer];
+    // Query the original image with the same options, but without transformer
+    // 使用相同的选项查询原始图像，但不使用转换器
+    SDWebImageMutableContext *originalContext = context ? [context mutableCopy] : [NSMutableDictionary dictionary];
+    [originalContext removeObjectForKey:SDWebImageContextImageTransformer];
+    // The original image is only used to transform, do not keep the full size image in memory cache unless the original store cache type asks for it
+    // 原始图像仅用于转换，除非原始图像的存储缓存类型要求，否则不在内存缓存中保留全尺寸图像
+    SDImageCacheType originalStoreCacheType = SDImageCacheTypeNone;
+    if (context[SDWebImageContextOriginalStoreCacheType]) {
+        originalStoreCacheType = [context[SDWebImageContextOriginalStoreCacheType] integerValue];
+    }
+    if (originalStoreCacheType != SDImageCacheTypeMemory && originalStoreCacheType != SDImageCacheTypeAll) {
+        originalContext[SDWebImageContextQueryAvoidMemoryCache] = @(YES);
+    }
+    @weakify(operation);
+    operation.cacheOperation = [self.imageCache queryImageForKey:key options:options context:[originalContext copy] completion:^(UIImage * _Nullable originalImage, NSData * _Nullable originalData, SDImageCacheType cacheType) {
+        @strongify(operation);
+        if (!operation || operation.isCancelled) {
+            [self callCompletionBlockForOperation:operation completion:completedBlock error:[NSError errorWithDomain:SDWebImageErrorDomain code:SDWebImageErrorCancelled userInfo:nil] url:url];
+            [self safelyRemoveOperationFromRunning:operation];
+            return;
+        }
+        if (!originalImage) {
+            // Continue download process
+            // 继续下载进程
+            [self callDownloadProcessForOperation:operation url:url options:options context:context cachedImage:nil cachedData:nil cacheType:SDImageCacheTypeNone progress:progressBlock completed:completedBlock];
+            return;
+        }
+        BOOL shouldTransformImage = !originalImage.sd_isAnimated || (options & SDWebImageTransformAnimatedImage);
+        if (!shouldTransformImage) {
+            // The same as downloaded, the animated image is not transformed
+            // 与下载的处理相同，动图不会被转换
+            [self callCompletionBlockForOperation:operation completion:completedBlock image:originalImage data:originalData error:nil cacheType:cacheType finished:YES url:url];
+            [self safelyRemoveOperationFromRunning:operation];
+            return;
+        }
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^{
+            @autoreleasepool {
+                UIImage *transformedImage = [transformer transformedImageWithImage:originalImage forKey:key];
+                if (!transformedImage) {
+                    [self callDownloadProcessForOperation:operation url:url options:options context:context cachedImage:nil cachedData:nil cacheType:SDImageCacheTypeNone progress:progressBlock completed:completedBlock];
+                    return;
+                }
+                [self storeTransformedImage:transformedImage originalImage:originalImage originalData:originalData forKey:key url:url transformer:transformer context:context];
+                [self callCompletionBlockForOperation:operation completion:completedBlock image:transformedImage data:originalData error:nil cacheType:cacheType finished:YES url:url];
+                [self safelyRemoveOperationFromRunning:operation];
+            }
+        });
+    }];
+}
+
 // Download process
 - (void)callDownloadProcessForOperation:(nonnull SDWebImageCombinedOperation *)operation
                                     url:(nonnull NSURL *)url
@@ -342,17 +409,7 @@ static id<SDImageLoader> _defaultImageLoader;
             @autoreleasepool {
                 UIImage *transformedImage = [transformer transformedImageWithImage:downloadedImage forKey:key];
                 if (transformedImage && finished) {
-                    NSString *transformerKey = [transformer transformerKey];
-                    NSString *cacheKey = SDTransformedKeyForKey(key, transformerKey);
-                    BOOL imageWasTransformed = ![transformedImage isEqual:downloadedImage];
-                    NSData *cacheData;
-                    // pass nil if the image was transformed, so we can recalculate the data from the image
-                    if (cacheSerializer && (storeCacheType == SDImageCacheTypeDisk || storeCacheType == SDImageCacheTypeAll)) {
-                        cacheData = [cacheSerializer cacheDataWithImage:transformedImage  originalData:(imageWasTransformed ? nil : downloadedData) imageURL:url];
-                    } else {
-                        cacheData = (imageWasTransformed ? nil : downloadedData);
-                    }
-                    [self.imageCache storeImage:transformedImage imageData:cacheData forKey:cacheKey cacheType:storeCacheType completion:nil];
+                    [self storeTransformedImage:transformedImage originalImage:downloadedImage originalData:downloadedData forKey:key url:url transformer:transformer context:context];
                 }
                 
                 [self callCompletionBlockForOperation:operation completion:completedBlock image:transformedImage data:downloadedData error:nil cacheType:SDImageCacheTypeNone finished:finished url:url];
@@ -365,6 +422,32 @@ static id<SDImageLoader> _defaultImageLoader;
 
 #pragma mark - Helper
 
+// Store the transformed image with the transformed key, call from global queue
+- (void)storeTransformedImage:(nonnull UIImage *)transformedImage
+                originalImage:(nonnull UIImage *)originalImage
+                 originalData:(nullable NSData *)originalData
+                       forKey:(nullable NSString *)key
+                          url:(nonnull NSURL *)url
+                  transformer:(nonnull id<SDImageTransformer>)transformer
+                      context:(nullable SDWebImageContext *)context {
+    SDImageCacheType storeCacheType = SDImageCacheTypeAll;
+    if (context[SDWebImageContextStoreCacheType]) {
+        storeCacheType = [context[SDWebImageContextStoreCacheType] integerValue];
+    }
+    id<SDWebImageCacheSerializer> cacheSerializer = context[SDWebImageContextCacheSerializer];
+    NSString *transformerKey = [transformer transformerKey];
+    NSString *cacheKey = SDTransformedKeyForKey(key, transformerKey);
+    BOOL imageWasTransformed = ![transformedImage isEqual:originalImage];
+    NSData *cacheData;
+    // pass nil if the image was transformed, so we can recalculate the data from the image
+    if (cacheSerializer && (storeCacheType == SDImageCacheTypeDisk || storeCacheType == SDImageCacheTypeAll)) {
+        cacheData = [cacheSerializer cacheDataWithImage:transformedImage  originalData:(imageWasTransformed ? nil : originalData) imageURL:url];
+    } else {
+        cacheData = (imageWasTransformed ? nil : originalData);
+    }
+    [self.imageCache storeImage:transformedImage imageData:cacheData forKey:cacheKey cacheType:storeCacheType completion:nil];
+}
+
 - (void)safelyRemoveOperationFromRunning:(nullable SDWebImageCombinedOperation*)operation {
     if (!operation) {
         return;
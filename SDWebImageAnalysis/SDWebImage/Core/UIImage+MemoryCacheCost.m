@@ -9,20 +9,39 @@
 #import "UIImage+MemoryCacheCost.h"
 #import "objc/runtime.h"
 #import "NSImage+Compatibility.h"
+#import "UIImage+MemoryCacheCostTracking.h"
 
-FOUNDATION_STATIC_INLINE NSUInteger SDMemoryCacheCostForImage(UIImage *image) {
-    CGImageRef imageRef = image.CGImage;
+FOUNDATION_STATIC_INLINE NSUInteger SDMemoryCacheCostForCGImage(CGImageRef imageRef) {
     if (!imageRef) {
         return 0;
     }
-    NSUInteger bytesPerFrame = CGImageGetBytesPerRow(imageRef) * CGImageGetHeight(imageRef);
-    NSUInteger frameCount;
+    return CGImageGetBytesPerRow(imageRef) * CGImageGetHeight(imageRef);
+}
+
+FOUNDATION_STATIC_INLINE NSUInteger SDMemoryCacheCostForImage(UIImage *image) {
+    NSUInteger cost = 0;
 #if SD_MAC
-    frameCount = 1;
+    cost = SDMemoryCacheCostForCGImage(image.CGImage);
 #elif SD_UIKIT || SD_WATCH
-    frameCount = image.images.count > 0 ? image.images.count : 1;
+    NSArray<UIImage *> *images = image.images;
+    if (images.count > 0) {
+        // The frames are repeated to match the durations, count each bitmap once
+        // 帧会被重复以匹配时长，每个位图只计算一次
+        CFMutableSetRef bitmaps = CFSetCreateMutable(kCFAllocatorDefault, images.count, NULL);
+        for (UIImage *frame in images) {
+            CGImageRef imageRef = frame.CGImage;
+            if (imageRef && !CFSetContainsValue(bitmaps, imageRef)) {
+                CFSetAddValue(bitmaps, imageRef);
+                cost += SDMemoryCacheCostForCGImage(imageRef);
+            }
+        }
+        CFRelease(bitmaps);
+    } else {
+        cost = SDMemoryCacheCostForCGImage(image.CGImage);
+    }
 #endif
-    NSUInteger cost = bytesPerFrame * frameCount;
+    // The frames buffered by views
+    cost += image.sd_bufferedMemoryCost;
     return cost;
 }
 
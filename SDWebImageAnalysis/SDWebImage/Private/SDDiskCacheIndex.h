@@ -0,0 +1,79 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "SDWebImageCompat.h"
+#import "NSData+ImageContentType.h"
+#import "SDImageCacheConfig.h"
+
+// The length of content digest, see `shouldDeduplicateDiskCacheData` in `SDImageCacheConfig`
+#define SDDiskCacheIndexDigestLength 16
+
+// The metadata of one file in disk cache
+@interface SDDiskCacheIndexEntry : NSObject
+
+@property (nonatomic, copy, nonnull) NSString *fileName; // the path relative to cache directory, which contains the shard directories in sharded layout
+@property (nonatomic, assign) NSUInteger size;
+@property (nonatomic, assign) NSTimeInterval modificationTime;
+@property (nonatomic, assign) NSTimeInterval accessTime;
+@property (nonatomic, assign) SDImageFormat format;
+@property (nonatomic, assign) NSUInteger hitCount;
+@property (nonatomic, assign) uint64_t checksum; // the checksum of file content, 0 if unknown (the entry is rebuilt from directory or adopted when read)
+@property (nonatomic, copy, nullable) NSData *digest; // the content digest if the file is a link of the shared blob, nil if not deduplicated
+@property (nonatomic, copy, nullable) NSArray<NSString *> *variantKeys; // the keys of the images transformed from this one, see `addVariantKey:forKey:` in `SDDiskCache`
+@property (nonatomic, assign) BOOL verified; // whether the checksum is verified since the index is loaded, not persisted
+
+@end
+
+// This is used for `SDDiskCache` to keep the metadata of all files without walking the directory.
+// The entries are kept in a list ordered by the date of `orderType` (oldest first), so expiration only visits the expired entries.
+// The changes are appended to a journal file, and folded into a snapshot file by `synchronize`. Access dates and hit counts are only persisted by `synchronize`.
+@interface SDDiskCacheIndex : NSObject
+
+@property (nonatomic, assign, readonly) NSUInteger totalSize; // the entries of same digest are counted once
+@property (nonatomic, assign, readonly) NSUInteger totalCount;
+@property (nonatomic, assign, readonly) SDImageCacheConfigExpireType orderType;
+// The size an unfinished size trim removes the oldest entries down to, 0 if there is none. It's persisted by `synchronize`, so the trim resumes on next launch
+@property (nonatomic, assign) NSUInteger trimTargetSize;
+
+- (nonnull instancetype)initWithDirectory:(nonnull NSString *)directory orderType:(SDImageCacheConfigExpireType)orderType;
+- (nonnull instancetype)init NS_UNAVAILABLE;
+
+// Whether the file name is one of the persisted index files, which is not a cache entry
++ (BOOL)isIndexFileName:(nonnull NSString *)fileName;
+
+// Load the persisted index. Return NO if there is no valid index, the caller should rebuild it with `resetWithEntries:`
+- (BOOL)load;
+// Replace all the entries, `entries` should be sorted by `orderType` (oldest first)
+- (void)resetWithEntries:(nonnull NSArray<SDDiskCacheIndexEntry *> *)entries;
+
+- (nullable SDDiskCacheIndexEntry *)entryForFileName:(nonnull NSString *)fileName;
+// Journaled, and move to the newest position, for the file just written
+- (void)setEntry:(nonnull SDDiskCacheIndexEntry *)entry;
+// Journaled, and insert at the position of its date, for the existing file which has no entry
+- (void)insertEntry:(nonnull SDDiskCacheIndexEntry *)entry;
+// Journaled, but keep the position and dates of entry, for the file moved to a new name
+- (void)renameEntryForFileName:(nonnull NSString *)fileName toFileName:(nonnull NSString *)newFileName;
+// Journaled, but keep the position of entry, so the order of expiration is not changed
+- (void)updateVariantKeys:(nullable NSArray<NSString *> *)variantKeys forFileName:(nonnull NSString *)fileName;
+- (void)removeEntryForFileName:(nonnull NSString *)fileName;
+// The number of entries with this digest, the shared blob can be removed when it's 0
+- (NSUInteger)referenceCountForDigest:(nonnull NSData *)digest;
+// Update access date and hit count
+- (void)touchEntryForFileName:(nonnull NSString *)fileName;
+- (void)removeAllEntries;
+
+// Enumerate from the oldest entry. It's safe to remove the enumerated entry in block
+- (void)enumerateEntriesFromOldestUsingBlock:(nonnull void(^)(SDDiskCacheIndexEntry * _Nonnull entry, BOOL * _Nonnull stop))block;
+
+// Write the snapshot and truncate the journal
+- (void)synchronize;
+// Remove the persisted index files, the next `load` returns NO
+- (void)invalidate;
+
+@end
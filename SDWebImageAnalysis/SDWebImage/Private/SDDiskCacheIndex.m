@@ -0,0 +1,537 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDDiskCacheIndex.h"
+#import <fcntl.h>
+#import <unistd.h>
+
+// Hidden file names, so the directory enumeration of disk cache skip them
+static NSString * const kSDDiskCacheIndexSnapshotFileName = @".sd_index";
+static NSString * const kSDDiskCacheIndexJournalFileName = @".sd_index_journal";
+static const uint32_t kSDDiskCacheIndexMagic = 0x53444349; // "SDCI"
+static const uint32_t kSDDiskCacheIndexVersion = 6;
+// Fold the journal into snapshot after this number of records
+static const NSUInteger kSDDiskCacheIndexMaxJournalCount = 4096;
+// The cache keys are URLs, which never contain a newline
+static NSString * const kSDDiskCacheIndexVariantKeySeparator = @"\n";
+static const uint8_t kSDDiskCacheIndexEmptyDigest[SDDiskCacheIndexDigestLength] = {0};
+
+typedef NS_ENUM(uint16_t, SDDiskCacheIndexOperation) {
+    SDDiskCacheIndexOperationSet = 1,
+    SDDiskCacheIndexOperationRemove = 2,
+    SDDiskCacheIndexOperationUpdate = 3, // update the variant keys of an existing entry, without moving it
+    SDDiskCacheIndexOperationInsert = 4, // insert at the position of its date, instead of the newest position
+    SDDiskCacheIndexOperationRename = 5 // rename an existing entry, without moving it
+};
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t orderType;
+    uint32_t count;
+    uint64_t trimTargetSize;
+} SDDiskCacheIndexHeader;
+
+// Used for both snapshot and journal, followed by the file name bytes, the variant keys bytes (UTF-8, separated by newline) and the new file name bytes of rename. All values are absolute, so replaying a record twice is harmless
+typedef struct {
+    uint32_t magic;
+    uint16_t operation;
+    uint16_t fileNameLength;
+    int32_t format;
+    uint32_t hitCount;
+    uint64_t size;
+    double modificationTime;
+    double accessTime;
+    uint8_t digest[SDDiskCacheIndexDigestLength]; // all zero if the entry has no digest
+    uint64_t checksum;
+    uint32_t variantKeysLength;
+    uint32_t newFileNameLength; // 0 if the operation is not rename
+} SDDiskCacheIndexRecord;
+
+@interface SDDiskCacheIndexEntry () {
+    @package
+    __unsafe_unretained SDDiskCacheIndexEntry *_prev;
+    __unsafe_unretained SDDiskCacheIndexEntry *_next;
+}
+@end
+
+@implementation SDDiskCacheIndexEntry
+@end
+
+@interface SDDiskCacheIndex () {
+    __unsafe_unretained SDDiskCacheIndexEntry *_head; // oldest
+    __unsafe_unretained SDDiskCacheIndexEntry *_tail; // newest
+    int _journalFD;
+}
+
+@property (nonatomic, copy, nonnull) NSString *directory;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSString *, SDDiskCacheIndexEntry *> *entries;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSData *, NSMutableSet<NSString *> *> *digestFileNames; // digest -> file names sharing the content
+@property (nonatomic, assign, readwrite) NSUInteger totalSize;
+@property (nonatomic, assign) NSUInteger journalCount;
+@property (nonatomic, assign) BOOL dirty; // has changes not in snapshot
+
+@end
+
+@implementation SDDiskCacheIndex
+
+- (instancetype)initWithDirectory:(NSString *)directory orderType:(SDImageCacheConfigExpireType)orderType {
+    self = [super init];
+    if (self) {
+        _directory = [directory copy];
+        _orderType = orderType;
+        _entries = [NSMutableDictionary dictionary];
+        _digestFileNames = [NSMutableDictionary dictionary];
+        _journalFD = -1;
+    }
+    return self;
+}
+
++ (BOOL)isIndexFileName:(NSString *)fileName {
+    return [fileName isEqualToString:kSDDiskCacheIndexSnapshotFileName] || [fileName isEqualToString:kSDDiskCacheIndexJournalFileName];
+}
+
+- (void)dealloc {
+    if (_dirty) {
+        [self synchronize];
+    }
+    [self closeJournal];
+}
+
+- (NSUInteger)totalCount {
+    return self.entries.count;
+}
+
+- (NSString *)snapshotPath {
+    return [self.directory stringByAppendingPathComponent:kSDDiskCacheIndexSnapshotFileName];
+}
+
+- (NSString *)journalPath {
+    return [self.directory stringByAppendingPathComponent:kSDDiskCacheIndexJournalFileName];
+}
+
+- (NSTimeInterval)orderTimeForEntry:(SDDiskCacheIndexEntry *)entry {
+    return self.orderType == SDImageCacheConfigExpireTypeAccessDate ? entry.accessTime : entry.modificationTime;
+}
+
+#pragma mark - List
+
+- (void)appendEntryToTail:(SDDiskCacheIndexEntry *)entry {
+    entry->_prev = _tail;
+    entry->_next = nil;
+    if (_tail) {
+        _tail->_next = entry;
+    } else {
+        _head = entry;
+    }
+    _tail = entry;
+}
+
+// Insert before the oldest entry which is newer than it. This walks the list, it's only used for the rare file which exists without entry
+- (void)insertEntryInOrder:(SDDiskCacheIndexEntry *)entry {
+    NSTimeInterval time = [self orderTimeForEntry:entry];
+    SDDiskCacheIndexEntry *next = _head;
+    while (next && [self orderTimeForEntry:next] <= time) {
+        next = next->_next;
+    }
+    if (!next) {
+        [self appendEntryToTail:entry];
+        return;
+    }
+    entry->_prev = next->_prev;
+    entry->_next = next;
+    if (next->_prev) {
+        next->_prev->_next = entry;
+    } else {
+        _head = entry;
+    }
+    next->_prev = entry;
+}
+
+- (void)unlinkEntry:(SDDiskCacheIndexEntry *)entry {
+    if (entry->_prev) entry->_prev->_next = entry->_next;
+    if (entry->_next) entry->_next->_prev = entry->_prev;
+    if (_head == entry) _head = entry->_next;
+    if (_tail == entry) _tail = entry->_prev;
+    entry->_prev = nil;
+    entry->_next = nil;
+}
+
+// The entries of same digest share one file, so its size is counted once
+- (void)retainContentOfEntry:(SDDiskCacheIndexEntry *)entry {
+    if (!entry.digest) {
+        self.totalSize += entry.size;
+        return;
+    }
+    NSMutableSet<NSString *> *fileNames = self.digestFileNames[entry.digest];
+    if (!fileNames) {
+        fileNames = [NSMutableSet set];
+        self.digestFileNames[entry.digest] = fileNames;
+        self.totalSize += entry.size;
+    }
+    [fileNames addObject:entry.fileName];
+}
+
+- (void)releaseContentOfEntry:(SDDiskCacheIndexEntry *)entry {
+    if (!entry.digest) {
+        self.totalSize -= entry.size;
+        return;
+    }
+    NSMutableSet<NSString *> *fileNames = self.digestFileNames[entry.digest];
+    [fileNames removeObject:entry.fileName];
+    if (fileNames.count == 0) {
+        [self.digestFileNames removeObjectForKey:entry.digest];
+        self.totalSize -= entry.size;
+    }
+}
+
+// Insert or replace, and move to the newest position, or the position of its date if `inOrder` is YES
+- (void)putEntry:(SDDiskCacheIndexEntry *)entry inOrder:(BOOL)inOrder {
+    SDDiskCacheIndexEntry *oldEntry = self.entries[entry.fileName];
+    if (oldEntry) {
+        [self unlinkEntry:oldEntry];
+        [self releaseContentOfEntry:oldEntry];
+    }
+    self.entries[entry.fileName] = entry;
+    if (inOrder) {
+        [self insertEntryInOrder:entry];
+    } else {
+        [self appendEntryToTail:entry];
+    }
+    [self retainContentOfEntry:entry];
+}
+
+// Keep the position in list, replace the entry of new file name if exists
+- (void)moveEntryForFileName:(NSString *)fileName toFileName:(NSString *)newFileName {
+    SDDiskCacheIndexEntry *entry = self.entries[fileName];
+    if (!entry || [fileName isEqualToString:newFileName]) {
+        return;
+    }
+    [self dropEntryForFileName:newFileName];
+    // The digest references are kept by file name
+    [self releaseContentOfEntry:entry];
+    [self.entries removeObjectForKey:fileName];
+    entry.fileName = newFileName;
+    self.entries[newFileName] = entry;
+    [self retainContentOfEntry:entry];
+}
+
+- (void)dropEntryForFileName:(NSString *)fileName {
+    SDDiskCacheIndexEntry *entry = self.entries[fileName];
+    if (!entry) {
+        return;
+    }
+    [self unlinkEntry:entry];
+    [self releaseContentOfEntry:entry];
+    [self.entries removeObjectForKey:fileName];
+}
+
+- (void)dropAllEntries {
+    _head = nil;
+    _tail = nil;
+    [self.entries removeAllObjects];
+    [self.digestFileNames removeAllObjects];
+    self.totalSize = 0;
+    _trimTargetSize = 0;
+}
+
+#pragma mark - Entries
+
+- (void)setTrimTargetSize:(NSUInteger)trimTargetSize {
+    if (_trimTargetSize == trimTargetSize) {
+        return;
+    }
+    _trimTargetSize = trimTargetSize;
+    // Only in snapshot, the caller synchronizes when a trim starts or finishes
+    self.dirty = YES;
+}
+
+- (SDDiskCacheIndexEntry *)entryForFileName:(NSString *)fileName {
+    return self.entries[fileName];
+}
+
+- (NSUInteger)referenceCountForDigest:(NSData *)digest {
+    return self.digestFileNames[digest].count;
+}
+
+- (void)setEntry:(SDDiskCacheIndexEntry *)entry {
+    [self putEntry:entry inOrder:NO];
+    [self appendJournalRecordWithOperation:SDDiskCacheIndexOperationSet entry:entry];
+}
+
+- (void)insertEntry:(SDDiskCacheIndexEntry *)entry {
+    [self putEntry:entry inOrder:YES];
+    [self appendJournalRecordWithOperation:SDDiskCacheIndexOperationInsert entry:entry];
+}
+
+- (void)renameEntryForFileName:(NSString *)fileName toFileName:(NSString *)newFileName {
+    SDDiskCacheIndexEntry *entry = self.entries[fileName];
+    if (!entry || [fileName isEqualToString:newFileName]) {
+        return;
+    }
+    [self moveEntryForFileName:fileName toFileName:newFileName];
+    [self appendJournalRecordWithOperation:SDDiskCacheIndexOperationRename entry:entry oldFileName:fileName];
+}
+
+- (void)updateVariantKeys:(NSArray<NSString *> *)variantKeys forFileName:(NSString *)fileName {
+    SDDiskCacheIndexEntry *entry = self.entries[fileName];
+    if (!entry) {
+        return;
+    }
+    entry.variantKeys = variantKeys.count > 0 ? variantKeys : nil;
+    [self appendJournalRecordWithOperation:SDDiskCacheIndexOperationUpdate entry:entry];
+}
+
+- (void)removeEntryForFileName:(NSString *)fileName {
+    SDDiskCacheIndexEntry *entry = self.entries[fileName];
+    if (!entry) {
+        return;
+    }
+    [self dropEntryForFileName:fileName];
+    [self appendJournalRecordWithOperation:SDDiskCacheIndexOperationRemove entry:entry];
+}
+
+- (void)touchEntryForFileName:(NSString *)fileName {
+    SDDiskCacheIndexEntry *entry = self.entries[fileName];
+    if (!entry) {
+        return;
+    }
+    entry.accessTime = [NSDate date].timeIntervalSince1970;
+    entry.hitCount++;
+    if (self.orderType == SDImageCacheConfigExpireTypeAccessDate && _tail != entry) {
+        [self unlinkEntry:entry];
+        [self appendEntryToTail:entry];
+    }
+    // Not journaled, this keeps cache hit from writing file
+    self.dirty = YES;
+}
+
+- (void)removeAllEntries {
+    [self dropAllEntries];
+    [self synchronize];
+}
+
+- (void)resetWithEntries:(NSArray<SDDiskCacheIndexEntry *> *)entries {
+    [self dropAllEntries];
+    for (SDDiskCacheIndexEntry *entry in entries) {
+        [self putEntry:entry inOrder:NO];
+    }
+    [self synchronize];
+}
+
+- (void)enumerateEntriesFromOldestUsingBlock:(void (^)(SDDiskCacheIndexEntry * _Nonnull, BOOL * _Nonnull))block {
+    SDDiskCacheIndexEntry *entry = _head;
+    BOOL stop = NO;
+    while (entry && !stop) {
+        // Keep the next one before calling block, block may remove current entry
+        SDDiskCacheIndexEntry *next = entry->_next;
+        block(entry, &stop);
+        entry = next;
+    }
+}
+
+#pragma mark - Persistence
+
+- (BOOL)load {
+    [self dropAllEntries];
+    NSData *snapshot = [NSData dataWithContentsOfFile:self.snapshotPath options:NSDataReadingMappedIfSafe error:nil];
+    if (snapshot.length < sizeof(SDDiskCacheIndexHeader)) {
+        return NO;
+    }
+    SDDiskCacheIndexHeader header;
+    memcpy(&header, snapshot.bytes, sizeof(header));
+    if (header.magic != kSDDiskCacheIndexMagic || header.version != kSDDiskCacheIndexVersion) {
+        return NO;
+    }
+    NSUInteger cursor = sizeof(header);
+    NSUInteger count = [self readRecordsFromData:snapshot cursor:&cursor];
+    if (count != header.count) {
+        // The snapshot is written atomically, a mismatch means it's corrupted
+        [self dropAllEntries];
+        return NO;
+    }
+
+    // Replay the journal, and drop the torn tail so later records are appended after a valid one
+    NSData *journal = [NSData dataWithContentsOfFile:self.journalPath options:NSDataReadingMappedIfSafe error:nil];
+    NSUInteger journalCursor = 0;
+    self.journalCount = [self readRecordsFromData:journal cursor:&journalCursor];
+    if (journal && journalCursor < journal.length) {
+        if ([self openJournal]) {
+            ftruncate(_journalFD, (off_t)journalCursor);
+        }
+    }
+
+    if (header.orderType != self.orderType) {
+        // The expire type changed since last launch, sort once by the new one
+        NSArray<SDDiskCacheIndexEntry *> *sortedEntries = [self.entries.allValues sortedArrayUsingComparator:^NSComparisonResult(SDDiskCacheIndexEntry * _Nonnull entry1, SDDiskCacheIndexEntry * _Nonnull entry2) {
+            NSTimeInterval time1 = [self orderTimeForEntry:entry1];
+            NSTimeInterval time2 = [self orderTimeForEntry:entry2];
+            return time1 < time2 ? NSOrderedAscending : (time1 > time2 ? NSOrderedDescending : NSOrderedSame);
+        }];
+        [self resetWithEntries:sortedEntries];
+    }
+    // Restore after the entries, `resetWithEntries:` drops it
+    _trimTargetSize = (NSUInteger)header.trimTargetSize;
+    return YES;
+}
+
+// Return the number of valid records, `cursor` stops after the last valid one
+- (NSUInteger)readRecordsFromData:(NSData *)data cursor:(NSUInteger *)cursor {
+    const uint8_t *bytes = data.bytes;
+    NSUInteger length = data.length;
+    NSUInteger count = 0;
+    while (*cursor + sizeof(SDDiskCacheIndexRecord) <= length) {
+        SDDiskCacheIndexRecord record;
+        memcpy(&record, bytes + *cursor, sizeof(record));
+        NSUInteger recordLength = sizeof(record) + record.fileNameLength + record.variantKeysLength + record.newFileNameLength;
+        if (record.magic != kSDDiskCacheIndexMagic || *cursor + recordLength > length) {
+            break;
+        }
+        NSString *fileName = [[NSString alloc] initWithBytes:bytes + *cursor + sizeof(record) length:record.fileNameLength encoding:NSUTF8StringEncoding];
+        if (!fileName) {
+            break;
+        }
+        NSArray<NSString *> *variantKeys = nil;
+        if (record.variantKeysLength > 0) {
+            NSString *variantKeysString = [[NSString alloc] initWithBytes:bytes + *cursor + sizeof(record) + record.fileNameLength length:record.variantKeysLength encoding:NSUTF8StringEncoding];
+            if (!variantKeysString) {
+                break;
+            }
+            variantKeys = [variantKeysString componentsSeparatedByString:kSDDiskCacheIndexVariantKeySeparator];
+        }
+        if (record.operation == SDDiskCacheIndexOperationSet || record.operation == SDDiskCacheIndexOperationInsert) {
+            SDDiskCacheIndexEntry *entry = [SDDiskCacheIndexEntry new];
+            entry.fileName = fileName;
+            entry.size = (NSUInteger)record.size;
+            entry.modificationTime = record.modificationTime;
+            entry.accessTime = record.accessTime;
+            entry.format = record.format;
+            entry.hitCount = record.hitCount;
+            entry.checksum = record.checksum;
+            entry.variantKeys = variantKeys;
+            if (memcmp(record.digest, kSDDiskCacheIndexEmptyDigest, SDDiskCacheIndexDigestLength) != 0) {
+                entry.digest = [NSData dataWithBytes:record.digest length:SDDiskCacheIndexDigestLength];
+            }
+            [self putEntry:entry inOrder:record.operation == SDDiskCacheIndexOperationInsert];
+        } else if (record.operation == SDDiskCacheIndexOperationRemove) {
+            [self dropEntryForFileName:fileName];
+        } else if (record.operation == SDDiskCacheIndexOperationUpdate) {
+            self.entries[fileName].variantKeys = variantKeys;
+        } else if (record.operation == SDDiskCacheIndexOperationRename) {
+            NSString *newFileName = [[NSString alloc] initWithBytes:bytes + *cursor + sizeof(record) + record.fileNameLength + record.variantKeysLength length:record.newFileNameLength encoding:NSUTF8StringEncoding];
+            if (!newFileName) {
+                break;
+            }
+            [self moveEntryForFileName:fileName toFileName:newFileName];
+        } else {
+            break;
+        }
+        *cursor += recordLength;
+        count++;
+    }
+    return count;
+}
+
+// The record of rename is keyed by the old file name, followed by the new one
+- (void)appendRecordWithOperation:(SDDiskCacheIndexOperation)operation entry:(SDDiskCacheIndexEntry *)entry oldFileName:(NSString *)oldFileName toData:(NSMutableData *)data {
+    NSData *fileNameData = [(oldFileName ?: entry.fileName) dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *newFileNameData = oldFileName ? [entry.fileName dataUsingEncoding:NSUTF8StringEncoding] : nil;
+    NSData *variantKeysData = oldFileName ? nil : [[entry.variantKeys componentsJoinedByString:kSDDiskCacheIndexVariantKeySeparator] dataUsingEncoding:NSUTF8StringEncoding];
+    SDDiskCacheIndexRecord record = {
+        .magic = kSDDiskCacheIndexMagic,
+        .operation = operation,
+        .fileNameLength = (uint16_t)fileNameData.length,
+        .format = (int32_t)entry.format,
+        .hitCount = (uint32_t)MIN(entry.hitCount, UINT32_MAX),
+        .size = entry.size,
+        .modificationTime = entry.modificationTime,
+        .accessTime = entry.accessTime,
+        .checksum = entry.checksum,
+        .variantKeysLength = (uint32_t)variantKeysData.length,
+        .newFileNameLength = (uint32_t)newFileNameData.length
+    };
+    if (entry.digest.length == SDDiskCacheIndexDigestLength) {
+        memcpy(record.digest, entry.digest.bytes, SDDiskCacheIndexDigestLength);
+    }
+    [data appendBytes:&record length:sizeof(record)];
+    [data appendData:fileNameData];
+    if (variantKeysData) {
+        [data appendData:variantKeysData];
+    }
+    if (newFileNameData) {
+        [data appendData:newFileNameData];
+    }
+}
+
+- (void)appendJournalRecordWithOperation:(SDDiskCacheIndexOperation)operation entry:(SDDiskCacheIndexEntry *)entry {
+    [self appendJournalRecordWithOperation:operation entry:entry oldFileName:nil];
+}
+
+- (void)appendJournalRecordWithOperation:(SDDiskCacheIndexOperation)operation entry:(SDDiskCacheIndexEntry *)entry oldFileName:(NSString *)oldFileName {
+    self.dirty = YES;
+    if (![self openJournal]) {
+        return;
+    }
+    NSMutableData *data = [NSMutableData dataWithCapacity:sizeof(SDDiskCacheIndexRecord) + entry.fileName.length + oldFileName.length];
+    [self appendRecordWithOperation:operation entry:entry oldFileName:oldFileName toData:data];
+    write(_journalFD, data.bytes, data.length);
+    self.journalCount++;
+    if (self.journalCount >= kSDDiskCacheIndexMaxJournalCount) {
+        [self synchronize];
+    }
+}
+
+- (void)synchronize {
+    NSMutableData *data = [NSMutableData dataWithCapacity:sizeof(SDDiskCacheIndexHeader) + self.entries.count * (sizeof(SDDiskCacheIndexRecord) + 40)];
+    SDDiskCacheIndexHeader header = {
+        .magic = kSDDiskCacheIndexMagic,
+        .version = kSDDiskCacheIndexVersion,
+        .orderType = (uint32_t)self.orderType,
+        .count = (uint32_t)self.entries.count,
+        .trimTargetSize = self.trimTargetSize
+    };
+    [data appendBytes:&header length:sizeof(header)];
+    // Write in list order, so loading does not need to sort
+    for (SDDiskCacheIndexEntry *entry = _head; entry; entry = entry->_next) {
+        [self appendRecordWithOperation:SDDiskCacheIndexOperationSet entry:entry oldFileName:nil toData:data];
+    }
+    // The journal is only truncated after the snapshot is complete. If crash between, replaying the journal again is harmless
+    if ([data writeToFile:self.snapshotPath options:NSDataWritingAtomic error:nil]) {
+        if ([self openJournal]) {
+            ftruncate(_journalFD, 0);
+        }
+        self.journalCount = 0;
+        self.dirty = NO;
+    }
+}
+
+- (void)invalidate {
+    [self closeJournal];
+    [self dropAllEntries];
+    [[NSFileManager defaultManager] removeItemAtPath:self.snapshotPath error:nil];
+    [[NSFileManager defaultManager] removeItemAtPath:self.journalPath error:nil];
+    self.journalCount = 0;
+    self.dirty = NO;
+}
+
+- (BOOL)openJournal {
+    if (_journalFD >= 0) {
+        return YES;
+    }
+    _journalFD = open(self.journalPath.fileSystemRepresentation, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    return _journalFD >= 0;
+}
+
+- (void)closeJournal {
+    if (_journalFD >= 0) {
+        close(_journalFD);
+        _journalFD = -1;
+    }
+}
+
+@end
@@ -0,0 +1,24 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "SDWebImageCompat.h"
+
+// A count-min sketch which estimates the access frequency of keys in a small fixed memory, used for TinyLFU admission of memory cache.
+// The counters saturate at 15, and are halved after every `10 * width` increments, so the popularity of old keys fades.
+// Not thread-safe, caller should hold a lock.
+@interface SDFrequencySketch : NSObject
+
+// The capacity is the expected number of entries of the cache
+- (nonnull instancetype)initWithCapacity:(NSUInteger)capacity;
+- (nonnull instancetype)init NS_UNAVAILABLE;
+
+- (void)incrementKey:(nonnull id)key;
+- (NSUInteger)frequencyForKey:(nonnull id)key;
+
+@end
@@ -0,0 +1,99 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDFrequencySketch.h"
+
+#define SD_SKETCH_DEPTH 4
+#define SD_SKETCH_MAX_COUNT 15
+
+static const uint64_t kSDSketchSeeds[SD_SKETCH_DEPTH] = {0xc3a5c85c97cb3127ULL, 0xb492b66fbe98f273ULL, 0x9ae16a3b2f90404fULL, 0xcbf29ce484222325ULL};
+
+static inline uint64_t SDSketchMix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+@implementation SDFrequencySketch {
+    uint8_t *_table; // SD_SKETCH_DEPTH rows of `_width` counters
+    NSUInteger _width; // power of two
+    NSUInteger _additions;
+    NSUInteger _sampleSize;
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity {
+    self = [super init];
+    if (self) {
+        NSUInteger width = 16;
+        while (width < capacity && width < (1 << 24)) {
+            width <<= 1;
+        }
+        _width = width;
+        _sampleSize = width * 10;
+        _table = calloc(SD_SKETCH_DEPTH * width, sizeof(uint8_t));
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_table);
+}
+
+- (void)incrementKey:(id)key {
+    NSUInteger indexes[SD_SKETCH_DEPTH];
+    [self indexes:indexes forKey:key];
+    uint8_t min = [self minCountAtIndexes:indexes];
+    if (min >= SD_SKETCH_MAX_COUNT) {
+        return;
+    }
+    // Conservative update, only increase the smallest counters, which reduces the over-estimation of collisions
+    for (NSUInteger i = 0; i < SD_SKETCH_DEPTH; i++) {
+        if (_table[indexes[i]] == min) {
+            _table[indexes[i]]++;
+        }
+    }
+    if (++_additions >= _sampleSize) {
+        [self age];
+    }
+}
+
+- (NSUInteger)frequencyForKey:(id)key {
+    NSUInteger indexes[SD_SKETCH_DEPTH];
+    [self indexes:indexes forKey:key];
+    return [self minCountAtIndexes:indexes];
+}
+
+#pragma mark - Helper
+
+- (void)indexes:(NSUInteger *)indexes forKey:(id)key {
+    uint64_t hash = [key hash];
+    for (NSUInteger i = 0; i < SD_SKETCH_DEPTH; i++) {
+        indexes[i] = i * _width + (SDSketchMix(hash + kSDSketchSeeds[i]) & (_width - 1));
+    }
+}
+
+- (uint8_t)minCountAtIndexes:(NSUInteger *)indexes {
+    uint8_t min = SD_SKETCH_MAX_COUNT;
+    for (NSUInteger i = 0; i < SD_SKETCH_DEPTH; i++) {
+        min = MIN(min, _table[indexes[i]]);
+    }
+    return min;
+}
+
+// Halve all the counters
+- (void)age {
+    for (NSUInteger i = 0; i < SD_SKETCH_DEPTH * _width; i++) {
+        _table[i] >>= 1;
+    }
+    _additions /= 2;
+}
+
+@end
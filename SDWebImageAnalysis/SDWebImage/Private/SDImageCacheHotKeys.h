@@ -0,0 +1,30 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "SDWebImageCompat.h"
+
+// This is used for `SDImageCache` to record the accessed keys, the hottest keys are saved as the warm start snapshot.
+// The keys are recorded in lock-striped shards, so recording a memory cache hit only locks the shard of its key. The shards are merged by `hottestKeys`.
+// Thread-safe.
+@interface SDImageCacheHotKeys : NSObject
+
+// The number of hottest keys returned. About twice the keys are recorded, so a key accessed frequently is not dropped by a few recent ones
+@property (nonatomic, assign, readonly) NSUInteger capacity;
+
+- (nonnull instancetype)initWithCapacity:(NSUInteger)capacity;
+- (nonnull instancetype)init NS_UNAVAILABLE;
+
+- (void)recordKey:(nonnull NSString *)key;
+- (void)removeKey:(nonnull NSString *)key;
+- (void)removeAllKeys;
+
+// Sorted by access count, then by recency, the hottest first
+- (nonnull NSArray<NSString *> *)hottestKeys;
+
+@end
@@ -0,0 +1,150 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDImageCacheHotKeys.h"
+#import "SDInternalMacros.h"
+#import <stdatomic.h>
+
+// Must be a power of two, so the shard index can be computed with a mask
+static const NSUInteger kSDImageCacheHotKeysShardCount = 16;
+
+// The access count and recency of one key, updated in place, so recording a hit of known key does not allocate
+@interface SDImageCacheHotKeyRecord : NSObject {
+    @package
+    NSUInteger _count;
+    NSUInteger _sequence; // the order of last access, larger is more recent
+}
+@end
+
+@implementation SDImageCacheHotKeyRecord
+@end
+
+// A shard of the recorded keys, caller should hold the `lock`
+@interface SDImageCacheHotKeysShard : NSObject
+
+@property (nonatomic, strong, nonnull) dispatch_semaphore_t lock;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSString *, SDImageCacheHotKeyRecord *> *records;
+
+@end
+
+@implementation SDImageCacheHotKeysShard
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _lock = dispatch_semaphore_create(1);
+        _records = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+@end
+
+@interface SDImageCacheHotKeys () {
+    atomic_ulong _sequence;
+    NSUInteger _shardCapacity; // the number of the most recent keys kept by one shard after pruning
+}
+
+@property (nonatomic, copy, nonnull) NSArray<SDImageCacheHotKeysShard *> *shards;
+
+@end
+
+@implementation SDImageCacheHotKeys
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity {
+    self = [super init];
+    if (self) {
+        _capacity = capacity;
+        // The keys are spread evenly, so each shard keeps about its share of twice the capacity
+        _shardCapacity = MAX((capacity * 2 + kSDImageCacheHotKeysShardCount - 1) / kSDImageCacheHotKeysShardCount, 1);
+        NSMutableArray<SDImageCacheHotKeysShard *> *shards = [NSMutableArray arrayWithCapacity:kSDImageCacheHotKeysShardCount];
+        for (NSUInteger i = 0; i < kSDImageCacheHotKeysShardCount; i++) {
+            [shards addObject:[SDImageCacheHotKeysShard new]];
+        }
+        _shards = [shards copy];
+    }
+    return self;
+}
+
+- (SDImageCacheHotKeysShard *)shardForKey:(NSString *)key {
+    return self.shards[key.hash & (kSDImageCacheHotKeysShardCount - 1)];
+}
+
+- (void)recordKey:(NSString *)key {
+    NSParameterAssert(key);
+    NSUInteger sequence = atomic_fetch_add_explicit(&_sequence, 1, memory_order_relaxed);
+    SDImageCacheHotKeysShard *shard = [self shardForKey:key];
+    SD_LOCK(shard.lock);
+    SDImageCacheHotKeyRecord *record = shard.records[key];
+    if (!record) {
+        record = [SDImageCacheHotKeyRecord new];
+        shard.records[key] = record;
+    }
+    record->_count++;
+    record->_sequence = sequence;
+    // Drop the least recent keys in bulk when the shard doubles, so the pruning is amortized over the hits
+    if (shard.records.count > _shardCapacity * 2) {
+        [self pruneShard:shard];
+    }
+    SD_UNLOCK(shard.lock);
+}
+
+// Make sure to call with the shard lock held
+- (void)pruneShard:(SDImageCacheHotKeysShard *)shard {
+    NSArray<NSString *> *keys = [shard.records keysSortedByValueUsingComparator:^NSComparisonResult(SDImageCacheHotKeyRecord * _Nonnull record1, SDImageCacheHotKeyRecord * _Nonnull record2) {
+        return record1->_sequence < record2->_sequence ? NSOrderedAscending : (record1->_sequence > record2->_sequence ? NSOrderedDescending : NSOrderedSame);
+    }];
+    [shard.records removeObjectsForKeys:[keys subarrayWithRange:NSMakeRange(0, keys.count - _shardCapacity)]];
+}
+
+- (void)removeKey:(NSString *)key {
+    NSParameterAssert(key);
+    SDImageCacheHotKeysShard *shard = [self shardForKey:key];
+    SD_LOCK(shard.lock);
+    [shard.records removeObjectForKey:key];
+    SD_UNLOCK(shard.lock);
+}
+
+- (void)removeAllKeys {
+    for (SDImageCacheHotKeysShard *shard in self.shards) {
+        SD_LOCK(shard.lock);
+        [shard.records removeAllObjects];
+        SD_UNLOCK(shard.lock);
+    }
+}
+
+- (NSArray<NSString *> *)hottestKeys {
+    // Merge the shards, each is locked only while copying its records
+    NSMutableArray<NSString *> *keys = [NSMutableArray array];
+    NSMutableArray<SDImageCacheHotKeyRecord *> *records = [NSMutableArray array];
+    for (SDImageCacheHotKeysShard *shard in self.shards) {
+        SD_LOCK(shard.lock);
+        [shard.records enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull key, SDImageCacheHotKeyRecord * _Nonnull record, BOOL * _Nonnull stop) {
+            SDImageCacheHotKeyRecord *copiedRecord = [SDImageCacheHotKeyRecord new];
+            copiedRecord->_count = record->_count;
+            copiedRecord->_sequence = record->_sequence;
+            [keys addObject:key];
+            [records addObject:copiedRecord];
+        }];
+        SD_UNLOCK(shard.lock);
+    }
+    NSDictionary<NSString *, SDImageCacheHotKeyRecord *> *recordMap = [NSDictionary dictionaryWithObjects:records forKeys:keys];
+    // By access count, then by recency
+    NSArray<NSString *> *sortedKeys = [recordMap keysSortedByValueUsingComparator:^NSComparisonResult(SDImageCacheHotKeyRecord * _Nonnull record1, SDImageCacheHotKeyRecord * _Nonnull record2) {
+        if (record1->_count != record2->_count) {
+            return record1->_count > record2->_count ? NSOrderedAscending : NSOrderedDescending;
+        }
+        return record1->_sequence > record2->_sequence ? NSOrderedAscending : (record1->_sequence < record2->_sequence ? NSOrderedDescending : NSOrderedSame);
+    }];
+    if (sortedKeys.count > _capacity) {
+        sortedKeys = [sortedKeys subarrayWithRange:NSMakeRange(0, _capacity)];
+    }
+    return sortedKeys;
+}
+
+@end
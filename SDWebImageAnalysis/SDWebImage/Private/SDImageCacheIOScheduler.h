@@ -0,0 +1,41 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "SDWebImageCompat.h"
+
+typedef NS_ENUM(NSUInteger, SDImageCacheIOType) {
+    // Query of one key, scheduled before all the other types, except a pending write after a few reads in a row
+    SDImageCacheIOTypeRead,
+    // Store or remove of one key
+    SDImageCacheIOTypeWrite,
+    // Query of one key, only run when there is no ready read or write. Used for warm start, which should not compete with the queries of app
+    SDImageCacheIOTypeLowPriorityRead,
+    // Run alongside the reads, but not the writes: it waits for the running writes, and the writes dispatched after it wait for it. One at a time, and it takes a worker before the pending reads, so the traffic can not postpone it. The disk cache should keep its index thread-safe. Used for expiration and size calculation
+    SDImageCacheIOTypeMaintenance,
+    // Run alone after all the operations dispatched before it, and before all the operations dispatched after it. Used for clearing and migration
+    SDImageCacheIOTypeBarrier
+};
+
+// This is used for `SDImageCache` to run the disk operations, instead of a single serial queue.
+// The keys are partitioned into lanes, operations in one lane run in order so the operations of same key keep consistent, while different lanes run concurrently on global queues, up to `maxConcurrentCount`.
+@interface SDImageCacheIOScheduler : NSObject
+
+@property (nonatomic, assign, readonly) NSUInteger maxConcurrentCount;
+
+- (nonnull instancetype)initWithMaxConcurrentCount:(NSUInteger)maxConcurrentCount;
+- (nonnull instancetype)init NS_UNAVAILABLE;
+
+// The key is ignored for maintenance and barrier
+- (void)dispatchAsyncWithType:(SDImageCacheIOType)type key:(nullable NSString *)key block:(nonnull dispatch_block_t)block;
+// Dispatch one task for each lane with the keys in that lane, keeping their order. The completion is called on a global queue after all the tasks finished
+- (void)dispatchAsyncWithType:(SDImageCacheIOType)type keys:(nonnull NSArray<NSString *> *)keys block:(nonnull void(^)(NSArray<NSString *> * _Nonnull laneKeys))block completion:(nullable dispatch_block_t)completion;
+// The block is executed on the calling thread. Do not call this from a block dispatched to the same scheduler, which cause deadlock
+- (void)dispatchSyncWithType:(SDImageCacheIOType)type key:(nullable NSString *)key block:(nonnull NS_NOESCAPE dispatch_block_t)block;
+
+@end
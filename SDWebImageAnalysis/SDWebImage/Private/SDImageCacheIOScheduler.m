@@ -0,0 +1,344 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDImageCacheIOScheduler.h"
+#import "SDInternalMacros.h"
+
+// More lanes than workers, so a slow operation only delays the few keys sharing its lane
+static const NSUInteger kSDImageCacheIOLaneCount = 32;
+// The reads are dequeued before the writes, but after this number of reads in a row a ready write goes first, so a steady read load can not starve the stores
+static const NSUInteger kSDImageCacheIOReadBurstCount = 4;
+
+@interface SDImageCacheIOTask : NSObject
+
+@property (nonatomic, assign, readonly) SDImageCacheIOType type;
+@property (nonatomic, assign, readonly) NSUInteger lane;
+@property (nonatomic, assign) qos_class_t qosClass;
+@property (nonatomic, assign) NSUInteger sequence; // the order of dispatch
+@property (nonatomic, copy, readonly, nonnull) dispatch_block_t block;
+
+@end
+
+@implementation SDImageCacheIOTask
+
+- (instancetype)initWithType:(SDImageCacheIOType)type lane:(NSUInteger)lane block:(dispatch_block_t)block {
+    self = [super init];
+    if (self) {
+        _type = type;
+        _lane = lane;
+        _block = [block copy];
+        switch (type) {
+            case SDImageCacheIOTypeRead:
+                _qosClass = QOS_CLASS_USER_INITIATED;
+                break;
+            case SDImageCacheIOTypeWrite:
+                _qosClass = QOS_CLASS_UTILITY;
+                break;
+            default:
+                _qosClass = QOS_CLASS_BACKGROUND;
+                break;
+        }
+    }
+    return self;
+}
+
+- (BOOL)isExclusive {
+    return self.type == SDImageCacheIOTypeBarrier;
+}
+
+@end
+
+@interface SDImageCacheIOLane : NSObject
+
+@property (nonatomic, strong, nonnull) NSMutableArray<SDImageCacheIOTask *> *tasks;
+@property (nonatomic, assign) BOOL running;
+
+@end
+
+@implementation SDImageCacheIOLane
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _tasks = [NSMutableArray array];
+    }
+    return self;
+}
+
+@end
+
+@interface SDImageCacheIOScheduler () {
+    dispatch_semaphore_t _lock;
+    NSArray<SDImageCacheIOLane *> *_lanes;
+    NSUInteger _pendingLaneTaskCount;
+    NSUInteger _nextLane; // round-robin start, so one busy lane does not starve the others
+    NSUInteger _runningCount;
+    NSUInteger _runningWriteCount;
+    NSUInteger _consecutiveReadCount; // the reads dequeued since the last write
+    NSUInteger _nextSequence;
+    BOOL _exclusiveRunning;
+    BOOL _maintenanceRunning;
+    NSMutableArray<SDImageCacheIOTask *> *_maintenanceTasks;
+    NSMutableArray<SDImageCacheIOTask *> *_lowPriorityTasks; // kept out of the lanes, so they do not block the reads behind them
+    NSMutableArray<SDImageCacheIOTask *> *_barrierTasks; // a barrier and all the tasks dispatched after it, the first one is always a barrier
+}
+
+@end
+
+@implementation SDImageCacheIOScheduler
+
+- (instancetype)initWithMaxConcurrentCount:(NSUInteger)maxConcurrentCount {
+    self = [super init];
+    if (self) {
+        _maxConcurrentCount = MAX(maxConcurrentCount, 1);
+        _lock = dispatch_semaphore_create(1);
+        NSMutableArray<SDImageCacheIOLane *> *lanes = [NSMutableArray arrayWithCapacity:kSDImageCacheIOLaneCount];
+        for (NSUInteger i = 0; i < kSDImageCacheIOLaneCount; i++) {
+            [lanes addObject:[SDImageCacheIOLane new]];
+        }
+        _lanes = [lanes copy];
+        _maintenanceTasks = [NSMutableArray array];
+        _lowPriorityTasks = [NSMutableArray array];
+        _barrierTasks = [NSMutableArray array];
+    }
+    return self;
+}
+
+#pragma mark - Dispatch
+
+- (void)dispatchAsyncWithType:(SDImageCacheIOType)type key:(NSString *)key block:(dispatch_block_t)block {
+    NSParameterAssert(block);
+    SDImageCacheIOTask *task = [[SDImageCacheIOTask alloc] initWithType:type lane:[self laneForKey:key] block:block];
+    SD_LOCK(_lock);
+    [self enqueueTask:task];
+    NSArray<SDImageCacheIOTask *> *readyTasks = [self dequeueReadyTasks];
+    SD_UNLOCK(_lock);
+    [self runTasks:readyTasks];
+}
+
+- (void)dispatchAsyncWithType:(SDImageCacheIOType)type keys:(NSArray<NSString *> *)keys block:(void (^)(NSArray<NSString *> * _Nonnull))block completion:(dispatch_block_t)completion {
+    NSParameterAssert(keys);
+    NSParameterAssert(block);
+    NSMutableDictionary<NSNumber *, NSMutableArray<NSString *> *> *laneKeysMap = [NSMutableDictionary dictionary];
+    for (NSString *key in keys) {
+        NSNumber *lane = @([self laneForKey:key]);
+        NSMutableArray<NSString *> *laneKeys = laneKeysMap[lane];
+        if (!laneKeys) {
+            laneKeys = [NSMutableArray array];
+            laneKeysMap[lane] = laneKeys;
+        }
+        [laneKeys addObject:key];
+    }
+    dispatch_group_t group = dispatch_group_create();
+    NSMutableArray<SDImageCacheIOTask *> *tasks = [NSMutableArray arrayWithCapacity:laneKeysMap.count];
+    [laneKeysMap enumerateKeysAndObjectsUsingBlock:^(NSNumber * _Nonnull lane, NSMutableArray<NSString *> * _Nonnull laneKeys, BOOL * _Nonnull stop) {
+        dispatch_group_enter(group);
+        SDImageCacheIOTask *task = [[SDImageCacheIOTask alloc] initWithType:type lane:lane.unsignedIntegerValue block:^{
+            block(laneKeys);
+            dispatch_group_leave(group);
+        }];
+        [tasks addObject:task];
+    }];
+    // Enqueue all the tasks at once, so they are scheduled together
+    SD_LOCK(_lock);
+    for (SDImageCacheIOTask *task in tasks) {
+        [self enqueueTask:task];
+    }
+    NSArray<SDImageCacheIOTask *> *readyTasks = [self dequeueReadyTasks];
+    SD_UNLOCK(_lock);
+    [self runTasks:readyTasks];
+    if (completion) {
+        dispatch_group_notify(group, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), completion);
+    }
+}
+
+- (void)dispatchSyncWithType:(SDImageCacheIOType)type key:(NSString *)key block:(NS_NOESCAPE dispatch_block_t)block {
+    NSParameterAssert(block);
+    dispatch_semaphore_t startSemaphore = dispatch_semaphore_create(0);
+    dispatch_semaphore_t finishSemaphore = dispatch_semaphore_create(0);
+    // If the task can not start immediately, a worker picks it later and hands over to the calling thread, keeping its lane until the block finished
+    SDImageCacheIOTask *task = [[SDImageCacheIOTask alloc] initWithType:type lane:[self laneForKey:key] block:^{
+        dispatch_semaphore_signal(startSemaphore);
+        dispatch_semaphore_wait(finishSemaphore, DISPATCH_TIME_FOREVER);
+    }];
+    // The calling thread is waiting, do not start it with a lower priority
+    task.qosClass = MAX(task.qosClass, qos_class_self());
+    SD_LOCK(_lock);
+    [self enqueueTask:task];
+    NSMutableArray<SDImageCacheIOTask *> *readyTasks = [self dequeueReadyTasks];
+    BOOL startImmediately = [readyTasks indexOfObjectIdenticalTo:task] != NSNotFound;
+    if (startImmediately) {
+        [readyTasks removeObjectIdenticalTo:task];
+    }
+    SD_UNLOCK(_lock);
+    [self runTasks:readyTasks];
+
+    if (startImmediately) {
+        block();
+        [self finishTask:task];
+    } else {
+        dispatch_semaphore_wait(startSemaphore, DISPATCH_TIME_FOREVER);
+        block();
+        dispatch_semaphore_signal(finishSemaphore);
+    }
+}
+
+#pragma mark - Scheduling
+
+- (NSUInteger)laneForKey:(NSString *)key {
+    return key.hash % kSDImageCacheIOLaneCount;
+}
+
+// Make sure to call with lock held
+- (void)enqueueTask:(SDImageCacheIOTask *)task {
+    task.sequence = _nextSequence++;
+    if (task.type == SDImageCacheIOTypeBarrier || _barrierTasks.count > 0) {
+        // Wait until the previous barrier finished
+        [_barrierTasks addObject:task];
+    } else {
+        [self enqueueUnblockedTask:task];
+    }
+}
+
+// Make sure to call with lock held
+- (void)enqueueUnblockedTask:(SDImageCacheIOTask *)task {
+    if (task.type == SDImageCacheIOTypeMaintenance) {
+        [_maintenanceTasks addObject:task];
+    } else if (task.type == SDImageCacheIOTypeLowPriorityRead) {
+        [_lowPriorityTasks addObject:task];
+    } else {
+        [_lanes[task.lane].tasks addObject:task];
+        _pendingLaneTaskCount++;
+    }
+}
+
+// Make sure to call with lock held
+- (NSMutableArray<SDImageCacheIOTask *> *)dequeueReadyTasks {
+    NSMutableArray<SDImageCacheIOTask *> *readyTasks = [NSMutableArray array];
+    if (_exclusiveRunning) {
+        return readyTasks;
+    }
+    // The maintenance takes a worker before the reads, once the running writes finished, so the steady traffic can not postpone it
+    if (!_maintenanceRunning && _maintenanceTasks.count > 0 && _runningWriteCount == 0 && _runningCount < _maxConcurrentCount) {
+        SDImageCacheIOTask *task = _maintenanceTasks.firstObject;
+        [_maintenanceTasks removeObjectAtIndex:0];
+        _maintenanceRunning = YES;
+        _runningCount++;
+        [readyTasks addObject:task];
+    }
+    // The writes dispatched after the pending maintenance wait for it, and no write runs alongside the running one. The reads are not blocked
+    NSUInteger writeSequenceLimit = NSUIntegerMax;
+    if (_maintenanceRunning) {
+        writeSequenceLimit = 0;
+    } else if (_maintenanceTasks.count > 0) {
+        writeSequenceLimit = _maintenanceTasks.firstObject.sequence;
+    }
+    while (_runningCount < _maxConcurrentCount && _pendingLaneTaskCount > 0) {
+        SDImageCacheIOTask *task;
+        if (_consecutiveReadCount >= kSDImageCacheIOReadBurstCount) {
+            task = [self dequeueLaneTaskOfType:SDImageCacheIOTypeWrite sequenceLimit:writeSequenceLimit];
+        }
+        if (!task) {
+            task = [self dequeueLaneTaskOfType:SDImageCacheIOTypeRead sequenceLimit:NSUIntegerMax];
+        }
+        if (!task) {
+            task = [self dequeueLaneTaskOfType:SDImageCacheIOTypeWrite sequenceLimit:writeSequenceLimit];
+        }
+        if (task.type == SDImageCacheIOTypeWrite) {
+            _runningWriteCount++;
+            _consecutiveReadCount = 0;
+        } else if (task) {
+            _consecutiveReadCount++;
+        }
+        if (!task) {
+            // All the pending tasks are behind a running one or a blocked write in their lanes
+            break;
+        }
+        _lanes[task.lane].running = YES;
+        _runningCount++;
+        [readyTasks addObject:task];
+    }
+    // The workers left have no ready read or write. The low priority read takes its lane, but only when the lane is idle, so it keeps the order of the key
+    for (NSUInteger i = 0; i < _lowPriorityTasks.count && _runningCount < _maxConcurrentCount;) {
+        SDImageCacheIOTask *task = _lowPriorityTasks[i];
+        SDImageCacheIOLane *lane = _lanes[task.lane];
+        if (lane.running || lane.tasks.count > 0) {
+            i++;
+            continue;
+        }
+        [_lowPriorityTasks removeObjectAtIndex:i];
+        lane.running = YES;
+        _runningCount++;
+        [readyTasks addObject:task];
+    }
+    if (_runningCount == 0 && _pendingLaneTaskCount == 0 && _lowPriorityTasks.count == 0) {
+        // Idle, the pending barrier runs alone because it blocks all the tasks behind it
+        SDImageCacheIOTask *task = _barrierTasks.firstObject;
+        if (task) {
+            [_barrierTasks removeObjectAtIndex:0];
+            _exclusiveRunning = YES;
+            _runningCount++;
+            [readyTasks addObject:task];
+        }
+    }
+    return readyTasks;
+}
+
+// Make sure to call with lock held
+- (SDImageCacheIOTask *)dequeueLaneTaskOfType:(SDImageCacheIOType)type sequenceLimit:(NSUInteger)sequenceLimit {
+    for (NSUInteger i = 0; i < kSDImageCacheIOLaneCount; i++) {
+        NSUInteger index = (_nextLane + i) % kSDImageCacheIOLaneCount;
+        SDImageCacheIOLane *lane = _lanes[index];
+        SDImageCacheIOTask *task = lane.tasks.firstObject;
+        if (lane.running || !task || task.type != type || task.sequence >= sequenceLimit) {
+            continue;
+        }
+        [lane.tasks removeObjectAtIndex:0];
+        _pendingLaneTaskCount--;
+        _nextLane = (index + 1) % kSDImageCacheIOLaneCount;
+        return task;
+    }
+    return nil;
+}
+
+- (void)runTasks:(NSArray<SDImageCacheIOTask *> *)tasks {
+    for (SDImageCacheIOTask *task in tasks) {
+        dispatch_async(dispatch_get_global_queue(task.qosClass, 0), ^{
+            task.block();
+            [self finishTask:task];
+        });
+    }
+}
+
+- (void)finishTask:(SDImageCacheIOTask *)task {
+    SD_LOCK(_lock);
+    _runningCount--;
+    if ([task isExclusive]) {
+        _exclusiveRunning = NO;
+        if (task.type == SDImageCacheIOTypeBarrier) {
+            // Release the tasks dispatched after the barrier, until the next barrier
+            while (_barrierTasks.count > 0 && _barrierTasks.firstObject.type != SDImageCacheIOTypeBarrier) {
+                SDImageCacheIOTask *pendingTask = _barrierTasks.firstObject;
+                [_barrierTasks removeObjectAtIndex:0];
+                [self enqueueUnblockedTask:pendingTask];
+            }
+        }
+    } else if (task.type == SDImageCacheIOTypeMaintenance) {
+        _maintenanceRunning = NO;
+    } else {
+        if (task.type == SDImageCacheIOTypeWrite) {
+            _runningWriteCount--;
+        }
+        _lanes[task.lane].running = NO;
+    }
+    NSArray<SDImageCacheIOTask *> *readyTasks = [self dequeueReadyTasks];
+    SD_UNLOCK(_lock);
+    [self runTasks:readyTasks];
+}
+
+@end
@@ -0,0 +1,48 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "SDWebImageCompat.h"
+
+// One pending store of the write buffer
+@interface SDImageCacheWriteBufferEntry : NSObject
+
+@property (nonatomic, copy, readonly, nonnull) NSString *key;
+@property (nonatomic, strong, readonly, nullable) UIImage *image;
+// The data to write. If nil, the image is encoded when flushing or queried
+@property (atomic, strong, nullable) NSData *data;
+@property (nonatomic, assign, readonly) NSUInteger cost;
+
+- (nonnull instancetype)initWithKey:(nonnull NSString *)key image:(nullable UIImage *)image data:(nullable NSData *)data cost:(NSUInteger)cost;
+- (nonnull instancetype)init NS_UNAVAILABLE;
+
+@end
+
+// This is used for `SDImageCache` to coalesce the disk stores. The entries stay queryable until they are written, and a later store or remove of the same key supersedes the pending one.
+// Thread-safe. The flushing itself is done by `SDImageCache`.
+@interface SDImageCacheWriteBuffer : NSObject
+
+// The cost of the entries not flushed yet
+@property (nonatomic, assign, readonly) NSUInteger pendingCost;
+
+- (nullable SDImageCacheWriteBufferEntry *)entryForKey:(nonnull NSString *)key;
+// Replace the entry of same key, the replaced one is not written if it's not flushed yet
+- (void)setEntry:(nonnull SDImageCacheWriteBufferEntry *)entry;
+- (void)removeEntryForKey:(nonnull NSString *)key;
+- (void)removeAllEntries;
+
+// Return YES if no flush is scheduled, and mark it as scheduled. The mark is cleared by `entriesToFlush`
+- (BOOL)markFlushScheduled;
+// Return the entries not flushed yet, they keep queryable until `finishFlushingEntry:`
+- (nonnull NSArray<SDImageCacheWriteBufferEntry *> *)entriesToFlush;
+// Whether the entry is not superseded by a later store or remove
+- (BOOL)isCurrentEntry:(nonnull SDImageCacheWriteBufferEntry *)entry;
+// Remove the entry after it's written, if it's not superseded
+- (void)finishFlushingEntry:(nonnull SDImageCacheWriteBufferEntry *)entry;
+
+@end
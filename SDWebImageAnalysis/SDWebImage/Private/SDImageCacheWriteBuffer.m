@@ -0,0 +1,143 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDImageCacheWriteBuffer.h"
+#import "SDInternalMacros.h"
+
+@interface SDImageCacheWriteBufferEntry ()
+
+@property (nonatomic, assign) BOOL flushing;
+
+@end
+
+@implementation SDImageCacheWriteBufferEntry
+
+- (instancetype)initWithKey:(NSString *)key image:(UIImage *)image data:(NSData *)data cost:(NSUInteger)cost {
+    self = [super init];
+    if (self) {
+        _key = [key copy];
+        _image = image;
+        _data = data;
+        _cost = cost;
+    }
+    return self;
+}
+
+@end
+
+@interface SDImageCacheWriteBuffer () {
+    dispatch_semaphore_t _lock;
+    NSMutableDictionary<NSString *, SDImageCacheWriteBufferEntry *> *_entries;
+    NSUInteger _pendingCost;
+    BOOL _flushScheduled;
+}
+
+@end
+
+@implementation SDImageCacheWriteBuffer
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _lock = dispatch_semaphore_create(1);
+        _entries = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (NSUInteger)pendingCost {
+    SD_LOCK(_lock);
+    NSUInteger pendingCost = _pendingCost;
+    SD_UNLOCK(_lock);
+    return pendingCost;
+}
+
+- (SDImageCacheWriteBufferEntry *)entryForKey:(NSString *)key {
+    NSParameterAssert(key);
+    SD_LOCK(_lock);
+    SDImageCacheWriteBufferEntry *entry = _entries[key];
+    SD_UNLOCK(_lock);
+    return entry;
+}
+
+- (void)setEntry:(SDImageCacheWriteBufferEntry *)entry {
+    NSParameterAssert(entry);
+    SD_LOCK(_lock);
+    [self _removeEntryForKey:entry.key];
+    _entries[entry.key] = entry;
+    _pendingCost += entry.cost;
+    SD_UNLOCK(_lock);
+}
+
+- (void)removeEntryForKey:(NSString *)key {
+    NSParameterAssert(key);
+    SD_LOCK(_lock);
+    [self _removeEntryForKey:key];
+    SD_UNLOCK(_lock);
+}
+
+// Make sure to call with lock held
+- (void)_removeEntryForKey:(NSString *)key {
+    SDImageCacheWriteBufferEntry *entry = _entries[key];
+    if (!entry) {
+        return;
+    }
+    if (!entry.flushing) {
+        _pendingCost -= entry.cost;
+    }
+    [_entries removeObjectForKey:key];
+}
+
+- (void)removeAllEntries {
+    SD_LOCK(_lock);
+    [_entries removeAllObjects];
+    _pendingCost = 0;
+    SD_UNLOCK(_lock);
+}
+
+- (BOOL)markFlushScheduled {
+    SD_LOCK(_lock);
+    BOOL shouldSchedule = !_flushScheduled;
+    _flushScheduled = YES;
+    SD_UNLOCK(_lock);
+    return shouldSchedule;
+}
+
+- (NSArray<SDImageCacheWriteBufferEntry *> *)entriesToFlush {
+    NSMutableArray<SDImageCacheWriteBufferEntry *> *entries = [NSMutableArray array];
+    SD_LOCK(_lock);
+    for (SDImageCacheWriteBufferEntry *entry in _entries.objectEnumerator) {
+        if (!entry.flushing) {
+            entry.flushing = YES;
+            [entries addObject:entry];
+        }
+    }
+    _pendingCost = 0;
+    _flushScheduled = NO;
+    SD_UNLOCK(_lock);
+    return [entries copy];
+}
+
+- (BOOL)isCurrentEntry:(SDImageCacheWriteBufferEntry *)entry {
+    NSParameterAssert(entry);
+    SD_LOCK(_lock);
+    BOOL isCurrent = _entries[entry.key] == entry;
+    SD_UNLOCK(_lock);
+    return isCurrent;
+}
+
+- (void)finishFlushingEntry:(SDImageCacheWriteBufferEntry *)entry {
+    NSParameterAssert(entry);
+    SD_LOCK(_lock);
+    if (_entries[entry.key] == entry) {
+        [_entries removeObjectForKey:entry.key];
+    }
+    SD_UNLOCK(_lock);
+}
+
+@end
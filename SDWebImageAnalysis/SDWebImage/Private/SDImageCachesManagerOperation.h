@@ -8,6 +8,7 @@
 
 #import <Foundation/Foundation.h>
 #import "SDWebImageCompat.h"
+#import "SDWebImageOperation.h"
 
 // This is used for operation management, but not for operation queue execute
 @interface SDImageCachesManagerOperation : NSOperation
@@ -17,5 +18,8 @@
 - (void)beginWithTotalCount:(NSUInteger)totalCount;
 - (void)completeOne;
 - (void)done;
+// The child operations are cancelled when this operation is cancelled
+- (void)addChildOperation:(nonnull id<SDWebImageOperation>)operation;
+- (void)cancelChildOperations;
 
 @end
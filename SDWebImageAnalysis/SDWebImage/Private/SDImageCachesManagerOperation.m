@@ -12,6 +12,7 @@
 @implementation SDImageCachesManagerOperation
 {
     dispatch_semaphore_t _pendingCountLock;
+    NSMutableArray<id<SDWebImageOperation>> *_childOperations;
 }
 
 @synthesize executing = _executing;
@@ -23,6 +24,7 @@
     if (self = [super init]) {
         _pendingCountLock = dispatch_semaphore_create(1);
         _pendingCount = 0;
+        _childOperations = [NSMutableArray array];
     }
     return self;
 }
@@ -49,6 +51,24 @@
 - (void)cancel {
     self.cancelled = YES;
     [self reset];
+    [self cancelChildOperations];
+}
+
+- (void)addChildOperation:(id<SDWebImageOperation>)operation {
+    NSParameterAssert(operation);
+    SD_LOCK(_pendingCountLock);
+    [_childOperations addObject:operation];
+    SD_UNLOCK(_pendingCountLock);
+}
+
+- (void)cancelChildOperations {
+    SD_LOCK(_pendingCountLock);
+    NSArray<id<SDWebImageOperation>> *childOperations = [_childOperations copy];
+    [_childOperations removeAllObjects];
+    SD_UNLOCK(_pendingCountLock);
+    for (id<SDWebImageOperation> operation in childOperations) {
+        [operation cancel];
+    }
 }
 
 - (void)done {
@@ -0,0 +1,30 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "SDWebImageCompat.h"
+
+// This is used for `SDWebImageDownloaderOperation` to receive the image data, instead of copying a growing `NSMutableData` on each progressive decoding.
+// The buffer is append-only, so the bytes received never change. A snapshot is a no-copy view of them, which stays valid after more data appended. When the storage is full, the bytes are moved into a new storage twice as large, the old one is kept alive by its snapshots.
+// The appending is not thread-safe, the snapshots can be read from any thread.
+@interface SDWebImageDownloaderDataBuffer : NSObject
+
+@property (nonatomic, assign, readonly) NSUInteger length;
+
+// The capacity is a hint, such as the expected content length. The storage is allocated on first append
+- (nonnull instancetype)initWithCapacity:(NSUInteger)capacity;
+
+- (void)appendData:(nonnull NSData *)data;
+
+// The bytes received so far, without copy
+- (nonnull NSData *)snapshot;
+
+// The bytes received, for the final decoding and cache. Same as `snapshot`, unless most of the storage is unused, which is copied so the unused part is freed
+- (nonnull NSData *)compactedData;
+
+@end
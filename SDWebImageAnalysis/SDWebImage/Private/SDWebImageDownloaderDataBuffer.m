@@ -0,0 +1,132 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDWebImageDownloaderDataBuffer.h"
+
+// Do not trust a huge expected content length, the storage grows when it's actually received
+static const NSUInteger kSDWebImageDownloaderDataBufferMaxInitialCapacity = 32 * 1024 * 1024; // 32MB
+static const NSUInteger kSDWebImageDownloaderDataBufferMinCapacity = 16 * 1024; // 16KB
+
+// The memory block shared by the buffer and its snapshots, freed when all of them are released
+@interface SDWebImageDownloaderDataStorage : NSObject
+
+@property (nonatomic, assign, readonly, nonnull) uint8_t *bytes;
+@property (nonatomic, assign, readonly) NSUInteger capacity;
+
+@end
+
+@implementation SDWebImageDownloaderDataStorage
+
+- (nullable instancetype)initWithCapacity:(NSUInteger)capacity {
+    self = [super init];
+    if (self) {
+        _bytes = malloc(capacity);
+        if (!_bytes) {
+            return nil;
+        }
+        _capacity = capacity;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_bytes);
+}
+
+@end
+
+@interface SDWebImageDownloaderDataBuffer ()
+
+@property (nonatomic, assign, readwrite) NSUInteger length;
+@property (nonatomic, assign) NSUInteger initialCapacity;
+@property (nonatomic, strong, nullable) SDWebImageDownloaderDataStorage *storage;
+@property (nonatomic, strong, nullable) NSMutableData *fallbackData; // used only if the storage can not be allocated
+
+@end
+
+@implementation SDWebImageDownloaderDataBuffer
+
+- (instancetype)init {
+    return [self initWithCapacity:0];
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity {
+    self = [super init];
+    if (self) {
+        _initialCapacity = MAX(MIN(capacity, kSDWebImageDownloaderDataBufferMaxInitialCapacity), kSDWebImageDownloaderDataBufferMinCapacity);
+    }
+    return self;
+}
+
+- (void)appendData:(NSData *)data {
+    NSUInteger dataLength = data.length;
+    if (dataLength == 0) {
+        return;
+    }
+    if (!self.fallbackData && ![self reserveCapacity:self.length + dataLength]) {
+        // Out of memory for a contiguous block, keep the received bytes in mutable data, and copy on each snapshot as before
+        self.fallbackData = [NSMutableData dataWithCapacity:self.length + dataLength];
+        if (self.storage) {
+            [self.fallbackData appendBytes:self.storage.bytes length:self.length];
+        }
+        self.storage = nil;
+    }
+    if (self.fallbackData) {
+        [self.fallbackData appendData:data];
+        self.length = self.fallbackData.length;
+        return;
+    }
+    // The data from URLSession may be discontiguous, copy each region without flattening it first
+    uint8_t *bytes = self.storage.bytes + self.length;
+    [data enumerateByteRangesUsingBlock:^(const void * _Nonnull rangeBytes, NSRange byteRange, BOOL * _Nonnull stop) {
+        memcpy(bytes + byteRange.location, rangeBytes, byteRange.length);
+    }];
+    self.length += dataLength;
+}
+
+// Return NO if the storage can not be allocated
+- (BOOL)reserveCapacity:(NSUInteger)capacity {
+    SDWebImageDownloaderDataStorage *storage = self.storage;
+    if (storage && storage.capacity >= capacity) {
+        return YES;
+    }
+    NSUInteger newCapacity = storage ? MAX(storage.capacity * 2, capacity) : MAX(self.initialCapacity, capacity);
+    SDWebImageDownloaderDataStorage *newStorage = [[SDWebImageDownloaderDataStorage alloc] initWithCapacity:newCapacity];
+    if (!newStorage) {
+        return NO;
+    }
+    if (storage) {
+        memcpy(newStorage.bytes, storage.bytes, self.length);
+    }
+    self.storage = newStorage;
+    return YES;
+}
+
+- (NSData *)snapshot {
+    if (self.fallbackData) {
+        return [self.fallbackData copy];
+    }
+    SDWebImageDownloaderDataStorage *storage = self.storage;
+    if (!storage || self.length == 0) {
+        return [NSData data];
+    }
+    // The snapshot retains the storage, and never free the bytes by itself
+    return [[NSData alloc] initWithBytesNoCopy:storage.bytes length:self.length deallocator:^(void * _Nonnull bytes, NSUInteger length) {
+        [storage class];
+    }];
+}
+
+- (NSData *)compactedData {
+    SDWebImageDownloaderDataStorage *storage = self.storage;
+    if (storage && self.length < storage.capacity / 2) {
+        return [NSData dataWithBytes:storage.bytes length:self.length];
+    }
+    return [self snapshot];
+}
+
+@end
@@ -0,0 +1,32 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "SDWebImageCompat.h"
+
+// This is used for `SDWebImageDownloaderOperation` to keep the partial data of interrupted downloads on disk, keyed by URL, with the validator (strong ETag or Last-Modified) for the `If-Range` header of resumption.
+// The lengths and validators are kept in memory, so the lookup does not touch disk. The reads, writes and removals are asynchronous on a serial queue, the partial data of same validator is extended by appending the new bytes. The least recently used partial data is removed when the total size exceeds `maxSize`, or by the global disk budget (see `SDDiskBudgetManager`). The partial data not resumed for a day is removed.
+// Thread-safe.
+@interface SDWebImageDownloaderResumeStore : NSObject
+
+@property (nonatomic, class, readonly, nonnull) SDWebImageDownloaderResumeStore *sharedStore;
+
+// The maximum total size of partial data in bytes. Defaults to 50MB
+@property (atomic, assign) NSUInteger maxSize;
+
+- (nonnull instancetype)initWithDirectory:(nonnull NSString *)directory NS_DESIGNATED_INITIALIZER;
+- (nonnull instancetype)init NS_UNAVAILABLE;
+
+// Returns NO if there is no partial data. Only the in-memory entries are looked up, the entries persisted by last launch are loaded asynchronously after the store is created
+- (BOOL)getPartialDataLength:(nonnull NSUInteger *)length validator:(NSString * _Nullable * _Nonnull)validator forURL:(nonnull NSURL *)url;
+// Read the first `length` bytes of the partial data looked up by `getPartialDataLength:validator:forURL:`, asynchronously in the serial queue of store. The completion is called in that queue, with nil if the partial data is replaced or removed meanwhile
+- (void)readPartialDataForURL:(nonnull NSURL *)url validator:(nonnull NSString *)validator length:(NSUInteger)length completion:(nonnull void(^)(NSData * _Nullable data))completion;
+- (void)storePartialData:(nonnull NSData *)data validator:(nonnull NSString *)validator forURL:(nonnull NSURL *)url;
+- (void)removePartialDataForURL:(nonnull NSURL *)url;
+
+@end
@@ -0,0 +1,335 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDWebImageDownloaderResumeStore.h"
+#import "SDDiskBudgetManager.h"
+#import "SDInternalMacros.h"
+#import <CommonCrypto/CommonDigest.h>
+
+static NSString * const kResumeInfoURLKey = @"url";
+static NSString * const kResumeInfoValidatorKey = @"validator";
+static NSString * const kResumeInfoLengthKey = @"length";
+static NSString * const kResumeInfoPathExtension = @"plist";
+static const NSTimeInterval kResumeDataMaxAge = 60 * 60 * 24; // 1 day
+static const NSUInteger kResumeDataDefaultMaxSize = 50 * 1024 * 1024; // 50MB
+
+// The metadata of the partial data of one URL. The entry is replaced instead of mutated when the partial data is replaced, only `length` grows when the new bytes are appended
+@interface SDWebImageDownloaderResumeEntry : NSObject
+
+@property (nonatomic, copy, nonnull) NSString *validator;
+@property (nonatomic, assign) NSUInteger length;
+@property (nonatomic, assign) NSTimeInterval accessTime;
+
+@end
+
+@implementation SDWebImageDownloaderResumeEntry
+@end
+
+@interface SDWebImageDownloaderResumeStore () <SDDiskBudgetParticipant>
+
+@property (nonatomic, copy, nonnull) NSString *directory;
+@property (nonatomic, strong, nonnull) NSFileManager *fileManager;
+@property (nonatomic, strong, nonnull) dispatch_queue_t ioQueue;
+@property (nonatomic, strong, nonnull) NSMutableDictionary<NSString *, SDWebImageDownloaderResumeEntry *> *entries; // URL -> entry of the partial data on disk
+@property (nonatomic, assign) NSUInteger totalSize;
+@property (nonatomic, strong, nonnull) dispatch_semaphore_t entriesLock; // A lock to keep the access to `entries` and `totalSize` thread-safe
+
+@end
+
+@implementation SDWebImageDownloaderResumeStore
+
++ (SDWebImageDownloaderResumeStore *)sharedStore {
+    static dispatch_once_t onceToken;
+    static SDWebImageDownloaderResumeStore *store;
+    dispatch_once(&onceToken, ^{
+        NSString *cachesPath = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject ?: NSTemporaryDirectory();
+        NSString *directory = [cachesPath stringByAppendingPathComponent:@"com.hackemist.SDWebImageDownloader.partial"];
+        store = [[SDWebImageDownloaderResumeStore alloc] initWithDirectory:directory];
+    });
+    return store;
+}
+
+- (instancetype)initWithDirectory:(NSString *)directory {
+    self = [super init];
+    if (self) {
+        _directory = [directory copy];
+        _maxSize = kResumeDataDefaultMaxSize;
+        _entries = [NSMutableDictionary dictionary];
+        _entriesLock = dispatch_semaphore_create(1);
+        _ioQueue = dispatch_queue_create("com.hackemist.SDWebImageDownloaderResumeStore", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+        dispatch_sync(_ioQueue, ^{
+            self.fileManager = [NSFileManager new];
+        });
+        dispatch_async(_ioQueue, ^{
+            [self loadEntries];
+        });
+        // The partial data shares the device-wide disk budget with the image caches
+        [[SDDiskBudgetManager sharedManager] addParticipant:self];
+    }
+    return self;
+}
+
+#pragma mark - Partial Data
+
+- (BOOL)getPartialDataLength:(NSUInteger *)length validator:(NSString * _Nullable __autoreleasing *)validator forURL:(NSURL *)url {
+    NSParameterAssert(length);
+    NSParameterAssert(validator);
+    NSParameterAssert(url);
+    SD_LOCK(self.entriesLock);
+    SDWebImageDownloaderResumeEntry *entry = self.entries[url.absoluteString];
+    entry.accessTime = [NSDate date].timeIntervalSince1970;
+    *length = entry.length;
+    *validator = entry.validator;
+    SD_UNLOCK(self.entriesLock);
+    return entry != nil;
+}
+
+- (void)readPartialDataForURL:(NSURL *)url validator:(NSString *)validator length:(NSUInteger)length completion:(void (^)(NSData * _Nullable))completion {
+    NSParameterAssert(url);
+    NSParameterAssert(validator);
+    NSParameterAssert(completion);
+    NSString *key = url.absoluteString;
+    NSString *path = [self pathForKey:key];
+    // Read in io queue, after the pending writes. The entry is removed before its file is replaced, check it again after reading
+    dispatch_async(self.ioQueue, ^{
+        SD_LOCK(self.entriesLock);
+        SDWebImageDownloaderResumeEntry *entry = self.entries[key];
+        SD_UNLOCK(self.entriesLock);
+        if (!entry || ![entry.validator isEqualToString:validator] || entry.length < length || length == 0) {
+            completion(nil);
+            return;
+        }
+        NSData *data = [NSData dataWithContentsOfFile:path options:0 error:nil];
+        SD_LOCK(self.entriesLock);
+        BOOL replaced = self.entries[key] != entry;
+        SD_UNLOCK(self.entriesLock);
+        if (replaced || data.length < length) {
+            completion(nil);
+            return;
+        }
+        completion(data.length == length ? data : [data subdataWithRange:NSMakeRange(0, length)]);
+    });
+}
+
+- (void)storePartialData:(NSData *)data validator:(NSString *)validator forURL:(NSURL *)url {
+    NSParameterAssert(data);
+    NSParameterAssert(validator);
+    NSParameterAssert(url);
+    NSString *key = url.absoluteString;
+    NSString *path = [self pathForKey:key];
+    NSString *infoPath = [path stringByAppendingPathExtension:kResumeInfoPathExtension];
+    NSDictionary *info = @{kResumeInfoURLKey : key, kResumeInfoValidatorKey : validator, kResumeInfoLengthKey : @(data.length)};
+    dispatch_async(self.ioQueue, ^{
+        SD_LOCK(self.entriesLock);
+        SDWebImageDownloaderResumeEntry *entry = self.entries[key];
+        SD_UNLOCK(self.entriesLock);
+        if (entry && [entry.validator isEqualToString:validator] && data.length > entry.length) {
+            // The same content of a resumed download, only append the new bytes. The info is updated after appending, so the bytes of a torn append are ignored. If the append fails, the partial data is replaced below
+            // 续传下载的相同内容，只追加新的字节。信息在追加之后更新，因此不完整追加的字节会被忽略。如果追加失败，下面会替换部分数据
+            NSFileHandle *fileHandle = [NSFileHandle fileHandleForWritingAtPath:path];
+            if (fileHandle) {
+                @try {
+                    [fileHandle truncateFileAtOffset:entry.length];
+                    [fileHandle writeData:[data subdataWithRange:NSMakeRange(entry.length, data.length - entry.length)]];
+                    [fileHandle closeFile];
+                } @catch (NSException *exception) {
+                    fileHandle = nil;
+                }
+            }
+            if (fileHandle && [info writeToFile:infoPath atomically:YES]) {
+                SD_LOCK(self.entriesLock);
+                if (self.entries[key] == entry) {
+                    self.totalSize += data.length - entry.length;
+                    entry.length = data.length;
+                    entry.accessTime = [NSDate date].timeIntervalSince1970;
+                }
+                SD_UNLOCK(self.entriesLock);
+                [self trimToMaxSize];
+                return;
+            }
+        } else if (entry && [entry.validator isEqualToString:validator] && data.length <= entry.length) {
+            // Nothing new
+            return;
+        }
+        // Replace the partial data. Remove the entry first, so the reading of old one fails instead of reading the new file
+        // 替换部分数据。先删除条目，这样对旧数据的读取会失败，而不是读取新的文件
+        [self removeEntryForKey:key];
+        if (![self.fileManager fileExistsAtPath:self.directory]) {
+            [self.fileManager createDirectoryAtPath:self.directory withIntermediateDirectories:YES attributes:nil error:nil];
+        }
+        // The info is written last, so the data is never read without its info
+        [self.fileManager removeItemAtPath:infoPath error:nil];
+        if (![data writeToFile:path options:NSDataWritingAtomic error:nil] || ![info writeToFile:infoPath atomically:YES]) {
+            return;
+        }
+        SDWebImageDownloaderResumeEntry *newEntry = [SDWebImageDownloaderResumeEntry new];
+        newEntry.validator = validator;
+        newEntry.length = data.length;
+        newEntry.accessTime = [NSDate date].timeIntervalSince1970;
+        SD_LOCK(self.entriesLock);
+        self.entries[key] = newEntry;
+        self.totalSize += newEntry.length;
+        SD_UNLOCK(self.entriesLock);
+        [self trimToMaxSize];
+    });
+}
+
+- (void)removePartialDataForURL:(NSURL *)url {
+    NSParameterAssert(url);
+    NSString *key = url.absoluteString;
+    NSString *path = [self pathForKey:url.absoluteString];
+    // Remove the entry now, so the next lookup misses. Remove again after the pending writes
+    [self removeEntryForKey:key];
+    dispatch_async(self.ioQueue, ^{
+        [self removeEntryForKey:key];
+        [self removeItemsAtPath:path];
+    });
+}
+
+#pragma mark - SDDiskBudgetParticipant
+
+- (NSUInteger)diskBudgetUsage {
+    SD_LOCK(self.entriesLock);
+    NSUInteger totalSize = self.totalSize;
+    SD_UNLOCK(self.entriesLock);
+    return totalSize;
+}
+
+- (NSUInteger)diskBudgetMinimumSize {
+    return 0;
+}
+
+- (NSUInteger)diskBudgetMaximumSize {
+    return self.maxSize;
+}
+
+- (void)evictOldestDiskDataWithCount:(NSUInteger)count snapshotLimit:(NSUInteger)limit completion:(void (^)(SDDiskBudgetSnapshot * _Nonnull))completion {
+    dispatch_async(self.ioQueue, ^{
+        NSArray<NSString *> *keys = [self keysFromLeastRecentlyUsed];
+        NSUInteger removedCount = MIN(count, keys.count);
+        for (NSUInteger i = 0; i < removedCount; i++) {
+            [self removeEntryForKey:keys[i]];
+            [self removeItemsAtPath:[self pathForKey:keys[i]]];
+        }
+        NSMutableArray<NSNumber *> *sizes = [NSMutableArray array];
+        NSMutableArray<NSNumber *> *times = [NSMutableArray array];
+        SDDiskBudgetSnapshot *snapshot = [SDDiskBudgetSnapshot new];
+        SD_LOCK(self.entriesLock);
+        for (NSUInteger i = removedCount; i < keys.count && sizes.count < limit; i++) {
+            SDWebImageDownloaderResumeEntry *entry = self.entries[keys[i]];
+            if (entry) {
+                [sizes addObject:@(entry.length)];
+                [times addObject:@(entry.accessTime)];
+            }
+        }
+        snapshot.usage = self.totalSize;
+        SD_UNLOCK(self.entriesLock);
+        snapshot.oldestDataSizes = sizes;
+        snapshot.oldestDataTimes = times;
+        completion(snapshot);
+    });
+}
+
+#pragma mark - Helper
+
+- (void)removeEntryForKey:(NSString *)key {
+    SD_LOCK(self.entriesLock);
+    SDWebImageDownloaderResumeEntry *entry = self.entries[key];
+    if (entry) {
+        self.totalSize -= entry.length;
+        [self.entries removeObjectForKey:key];
+    }
+    SD_UNLOCK(self.entriesLock);
+}
+
+- (NSArray<NSString *> *)keysFromLeastRecentlyUsed {
+    SD_LOCK(self.entriesLock);
+    NSArray<NSString *> *keys = [self.entries keysSortedByValueUsingComparator:^NSComparisonResult(SDWebImageDownloaderResumeEntry * _Nonnull entry1, SDWebImageDownloaderResumeEntry * _Nonnull entry2) {
+        return entry1.accessTime < entry2.accessTime ? NSOrderedAscending : (entry1.accessTime > entry2.accessTime ? NSOrderedDescending : NSOrderedSame);
+    }];
+    SD_UNLOCK(self.entriesLock);
+    return keys;
+}
+
+// Make sure to call from io queue. Remove the least recently used partial data until the total size fits `maxSize`
+- (void)trimToMaxSize {
+    NSUInteger maxSize = self.maxSize;
+    if (maxSize > 0 && [self diskBudgetUsage] > maxSize) {
+        for (NSString *key in [self keysFromLeastRecentlyUsed]) {
+            if ([self diskBudgetUsage] <= maxSize) {
+                break;
+            }
+            [self removeEntryForKey:key];
+            [self removeItemsAtPath:[self pathForKey:key]];
+        }
+    }
+    [[SDDiskBudgetManager sharedManager] setNeedsEnforceDiskBudget];
+}
+
+// Make sure to call from io queue
+- (void)removeItemsAtPath:(NSString *)path {
+    [self.fileManager removeItemAtPath:[path stringByAppendingPathExtension:kResumeInfoPathExtension] error:nil];
+    [self.fileManager removeItemAtPath:path error:nil];
+}
+
+// Make sure to call from io queue. Load the entries persisted by last launch, and remove the expired or torn partial data
+- (void)loadEntries {
+    NSURL *directoryURL = [NSURL fileURLWithPath:self.directory isDirectory:YES];
+    NSArray<NSURL *> *fileURLs = [self.fileManager contentsOfDirectoryAtURL:directoryURL includingPropertiesForKeys:@[NSURLContentModificationDateKey] options:NSDirectoryEnumerationSkipsHiddenFiles error:nil];
+    NSDate *expirationDate = [NSDate dateWithTimeIntervalSinceNow:-kResumeDataMaxAge];
+    for (NSURL *fileURL in fileURLs) {
+        if (![fileURL.pathExtension isEqualToString:kResumeInfoPathExtension]) {
+            continue;
+        }
+        NSString *path = fileURL.path.stringByDeletingPathExtension;
+        NSDate *modificationDate;
+        [fileURL getResourceValue:&modificationDate forKey:NSURLContentModificationDateKey error:nil];
+        NSDictionary *info = [NSDictionary dictionaryWithContentsOfURL:fileURL];
+        NSString *infoURL = info[kResumeInfoURLKey];
+        NSString *infoValidator = info[kResumeInfoValidatorKey];
+        NSNumber *infoLength = info[kResumeInfoLengthKey];
+        // The data may be longer than the info by a torn append, only its first `length` bytes are used
+        NSUInteger fileSize = [[self.fileManager attributesOfItemAtPath:path error:nil] fileSize];
+        if (!modificationDate || [modificationDate compare:expirationDate] == NSOrderedAscending
+            || ![infoURL isKindOfClass:[NSString class]] || ![infoValidator isKindOfClass:[NSString class]] || ![infoLength isKindOfClass:[NSNumber class]]
+            || infoLength.unsignedIntegerValue == 0 || fileSize < infoLength.unsignedIntegerValue) {
+            [self removeItemsAtPath:path];
+            continue;
+        }
+        SDWebImageDownloaderResumeEntry *entry = [SDWebImageDownloaderResumeEntry new];
+        entry.validator = infoValidator;
+        entry.length = infoLength.unsignedIntegerValue;
+        entry.accessTime = modificationDate.timeIntervalSince1970;
+        SD_LOCK(self.entriesLock);
+        // The stores and removals after launch are queued after loading, so there is no newer entry
+        self.entries[infoURL] = entry;
+        self.totalSize += entry.length;
+        SD_UNLOCK(self.entriesLock);
+    }
+    // The data without info is torn
+    for (NSURL *fileURL in fileURLs) {
+        if (fileURL.pathExtension.length == 0 && ![self.fileManager fileExistsAtPath:[fileURL.path stringByAppendingPathExtension:kResumeInfoPathExtension]]) {
+            [self.fileManager removeItemAtURL:fileURL error:nil];
+        }
+    }
+    [self trimToMaxSize];
+}
+
+// The key is the absolute string of URL
+- (NSString *)pathForKey:(NSString *)key {
+    NSData *urlData = [key dataUsingEncoding:NSUTF8StringEncoding];
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256(urlData.bytes, (CC_LONG)urlData.length, digest);
+    NSMutableString *fileName = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH * 2];
+    for (NSUInteger i = 0; i < CC_SHA256_DIGEST_LENGTH; i++) {
+        [fileName appendFormat:@"%02x", digest[i]];
+    }
+    return [self.directory stringByAppendingPathComponent:fileName];
+}
+
+@end
@@ -0,0 +1,29 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import <Foundation/Foundation.h>
+#import "SDWebImageCompat.h"
+#import "SDWebImageDownloaderConfig.h"
+
+// This is used for `SDWebImageDownloader` to hold the operations waiting for a download slot. The highest priority is dequeued first, the same priority is dequeued by the execution order.
+// The priority of a waiting operation can be changed at any time, so the downloads which become visible overtake the ones scrolled offscreen.
+// Not thread-safe, call with the lock of downloader held.
+@interface SDWebImageDownloaderScheduler : NSObject
+
+@property (nonatomic, assign, readonly) NSUInteger count;
+
+- (void)addOperation:(nonnull NSOperation *)operation priority:(float)priority;
+// Does nothing if the operation is not waiting
+- (void)setPriority:(float)priority forOperation:(nonnull NSOperation *)operation;
+// Returns NO if the operation is not waiting
+- (BOOL)removeOperation:(nonnull NSOperation *)operation;
+// The execution order is passed each time, since it supports dynamic changes in config
+- (nullable NSOperation *)dequeueOperationWithExecutionOrder:(SDWebImageDownloaderExecutionOrder)executionOrder;
+- (nonnull NSArray<NSOperation *> *)removeAllOperations;
+
+@end
@@ -0,0 +1,107 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDWebImageDownloaderScheduler.h"
+
+@interface SDWebImageDownloaderSchedulerEntry : NSObject
+
+@property (nonatomic, strong, nonnull) NSOperation *operation;
+@property (nonatomic, assign) float priority;
+@property (nonatomic, assign) NSUInteger sequence; // the order of adding
+
+@end
+
+@implementation SDWebImageDownloaderSchedulerEntry
+@end
+
+@interface SDWebImageDownloaderScheduler ()
+
+@property (nonatomic, strong, nonnull) NSMutableArray<SDWebImageDownloaderSchedulerEntry *> *entries;
+@property (nonatomic, strong, nonnull) NSMapTable<NSOperation *, SDWebImageDownloaderSchedulerEntry *> *entriesByOperation;
+@property (nonatomic, assign) NSUInteger nextSequence;
+
+@end
+
+@implementation SDWebImageDownloaderScheduler
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _entries = [NSMutableArray array];
+        _entriesByOperation = [NSMapTable strongToStrongObjectsMapTable];
+    }
+    return self;
+}
+
+- (NSUInteger)count {
+    return self.entries.count;
+}
+
+- (void)addOperation:(NSOperation *)operation priority:(float)priority {
+    NSParameterAssert(operation);
+    if ([self.entriesByOperation objectForKey:operation]) {
+        [self setPriority:priority forOperation:operation];
+        return;
+    }
+    SDWebImageDownloaderSchedulerEntry *entry = [SDWebImageDownloaderSchedulerEntry new];
+    entry.operation = operation;
+    entry.priority = priority;
+    entry.sequence = self.nextSequence++;
+    [self.entries addObject:entry];
+    [self.entriesByOperation setObject:entry forKey:operation];
+}
+
+- (void)setPriority:(float)priority forOperation:(NSOperation *)operation {
+    NSParameterAssert(operation);
+    [self.entriesByOperation objectForKey:operation].priority = priority;
+}
+
+- (BOOL)removeOperation:(NSOperation *)operation {
+    NSParameterAssert(operation);
+    SDWebImageDownloaderSchedulerEntry *entry = [self.entriesByOperation objectForKey:operation];
+    if (!entry) {
+        return NO;
+    }
+    [self.entries removeObjectIdenticalTo:entry];
+    [self.entriesByOperation removeObjectForKey:operation];
+    return YES;
+}
+
+- (NSOperation *)dequeueOperationWithExecutionOrder:(SDWebImageDownloaderExecutionOrder)executionOrder {
+    // The waiting operations are bounded by the visible images, a linear scan keeps the priority change O(1)
+    BOOL lifo = executionOrder == SDWebImageDownloaderLIFOExecutionOrder;
+    NSUInteger bestIndex = NSNotFound;
+    SDWebImageDownloaderSchedulerEntry *best = nil;
+    for (NSUInteger i = 0; i < self.entries.count; i++) {
+        SDWebImageDownloaderSchedulerEntry *entry = self.entries[i];
+        if (!best
+            || entry.priority > best.priority
+            || (entry.priority == best.priority && (lifo ? entry.sequence > best.sequence : entry.sequence < best.sequence))) {
+            best = entry;
+            bestIndex = i;
+        }
+    }
+    if (!best) {
+        return nil;
+    }
+    [self.entries removeObjectAtIndex:bestIndex];
+    [self.entriesByOperation removeObjectForKey:best.operation];
+    return best.operation;
+}
+
+- (NSArray<NSOperation *> *)removeAllOperations {
+    NSMutableArray<NSOperation *> *operations = [NSMutableArray arrayWithCapacity:self.entries.count];
+    for (SDWebImageDownloaderSchedulerEntry *entry in self.entries) {
+        [operations addObject:entry.operation];
+    }
+    [self.entries removeAllObjects];
+    [self.entriesByOperation removeAllObjects];
+    return [operations copy];
+}
+
+@end
@@ -0,0 +1,26 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "SDWebImageCompat.h"
+#import "SDMemoryCache.h"
+
+// The cost of animated image changes while it's cached, when frames are preloaded or buffered by views. This is used to report the changes back to the memory cache which holds the image.
+@interface UIImage (MemoryCacheCostTracking)
+
+// The bytes of frames buffered by the views which display this image. Thread-safe
+@property (nonatomic, assign, readonly) NSUInteger sd_bufferedMemoryCost;
+
+- (void)sd_addBufferedMemoryCost:(NSInteger)delta;
+
+// Called by the memory cache when it stores the image. Only the last memory cache is tracked
+- (void)sd_trackMemoryCostInCache:(nonnull id<SDMemoryCache>)cache key:(nonnull id)key;
+
+// Report the current `sd_memoryCost` to the tracked memory cache, if it still holds this image
+- (void)sd_memoryCostDidChange;
+
+@end
@@ -0,0 +1,95 @@
+/*
+ * This file is part of the SDWebImage package.
+ * (c) Olivier Poitrey <rs@dailymotion.com>
+ *
+ * For the full copyright and license information, please view the LICENSE
+ * file that was distributed with this source code.
+ */
+
+#import "UIImage+MemoryCacheCostTracking.h"
+#import "UIImage+MemoryCacheCost.h"
+#import "SDInternalMacros.h"
+#import "objc/runtime.h"
+
+@interface SDMemoryCacheCostTrackingInfo : NSObject
+
+@property (nonatomic, weak, nullable) id<SDMemoryCache> cache;
+@property (nonatomic, strong, nullable) id key;
+@property (nonatomic, assign) NSUInteger bufferedMemoryCost;
+
+@end
+
+@implementation SDMemoryCacheCostTrackingInfo
+@end
+
+// One lock for all images, the tracking is only updated when frames are loaded or unloaded
+static dispatch_semaphore_t SDMemoryCacheCostTrackingLock(void) {
+    static dispatch_semaphore_t lock;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        lock = dispatch_semaphore_create(1);
+    });
+    return lock;
+}
+
+@implementation UIImage (MemoryCacheCostTracking)
+
+// Make sure to call with lock held
+- (SDMemoryCacheCostTrackingInfo *)sd_memoryCacheCostTrackingInfo:(BOOL)create {
+    SDMemoryCacheCostTrackingInfo *info = objc_getAssociatedObject(self, @selector(sd_memoryCacheCostTrackingInfo:));
+    if (!info && create) {
+        info = [SDMemoryCacheCostTrackingInfo new];
+        objc_setAssociatedObject(self, @selector(sd_memoryCacheCostTrackingInfo:), info, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+    return info;
+}
+
+- (NSUInteger)sd_bufferedMemoryCost {
+    dispatch_semaphore_t lock = SDMemoryCacheCostTrackingLock();
+    SD_LOCK(lock);
+    NSUInteger cost = [self sd_memoryCacheCostTrackingInfo:NO].bufferedMemoryCost;
+    SD_UNLOCK(lock);
+    return cost;
+}
+
+- (void)sd_addBufferedMemoryCost:(NSInteger)delta {
+    if (delta == 0) {
+        return;
+    }
+    dispatch_semaphore_t lock = SDMemoryCacheCostTrackingLock();
+    SD_LOCK(lock);
+    SDMemoryCacheCostTrackingInfo *info = [self sd_memoryCacheCostTrackingInfo:YES];
+    if (delta < 0 && (NSUInteger)(-delta) > info.bufferedMemoryCost) {
+        info.bufferedMemoryCost = 0;
+    } else {
+        info.bufferedMemoryCost += delta;
+    }
+    SD_UNLOCK(lock);
+    [self sd_memoryCostDidChange];
+}
+
+- (void)sd_trackMemoryCostInCache:(id<SDMemoryCache>)cache key:(id)key {
+    NSParameterAssert(cache);
+    NSParameterAssert(key);
+    dispatch_semaphore_t lock = SDMemoryCacheCostTrackingLock();
+    SD_LOCK(lock);
+    SDMemoryCacheCostTrackingInfo *info = [self sd_memoryCacheCostTrackingInfo:YES];
+    info.cache = cache;
+    info.key = key;
+    SD_UNLOCK(lock);
+}
+
+- (void)sd_memoryCostDidChange {
+    dispatch_semaphore_t lock = SDMemoryCacheCostTrackingLock();
+    SD_LOCK(lock);
+    SDMemoryCacheCostTrackingInfo *info = [self sd_memoryCacheCostTrackingInfo:NO];
+    id<SDMemoryCache> cache = info.cache;
+    id key = info.key;
+    SD_UNLOCK(lock);
+    if (!cache || !key || ![cache respondsToSelector:@selector(updateCost:forObject:key:)]) {
+        return;
+    }
+    [cache updateCost:self.sd_memoryCost forObject:self key:key];
+}
+
+@end